@@ -0,0 +1,725 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Headless benchmark of the simulation kernels, reporting cells per second
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <CPUEngine.h>
+#include <HashLifeEngine.h>
+#include <MultiDeviceEngine.h>
+#include <OpenCLKernel.h>
+#include <StreamingEngine.h>
+
+enum OutputFormat
+{
+    of_text,
+    of_csv,
+    of_json
+};
+
+enum EngineType
+{
+    et_opencl,
+    et_cpu,
+    et_hashLife,
+    et_multiDevice,
+    et_streaming
+};
+
+struct Variant
+{
+    std::string name;
+    EngineType engine;
+    CellStorage storage;
+    SimulationKernel kernel;
+    CPUInstructionSet instructionSet;
+};
+
+struct BoardSize
+{
+    int width;
+    int height;
+};
+
+struct Result
+{
+    BoardSize size;
+    std::string variant;
+    std::string workGroup;
+    int generationsPerLaunch;
+    unsigned int generations;
+    double kernelSeconds;
+    double transferSeconds;
+    double deviceBytes;
+    double transferBytes;
+};
+
+const Variant gVariants[] = {{"gameOfLife", et_opencl, cs_float4, sk_gameOfLife, cis_scalar},
+                             {"tiled", et_opencl, cs_float4, sk_tiled, cis_scalar},
+                             {"average", et_opencl, cs_float4, sk_average, cis_scalar},
+                             {"packed", et_opencl, cs_packed, sk_gameOfLife, cis_scalar},
+                             {"packedActive", et_opencl, cs_packed, sk_active, cis_scalar},
+                             {"chunked", et_opencl, cs_chunked, sk_gameOfLife, cis_scalar},
+                             {"states", et_opencl, cs_states, sk_gameOfLife, cis_scalar},
+                             {"cpuScalar", et_cpu, cs_packed, sk_gameOfLife, cis_scalar},
+                             {"cpuAVX2", et_cpu, cs_packed, sk_gameOfLife, cis_avx2},
+                             {"cpuAVX512", et_cpu, cs_packed, sk_gameOfLife, cis_avx512},
+                             {"hashLife", et_hashLife, cs_packed, sk_gameOfLife, cis_scalar},
+                             {"multiDevice", et_multiDevice, cs_packed, sk_gameOfLife, cis_scalar},
+                             {"streaming", et_streaming, cs_packed, sk_gameOfLife, cis_scalar}};
+
+// Settings
+int platform = 0;
+int device = 0;
+int threads = 0;
+std::string kernelFile = "../../gol/Kernel.cl";
+std::vector<BoardSize> sizes;
+std::vector<std::string> variantNames;
+std::vector<std::string> workGroups;
+std::vector<int> launches;
+int stripRows = gStreamingStripRows;
+unsigned int generations = 1000;
+unsigned int frames = 10;
+OutputFormat format = of_text;
+bool verification = false;
+// Rule of every engine, the kernels keeping their own rule when none is given
+std::string ruleName;
+Rule rule;
+
+double now()
+{
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+}
+
+std::vector<std::string> split(const std::string &value)
+{
+    std::vector<std::string> items;
+    std::stringstream s(value);
+    std::string item;
+    while (std::getline(s, item, ','))
+    {
+        if (!item.empty())
+            items.push_back(item);
+    }
+    return items;
+}
+
+bool parseSize(const std::string &value, int &x, int &y)
+{
+    return sscanf(value.c_str(), "%dx%d", &x, &y) == 2 && x > 0 && y > 0;
+}
+
+/*
+ * Global memory traffic of one generation, per cell: compulsory accesses of each kernel, caches ignored
+ */
+double deviceBytesPerCell(const Variant &variant, const int generationsPerLaunch)
+{
+    // RGBA texel of the cell
+    const double texture = gColorDepth;
+    if (variant.engine == et_hashLife)
+        // Memoized, without any traffic per cell
+        return 0.0;
+    if (variant.engine == et_cpu)
+        // Rows read once through the ring buffers, written once
+        return 2.0 * sizeof(CPUWord) / gCPUWordBits;
+    if (variant.engine == et_multiDevice || variant.engine == et_streaming)
+        // Packed cells one generation per launch, the halo rows ignored
+        return (9.0 + 1.0) * sizeof(cl_uint) / gPackedWordBits;
+    switch (variant.storage)
+    {
+    case cs_packed:
+    {
+        if (variant.kernel == sk_active)
+            // Every tile active: words and their neighbors, plus the flags of the tile and its neighbors
+            return (9.0 + 1.0) * sizeof(cl_uint) / gPackedWordBits +
+                   10.0 * sizeof(cl_int) / (gActiveWords * gActiveRows * gPackedWordBits);
+        if (generationsPerLaunch == 1)
+            return (9.0 + 1.0) * sizeof(cl_uint) / gPackedWordBits;
+        // Tile and halo read once, tile written once, for all generations of the launch
+        double staged = (gTemporalWords + 2.0) * (gTemporalRows + 2.0 * generationsPerLaunch);
+        double tile = gTemporalWords * gTemporalRows;
+        return (staged / tile + 1.0) * sizeof(cl_uint) / gPackedWordBits / generationsPerLaunch;
+    }
+    case cs_chunked:
+        // Chunks covering the board, as the packed kernel, summaries and tables ignored
+        return (9.0 + 1.0) * sizeof(cl_uint) / gPackedWordBits;
+    case cs_states:
+        return (9.0 + 1.0) * sizeof(cl_ushort);
+    default:
+    {
+        // Alive mask written from the colors, then read by the kernels of the neighbors
+        double mask = sizeof(cl_float4) + sizeof(cl_uchar);
+        // Larger than Life: row scan of the mask, column scan, and mask and 4 sums read per cell
+        if (rule.getRange() > 1)
+            return mask + 2.0 * sizeof(cl_uchar) + 7.0 * sizeof(cl_uint) + sizeof(cl_float4);
+        switch (variant.kernel)
+        {
+        case sk_tiled:
+        {
+            double halo = (gTileWidth + 2.0) * (gTileHeight + 2.0) / (gTileWidth * gTileHeight);
+            return mask + halo * sizeof(cl_uchar) + 2.0 * sizeof(cl_float4) + texture;
+        }
+        case sk_average:
+            return (8.0 + 1.0) * sizeof(cl_float4) + texture;
+        default:
+            return mask + 9.0 * sizeof(cl_uchar) + 2.0 * sizeof(cl_float4) + texture;
+        }
+    }
+    }
+}
+
+void usage()
+{
+    std::cout << "Usage:" << std::endl;
+    std::cout << "  golBench [options]" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  --platform P         OpenCL platform (0)" << std::endl;
+    std::cout << "  --device D           OpenCL device (0)" << std::endl;
+    std::cout << "  --threads N          Threads of the cpu engine, 0 for one per hardware thread (0)" << std::endl;
+    std::cout << "  --kernel-file F      Kernel source (../../gol/Kernel.cl)" << std::endl;
+    std::cout << "  --sizes WxH,...      Board sizes (512x512,1920x1200)" << std::endl;
+    std::cout << "  --kernels K,...      gameOfLife,tiled,average,packed,packedActive,chunked,states,cpuScalar,"
+                 "cpuAVX2,cpuAVX512,hashLife,multiDevice,streaming (all)"
+              << std::endl;
+    std::cout << "  --rule R             Rule of every engine, B3/S23, B2/S/C3, B2-a/S12 or R5,C0,M1,S34..58,B34..45,NM"
+              << std::endl;
+    std::cout << "                       for instance. Only the states kernel runs rules that are not life-like, and"
+              << std::endl;
+    std::cout << "                       the float4 kernels Larger than Life ones" << std::endl;
+    std::cout << "  --workgroups WxH,... Work-group sizes of the untiled kernels, 0 for the runtime's (0)" << std::endl;
+    std::cout << "  --launches N,...     Generations per launch of packed cells, or per pass of streaming (1,"
+              << gTemporalMaxGenerations << ")" << std::endl;
+    std::cout << "  --strip-rows N       Rows of the strips paged through the device by streaming ("
+              << gStreamingStripRows << ")" << std::endl;
+    std::cout << "  --generations N      Generations per run (1000)" << std::endl;
+    std::cout << "  --frames N           Frames read back per run (10)" << std::endl;
+    std::cout << "  --csv, --json        Machine readable output" << std::endl;
+    std::cout << "  --verify             Compares the packed variants with the scalar cpu engine, and the chunked"
+              << std::endl;
+    std::cout << "                       variant with hashLife, cell for cell" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Example:" << std::endl;
+    std::cout << "  golBench --device 0 --sizes 1024x1024 --kernels tiled,packed --csv" << std::endl;
+}
+
+bool parseArguments(int argc, char *argv[])
+{
+    for (int i(1); i < argc; ++i)
+    {
+        std::string argument(argv[i]);
+        std::string value((i + 1 < argc) ? argv[i + 1] : "");
+        if (argument == "--csv")
+            format = of_csv;
+        else if (argument == "--json")
+            format = of_json;
+        else if (argument == "--verify")
+            verification = true;
+        else if (argument == "--help")
+            return false;
+        else if (value.empty())
+            return false;
+        else
+        {
+            ++i;
+            if (argument == "--platform")
+                platform = atoi(value.c_str());
+            else if (argument == "--device")
+                device = atoi(value.c_str());
+            else if (argument == "--threads")
+                threads = atoi(value.c_str());
+            else if (argument == "--kernel-file")
+                kernelFile = value;
+            else if (argument == "--kernels")
+                variantNames = split(value);
+            else if (argument == "--workgroups")
+                workGroups = split(value);
+            else if (argument == "--generations")
+                generations = atoi(value.c_str());
+            else if (argument == "--frames")
+                frames = atoi(value.c_str());
+            else if (argument == "--strip-rows")
+                stripRows = atoi(value.c_str());
+            else if (argument == "--rule")
+            {
+                ruleName = value;
+                if (!rule.parse(value))
+                    return false;
+            }
+            else if (argument == "--sizes")
+            {
+                std::vector<std::string> items = split(value);
+                for (size_t j(0); j < items.size(); ++j)
+                {
+                    BoardSize size;
+                    if (!parseSize(items[j], size.width, size.height))
+                        return false;
+                    sizes.push_back(size);
+                }
+            }
+            else if (argument == "--launches")
+            {
+                std::vector<std::string> items = split(value);
+                for (size_t j(0); j < items.size(); ++j)
+                    launches.push_back(atoi(items[j].c_str()));
+            }
+            else
+                return false;
+        }
+    }
+
+    // Defaults
+    if (sizes.empty())
+    {
+        BoardSize small = {512, 512};
+        BoardSize large = {gTextureWidth, gTextureHeight};
+        sizes.push_back(small);
+        sizes.push_back(large);
+    }
+    if (variantNames.empty())
+        for (size_t i(0); i < sizeof(gVariants) / sizeof(Variant); ++i)
+            variantNames.push_back(gVariants[i].name);
+    if (workGroups.empty())
+        workGroups.push_back("0");
+    if (launches.empty())
+    {
+        launches.push_back(1);
+        launches.push_back(gTemporalMaxGenerations);
+    }
+    return true;
+}
+
+/*
+ * run
+ */
+Result run(SimulationEngine &engine, const BoardSize &size, const Variant &variant, const std::string &workGroup,
+           const int generationsPerLaunch)
+{
+    engine.reset();
+
+    // Seeding and warm-up are not measured
+    engine.step(1);
+
+    double start = now();
+    engine.step(generations);
+    double kernelSeconds = now() - start;
+
+    std::vector<BYTE> bitmap(size.width * size.height * gColorDepth);
+    start = now();
+    for (unsigned int i(0); i < frames; ++i)
+        engine.readback(&bitmap[0]);
+    double transferSeconds = now() - start;
+
+    double cells = static_cast<double>(size.width) * size.height;
+    Result result;
+    result.size = size;
+    result.variant = variant.name;
+    result.workGroup = workGroup;
+    result.generationsPerLaunch = generationsPerLaunch;
+    result.generations = generations;
+    result.kernelSeconds = kernelSeconds;
+    result.transferSeconds = transferSeconds;
+    result.deviceBytes = cells * generations * deviceBytesPerCell(variant, result.generationsPerLaunch);
+    result.transferBytes = cells * gColorDepth * frames;
+    return result;
+}
+
+void printResult(const Result &result, bool first)
+{
+    double cellsPerSecond = static_cast<double>(result.size.width) * result.size.height * result.generations /
+                            ((result.kernelSeconds > 0.0) ? result.kernelSeconds : 1e-9);
+    double totalSeconds = result.kernelSeconds + result.transferSeconds;
+    double kernelShare = (totalSeconds > 0.0) ? 100.0 * result.kernelSeconds / totalSeconds : 0.0;
+    std::stringstream size;
+    size << result.size.width << "x" << result.size.height;
+
+    switch (format)
+    {
+    case of_csv:
+        if (first)
+            std::cout << "size,kernel,workgroup,generationsPerLaunch,generations,kernelSeconds,transferSeconds,"
+                         "cellsPerSecond,deviceBytes,transferBytes"
+                      << std::endl;
+        std::cout << size.str() << "," << result.variant << "," << result.workGroup << ","
+                  << result.generationsPerLaunch << "," << result.generations << "," << result.kernelSeconds << ","
+                  << result.transferSeconds << "," << cellsPerSecond << "," << result.deviceBytes << ","
+                  << result.transferBytes << std::endl;
+        break;
+    case of_json:
+        std::cout << (first ? "[\n" : ",\n") << "  {\"size\": \"" << size.str() << "\", \"kernel\": \""
+                  << result.variant << "\", \"workgroup\": \"" << result.workGroup
+                  << "\", \"generationsPerLaunch\": " << result.generationsPerLaunch
+                  << ", \"generations\": " << result.generations << ", \"kernelSeconds\": " << result.kernelSeconds
+                  << ", \"transferSeconds\": " << result.transferSeconds << ", \"cellsPerSecond\": " << cellsPerSecond
+                  << ", \"deviceBytes\": " << result.deviceBytes << ", \"transferBytes\": " << result.transferBytes
+                  << "}";
+        break;
+    default:
+        if (first)
+            std::cout << std::left << std::setw(12) << "Size" << std::setw(14) << "Kernel" << std::setw(10)
+                      << "WorkGroup" << std::setw(8) << "Launch" << std::setw(14) << "Gcells/s" << std::setw(14)
+                      << "Device GB" << std::setw(14) << "Transfer MB" << std::setw(12) << "Kernel ms"
+                      << std::setw(12) << "Transfer ms" << "Kernel %" << std::endl;
+        std::cout << std::left << std::setw(12) << size.str() << std::setw(14) << result.variant << std::setw(10)
+                  << result.workGroup << std::setw(8) << result.generationsPerLaunch << std::setw(14) << std::fixed
+                  << std::setprecision(3) << cellsPerSecond / 1e9 << std::setw(14) << result.deviceBytes / 1e9
+                  << std::setw(14) << result.transferBytes / 1e6 << std::setw(12) << result.kernelSeconds * 1e3
+                  << std::setw(12) << result.transferSeconds * 1e3 << std::setprecision(1) << kernelShare
+                  << std::endl;
+        break;
+    }
+}
+
+/*
+ * verify
+ */
+bool verify(const BoardSize &size, std::vector<BYTE> &texture)
+{
+    if (!rule.isLifeLike())
+    {
+        std::cerr << "Only life-like rules can be verified" << std::endl;
+        return false;
+    }
+
+    // Reference: scalar cpu engine
+    std::vector<cl_uint> expected;
+    CPUEngine reference(threads);
+    reference.setInstructionSet(cis_scalar);
+    reference.initializeDevice(size.width, size.height);
+    reference.setTexture(0, &texture[0]);
+    reference.setLimit(0.5f);
+    reference.setRule(rule.getBirth(), rule.getSurvival());
+    reference.step(generations);
+    reference.saveState(expected);
+
+    // Reference of the unbounded board, computed when needed: HashLife
+    std::vector<cl_uint> unbounded;
+
+    bool success(true);
+    for (size_t i(0); i < sizeof(gVariants) / sizeof(Variant); ++i)
+    {
+        const Variant &variant = gVariants[i];
+        // HashLife is the reference of the unbounded board
+        if (variant.storage == cs_float4 || variant.engine == et_hashLife ||
+            std::find(variantNames.begin(), variantNames.end(), variant.name) == variantNames.end())
+            continue;
+
+        // Chunks evolve an unbounded plane, cells leaving the board are not dead
+        if (variant.storage == cs_chunked && unbounded.empty())
+        {
+            HashLifeEngine hashLife;
+            hashLife.initializeDevice(size.width, size.height);
+            hashLife.setTexture(0, &texture[0]);
+            hashLife.setLimit(0.5f);
+            if (!hashLife.setRule(rule.getBirth(), rule.getSurvival()))
+            {
+                std::cerr << "Skipping " << variant.name << ": " << rule.getName() << " has no HashLife reference"
+                          << std::endl;
+                continue;
+            }
+            hashLife.step(generations);
+            hashLife.saveState(unbounded);
+        }
+        const std::vector<cl_uint> &reference = (variant.storage == cs_chunked) ? unbounded : expected;
+
+        // Every generations per launch of the packed kernel
+        std::vector<std::vector<cl_uint> > states;
+        std::vector<std::string> names;
+        if (variant.engine == et_cpu)
+        {
+            CPUEngine engine(threads);
+            if (!engine.setInstructionSet(variant.instructionSet))
+                continue;
+            engine.initializeDevice(size.width, size.height);
+            engine.setTexture(0, &texture[0]);
+            engine.setLimit(0.5f);
+            engine.setRule(rule.getBirth(), rule.getSurvival());
+            engine.step(generations);
+            states.push_back(std::vector<cl_uint>());
+            engine.saveState(states.back());
+            names.push_back(variant.name);
+        }
+        else if (variant.engine == et_multiDevice)
+        {
+            std::stringstream name;
+            MultiDeviceEngine engine(platform);
+            engine.compileKernels(kst_file, kernelFile);
+            engine.initializeDevice(size.width, size.height);
+            engine.setTexture(0, &texture[0]);
+            engine.setLimit(0.5f);
+            engine.setRule(rule.getBirth(), rule.getSurvival());
+            engine.step(generations);
+            states.push_back(std::vector<cl_uint>());
+            engine.saveState(states.back());
+            name << variant.name << "/" << engine.getStripCount();
+            names.push_back(name.str());
+        }
+        else if (variant.engine == et_streaming)
+        {
+            StreamingEngine engine(platform, device);
+            engine.compileKernels(kst_file, kernelFile);
+            engine.setStripRows(stripRows);
+            for (size_t l(0); l < launches.size(); ++l)
+            {
+                std::stringstream name;
+                engine.setGenerationsPerPass(launches[l]);
+                engine.initializeDevice(size.width, size.height);
+                engine.setTexture(0, &texture[0]);
+                engine.setLimit(0.5f);
+                engine.setRule(rule.getBirth(), rule.getSurvival());
+                engine.step(generations);
+                states.push_back(std::vector<cl_uint>());
+                engine.saveState(states.back());
+                name << variant.name << "/" << engine.getGenerationsPerPass();
+                names.push_back(name.str());
+            }
+        }
+        else
+        {
+            OpenCLKernel kernel(platform, device, 128, 1);
+            kernel.initializeDevice(size.width, size.height, variant.storage);
+            kernel.compileKernels(kst_file, kernelFile, "", "");
+            kernel.setTexture(0, &texture[0]);
+            kernel.setLimit(0.5f);
+            kernel.setSimulationKernel(variant.kernel);
+            kernel.setRule(rule);
+            // Active tiles, chunks and states advance one generation per launch
+            bool single = (variant.kernel == sk_active || variant.storage != cs_packed);
+            for (size_t l(0); l < (single ? 1 : launches.size()); ++l)
+            {
+                std::stringstream name;
+                kernel.setGenerationsPerLaunch(single ? 1 : launches[l]);
+                kernel.reset();
+                kernel.step(generations);
+                states.push_back(std::vector<cl_uint>());
+                kernel.saveState(states.back());
+                name << variant.name << "/" << kernel.getGenerationsPerLaunch();
+                names.push_back(name.str());
+            }
+        }
+
+        for (size_t j(0); j < states.size(); ++j)
+        {
+            size_t differences(0);
+            for (size_t k(0); k < reference.size(); ++k)
+            {
+                cl_uint bits = (k < states[j].size()) ? (reference[k] ^ states[j][k]) : reference[k];
+                for (; bits != 0; bits &= bits - 1)
+                    ++differences;
+            }
+            std::cout << size.width << "x" << size.height << " " << names[j] << ": "
+                      << ((differences == 0) ? "ok" : "FAILED") << " (" << differences << " cells differ after "
+                      << generations << " generations)" << std::endl;
+            success = success && (differences == 0) && (states[j].size() == reference.size());
+        }
+    }
+    return success;
+}
+
+int main(int argc, char *argv[])
+{
+    if (!parseArguments(argc, argv))
+    {
+        usage();
+        return 1;
+    }
+
+    // Random texture, so that about half of the cells start alive
+    std::vector<BYTE> texture(gTextureWidth * gTextureHeight * gColorDepth);
+    srand(0);
+    for (size_t i(0); i < texture.size(); ++i)
+        texture[i] = static_cast<BYTE>(rand() % 256);
+
+    if (verification)
+    {
+        bool success(true);
+        for (size_t s(0); s < sizes.size(); ++s)
+            success = verify(sizes[s], texture) && success;
+        return success ? 0 : 1;
+    }
+
+    bool first(true);
+    for (size_t s(0); s < sizes.size(); ++s)
+    {
+        // One engine per storage, shared by the variants using it
+        const EngineType engines[] = {et_opencl, et_opencl,   et_opencl,      et_opencl,
+                                      et_cpu,    et_hashLife, et_multiDevice, et_streaming};
+        const CellStorage storages[] = {cs_float4, cs_packed, cs_chunked, cs_states,
+                                        cs_packed, cs_packed, cs_packed,  cs_packed};
+        for (size_t t(0); t < sizeof(storages) / sizeof(CellStorage); ++t)
+        {
+            std::vector<Variant> variants;
+            for (size_t i(0); i < sizeof(gVariants) / sizeof(Variant); ++i)
+                for (size_t j(0); j < variantNames.size(); ++j)
+                    if (gVariants[i].name == variantNames[j] && gVariants[i].engine == engines[t] &&
+                        gVariants[i].storage == storages[t])
+                        variants.push_back(gVariants[i]);
+            if (variants.empty())
+                continue;
+
+            // The cpu, HashLife, multi-device and streaming engines only run life-like rules
+            if (engines[t] != et_opencl && !rule.isLifeLike())
+            {
+                std::cerr << "Skipping " << variants[0].name << ": " << rule.getName() << " is not life-like"
+                          << std::endl;
+                continue;
+            }
+
+            if (engines[t] == et_cpu)
+            {
+                CPUEngine engine(threads);
+                engine.initializeDevice(sizes[s].width, sizes[s].height, storages[t]);
+                engine.setTexture(0, &texture[0]);
+                engine.setLimit(0.5f);
+                engine.setRule(rule.getBirth(), rule.getSurvival());
+                std::stringstream workGroup;
+                workGroup << engine.getThreadCount() << "t";
+                for (size_t v(0); v < variants.size(); ++v)
+                {
+                    if (!engine.setInstructionSet(variants[v].instructionSet))
+                    {
+                        std::cerr << "Skipping " << variants[v].name << ": not supported" << std::endl;
+                        continue;
+                    }
+                    printResult(run(engine, sizes[s], variants[v], workGroup.str(), 1), first);
+                    first = false;
+                }
+                continue;
+            }
+
+            // The pattern evolves on an unbounded plane, memory being the node cache
+            if (engines[t] == et_hashLife)
+            {
+                HashLifeEngine engine;
+                engine.initializeDevice(sizes[s].width, sizes[s].height, storages[t]);
+                engine.setTexture(0, &texture[0]);
+                engine.setLimit(0.5f);
+                if (!engine.setRule(rule.getBirth(), rule.getSurvival()))
+                {
+                    std::cerr << "Skipping " << variants[0].name << ": " << rule.getName() << " is not supported"
+                              << std::endl;
+                    continue;
+                }
+                for (size_t v(0); v < variants.size(); ++v)
+                {
+                    printResult(run(engine, sizes[s], variants[v], "-", 1), first);
+                    first = false;
+                }
+                continue;
+            }
+
+            // One strip per device of the platform
+            if (engines[t] == et_multiDevice)
+            {
+                MultiDeviceEngine engine(platform);
+                engine.compileKernels(kst_file, kernelFile);
+                engine.initializeDevice(sizes[s].width, sizes[s].height, storages[t]);
+                engine.setTexture(0, &texture[0]);
+                engine.setLimit(0.5f);
+                engine.setRule(rule.getBirth(), rule.getSurvival());
+                std::stringstream workGroup;
+                workGroup << engine.getStripCount() << "d";
+                for (size_t v(0); v < variants.size(); ++v)
+                {
+                    printResult(run(engine, sizes[s], variants[v], workGroup.str(), 1), first);
+                    first = false;
+                }
+                continue;
+            }
+
+            // Strips of rows paged through the device, the launches being the generations of a pass
+            if (engines[t] == et_streaming)
+            {
+                StreamingEngine engine(platform, device);
+                engine.compileKernels(kst_file, kernelFile);
+                engine.setStripRows(stripRows);
+                std::stringstream workGroup;
+                workGroup << engine.getStripRows() << "r";
+                for (size_t v(0); v < variants.size(); ++v)
+                    for (size_t l(0); l < launches.size(); ++l)
+                    {
+                        engine.setGenerationsPerPass(launches[l]);
+                        engine.initializeDevice(sizes[s].width, sizes[s].height, storages[t]);
+                        engine.setTexture(0, &texture[0]);
+                        engine.setLimit(0.5f);
+                        engine.setRule(rule.getBirth(), rule.getSurvival());
+                        printResult(run(engine, sizes[s], variants[v], workGroup.str(),
+                                        engine.getGenerationsPerPass()),
+                                    first);
+                        first = false;
+                    }
+                continue;
+            }
+
+            OpenCLKernel kernel(platform, device, 128, 1);
+            kernel.initializeDevice(sizes[s].width, sizes[s].height, storages[t]);
+            kernel.compileKernels(kst_file, kernelFile, "", "");
+            kernel.setTexture(0, &texture[0]);
+            kernel.setLimit(0.5f);
+            if (!ruleName.empty() && !kernel.setRule(rule))
+            {
+                std::cerr << "Skipping " << variants[0].name << ": " << rule.getName() << " is not supported"
+                          << std::endl;
+                continue;
+            }
+
+            for (size_t v(0); v < variants.size(); ++v)
+            {
+                bool tiled = (variants[v].storage == cs_float4 && variants[v].kernel == sk_tiled) ||
+                             variants[v].kernel == sk_active || variants[v].storage == cs_chunked;
+                for (size_t w(0); w < (tiled ? 1 : workGroups.size()); ++w)
+                {
+                    bool packed = (variants[v].storage == cs_packed && variants[v].kernel != sk_active);
+                    for (size_t l(0); l < (packed ? launches.size() : 1); ++l)
+                    {
+                        // Temporal blocking uses its own tiles
+                        if (packed && launches[l] > 1 && w > 0)
+                            continue;
+                        int x(0);
+                        int y(0);
+                        if (!parseSize(workGroups[w], x, y))
+                            x = y = 0;
+                        kernel.setSimulationKernel(variants[v].kernel);
+                        kernel.setLocalWorkSize(x, y);
+                        kernel.setGenerationsPerLaunch(packed ? launches[l] : 1);
+
+                        Result result = run(kernel, sizes[s], variants[v], tiled ? "tile" : workGroups[w],
+                                            kernel.getGenerationsPerLaunch());
+                        printResult(result, first);
+                        first = false;
+                    }
+                }
+            }
+        }
+    }
+    if (format == of_json && !first)
+        std::cout << "\n]" << std::endl;
+    return 0;
+}
@@ -0,0 +1,286 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Board split over the ranks of an MPI job: mpirun -np N golMPI [options]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <CPUEngine.h>
+#include <DistributedEngine.h>
+#include <OpenCLKernel.h>
+
+// Settings
+bool opencl = false;
+int platform = 0;
+int device = 0;
+int threads = 0;
+std::string kernelFile = "../../gol/Kernel.cl";
+int width = 4096;
+int height = 4096;
+unsigned int generations = 1000;
+Rule rule;
+std::string checkpoint;
+std::string restart;
+bool verification = false;
+
+double now()
+{
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+}
+
+void usage()
+{
+    std::cout << "Usage:" << std::endl;
+    std::cout << "  mpirun -np N golMPI [options]" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  --engine E           Engine of every tile, cpu or opencl (cpu)" << std::endl;
+    std::cout << "  --platform P         OpenCL platform (0)" << std::endl;
+    std::cout << "  --device D           OpenCL device of every rank (0)" << std::endl;
+    std::cout << "  --threads N          Threads of the cpu engine of every rank, 0 for one per hardware thread (0)"
+              << std::endl;
+    std::cout << "  --kernel-file F      Kernel source (../../gol/Kernel.cl)" << std::endl;
+    std::cout << "  --size WxH           Board size (4096x4096)" << std::endl;
+    std::cout << "  --rule R             Life-like rule, B3/S23 for instance" << std::endl;
+    std::cout << "  --generations N      Generations (1000)" << std::endl;
+    std::cout << "  --restart F          Starts from a checkpoint instead of the seed" << std::endl;
+    std::cout << "  --checkpoint F       Writes a checkpoint after the last generation" << std::endl;
+    std::cout << "  --verify             Compares the board and its checkpoint with the scalar cpu engine of rank 0,"
+              << std::endl;
+    std::cout << "                       cell for cell" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Example:" << std::endl;
+    std::cout << "  mpirun -np 4 golMPI --size 8192x8192 --generations 100 --checkpoint board.gol" << std::endl;
+}
+
+bool parseArguments(int argc, char *argv[])
+{
+    for (int i(1); i < argc; ++i)
+    {
+        std::string argument(argv[i]);
+        std::string value((i + 1 < argc) ? argv[i + 1] : "");
+        if (argument == "--verify")
+            verification = true;
+        else if (argument == "--help")
+            return false;
+        else if (value.empty())
+            return false;
+        else
+        {
+            ++i;
+            if (argument == "--engine")
+            {
+                if (value != "cpu" && value != "opencl")
+                    return false;
+                opencl = (value == "opencl");
+            }
+            else if (argument == "--platform")
+                platform = atoi(value.c_str());
+            else if (argument == "--device")
+                device = atoi(value.c_str());
+            else if (argument == "--threads")
+                threads = atoi(value.c_str());
+            else if (argument == "--kernel-file")
+                kernelFile = value;
+            else if (argument == "--size")
+            {
+                if (sscanf(value.c_str(), "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0)
+                    return false;
+            }
+            else if (argument == "--rule")
+            {
+                if (!rule.parse(value) || !rule.isLifeLike())
+                    return false;
+            }
+            else if (argument == "--generations")
+                generations = atoi(value.c_str());
+            else if (argument == "--restart")
+                restart = value;
+            else if (argument == "--checkpoint")
+                checkpoint = value;
+            else
+                return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * verify: runs the whole board on rank 0, and compares it with the distributed board and its checkpoint
+ */
+bool verify(DistributedEngine &engine, std::vector<BYTE> &texture)
+{
+    // Reference: scalar cpu engine, from the same seed or checkpoint
+    std::vector<cl_uint> expected;
+    if (engine.getRank() == 0)
+    {
+        CPUEngine reference(threads);
+        reference.setInstructionSet(cis_scalar);
+        reference.initializeDevice(width, height);
+        reference.setTexture(0, &texture[0]);
+        reference.setLimit(0.5f);
+        reference.setRule(rule.getBirth(), rule.getSurvival());
+        if (!restart.empty())
+        {
+            std::vector<cl_uint> cells;
+            FILE *file = fopen(restart.c_str(), "rb");
+            cl_int header[2];
+            cells.resize(packedWords(width) * height);
+            if (file != NULL && fread(header, sizeof(cl_int), 2, file) == 2 &&
+                fread(&cells[0], sizeof(cl_uint), cells.size(), file) == cells.size())
+                reference.loadState(cells);
+            if (file != NULL)
+                fclose(file);
+        }
+        reference.step(generations);
+        reference.saveState(expected);
+    }
+
+    // Distributed board, then its checkpoint, read back by rank 0
+    std::string fileName = checkpoint.empty() ? "golMPI.verify" : checkpoint;
+    unsigned long long population = engine.getPopulation();
+    unsigned long long checksum = engine.getChecksum();
+    bool saved = engine.saveCheckpoint(fileName);
+    if (engine.getRank() != 0)
+        return true;
+
+    unsigned long long expectedPopulation(0);
+    for (size_t i(0); i < expected.size(); ++i)
+        for (cl_uint bits = expected[i]; bits != 0; bits &= bits - 1)
+            ++expectedPopulation;
+    unsigned long long expectedChecksum = DistributedEngine::checksum(expected, width, height);
+
+    size_t differences(0);
+    std::vector<cl_uint> cells(expected.size(), 0);
+    FILE *file = fopen(fileName.c_str(), "rb");
+    cl_int header[2] = {0, 0};
+    bool read = (file != NULL && fread(header, sizeof(cl_int), 2, file) == 2 &&
+                 fread(&cells[0], sizeof(cl_uint), cells.size(), file) == cells.size());
+    if (file != NULL)
+        fclose(file);
+    if (checkpoint.empty())
+        remove(fileName.c_str());
+    for (size_t i(0); i < expected.size(); ++i)
+        for (cl_uint bits = expected[i] ^ cells[i]; bits != 0; bits &= bits - 1)
+            ++differences;
+
+    bool success = (population == expectedPopulation && checksum == expectedChecksum && saved && read &&
+                    header[0] == width && header[1] == height && differences == 0);
+    std::cout << width << "x" << height << " over " << engine.getGridWidth() << "x" << engine.getGridHeight()
+              << " ranks: " << (success ? "ok" : "FAILED") << " (population " << population << "/"
+              << expectedPopulation << ", checksum " << std::hex << checksum << "/" << expectedChecksum << std::dec
+              << ", " << differences << " cells of the checkpoint differ after " << generations << " generations)"
+              << std::endl;
+    return success;
+}
+
+int run(SimulationEngine &tileEngine)
+{
+    int ranks(0);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    // Random texture, so that about half of the cells start alive
+    std::vector<BYTE> texture(gTextureWidth * gTextureHeight * gColorDepth);
+    srand(0);
+    for (size_t i(0); i < texture.size(); ++i)
+        texture[i] = static_cast<BYTE>(rand() % 256);
+
+    DistributedEngine engine(MPI_COMM_WORLD, tileEngine);
+    if (!engine.initialize(width, height))
+        return 1;
+    if (opencl)
+        static_cast<OpenCLKernel &>(tileEngine).compileKernels(kst_file, kernelFile, "", "");
+    engine.setTexture(&texture[0]);
+    engine.setLimit(0.5f);
+    if (!engine.setRule(rule.getBirth(), rule.getSurvival()))
+    {
+        std::cerr << "Rule " << rule.getName() << " is not supported by the engine" << std::endl;
+        return 1;
+    }
+    if (!restart.empty() && !engine.loadCheckpoint(restart))
+        return 1;
+
+    if (verification)
+    {
+        engine.step(generations);
+        int success = verify(engine, texture) ? 1 : 0;
+        MPI_Bcast(&success, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        return success ? 0 : 1;
+    }
+
+    // Seeding is not measured
+    engine.step(0);
+    MPI_Barrier(MPI_COMM_WORLD);
+    double start = now();
+    engine.step(generations);
+    MPI_Barrier(MPI_COMM_WORLD);
+    double seconds = now() - start;
+
+    unsigned long long population = engine.getPopulation();
+    unsigned long long checksum = engine.getChecksum();
+    if (!checkpoint.empty() && !engine.saveCheckpoint(checkpoint))
+        return 1;
+
+    if (engine.getRank() == 0)
+    {
+        double cells = static_cast<double>(width) * height * generations;
+        std::cout << width << "x" << height << " over " << engine.getGridWidth() << "x" << engine.getGridHeight()
+                  << " ranks, " << engine.getGhostCells() << " ghost cells: " << generations << " generations in "
+                  << std::fixed << std::setprecision(3) << seconds << " s, " << cells / 1e9 / seconds
+                  << " Gcells/s, population " << population << ", checksum " << std::hex << checksum << std::dec
+                  << std::endl;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    MPI_Init(&argc, &argv);
+    int rank(0);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    if (!parseArguments(argc, argv))
+    {
+        if (rank == 0)
+            usage();
+        MPI_Finalize();
+        return 1;
+    }
+
+    int result(0);
+    if (opencl)
+    {
+        OpenCLKernel kernel(platform, device, 128, 1);
+        result = run(kernel);
+    }
+    else
+    {
+        CPUEngine engine(threads);
+        result = run(engine);
+    }
+    MPI_Finalize();
+    return result;
+}
@@ -49,9 +49,21 @@ int device = 0;
 
 // Scene
 float transparentColor = 0.1f;
+CellStorage cellStorage = cs_states;
+// Rule of the kernels, their own one when empty
+std::string ruleName;
+// RLE or macrocell pattern seeding the board instead of the texture, and giving the rule when none is set
+std::string patternName;
+// Generations enqueued since the scene was created or resumed
+cl_ulong generation = 0;
+
+// Snapshots
+const std::string snapshotFileName = "golViewer.snapshot";
+SnapshotWriter snapshotWriter;
+bool snapshotPending = false;
+cl_ulong snapshotGeneration = 0;
 
 // OpenGL
-GLubyte *ubImage;
 int previousFps = 0;
 
 /**
@@ -68,6 +80,8 @@ void mouse(int button, int state, int x, int y);
 void motion(int x, int y);
 void timerEvent(int value);
 void createScene(int platform, int device);
+void writeSnapshot();
+void resumeSnapshot();
 
 // Helpers
 void TestNoGL();
@@ -113,10 +127,6 @@ setup the window and assign callbacks
 */
 void initgl(int argc, char **argv)
 {
-    size_t len(window_width * window_height * window_depth);
-    ubImage = new GLubyte[len];
-    memset(ubImage, 0, len);
-
     glutInit(&argc, (char **)argv);
     glutInitDisplayMode(GLUT_RGBA | GLUT_DOUBLE);
 
@@ -134,7 +144,7 @@ void initgl(int argc, char **argv)
     return;
 }
 
-void TexFunc(void)
+void TexFunc(const GLubyte *image)
 {
     glEnable(GL_TEXTURE_2D);
     glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -142,7 +152,7 @@ void TexFunc(void)
     glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_DECAL);
 
-    glTexImage2D(GL_TEXTURE_2D, 0, 3, window_width, window_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, ubImage);
+    glTexImage2D(GL_TEXTURE_2D, 0, 3, window_width, window_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
 
     glBegin(GL_QUADS);
     glTexCoord2f(1.0, 1.0);
@@ -167,18 +177,49 @@ void display()
 
     char text[255];
     long t = GetTickCount();
-    oclKernel->render(window_width, window_height, (BYTE *)ubImage, transparentColor);
+    // Keep the pipeline full: the next generations are computed and read back while this frame is drawn
+    oclKernel->setLimit(transparentColor);
+    while (oclKernel->enqueueFrame(1))
+    {
+        ++generation;
+    }
+    const GLubyte *image = oclKernel->acquireFrame();
+    if (snapshotPending)
+        writeSnapshot();
     t = GetTickCount() - t;
     sprintf(text, "OpenCL GameOfLife (%d Fps)", 1000 / ((t + previousFps) / 2));
     previousFps = t;
 
-    TexFunc();
+    if (image)
+        TexFunc(image);
+    oclKernel->releaseFrame();
     glutSetWindowTitle(text);
     glFlush();
 
     glutSwapBuffers();
 }
 
+void writeSnapshot()
+{
+    // Encoded and written in the background, the read back being complete by now
+    const Rule &rule = oclKernel->getRule();
+    SnapshotInfo info = {static_cast<cl_int>(window_width), static_cast<cl_int>(window_height), snapshotGeneration,
+                         rule.getBirth(), rule.getSurvival()};
+    std::vector<cl_uint> cells;
+    oclKernel->acquireSnapshot(cells);
+    snapshotWriter.write(snapshotFileName, info, cells);
+    snapshotPending = false;
+}
+
+void resumeSnapshot()
+{
+    Snapshot snapshot;
+    if (!snapshot.open(snapshotFileName) || !oclKernel->loadSnapshot(snapshot))
+        return;
+    generation = snapshot.getInfo().generation;
+    std::cout << "Resumed generation " << generation << " of rule " << oclKernel->getRule().getName() << std::endl;
+}
+
 void timerEvent(int value)
 {
     glutPostRedisplay();
@@ -212,6 +253,19 @@ void keyboard(unsigned char key, int x, int y)
         // Reset scene
         delete oclKernel;
         oclKernel = 0;
+        snapshotPending = false;
+        createScene(platform, device);
+        createTextures();
+        break;
+    }
+    case 'M':
+    case 'm':
+    {
+        // Cycle through cell states, float4 and packed cells, and reset scene
+        cellStorage = (cellStorage == cs_states) ? cs_float4 : ((cellStorage == cs_float4) ? cs_packed : cs_states);
+        delete oclKernel;
+        oclKernel = 0;
+        snapshotPending = false;
         createScene(platform, device);
         createTextures();
         break;
@@ -230,6 +284,25 @@ void keyboard(unsigned char key, int x, int y)
         transparentColor = (transparentColor < 0.f) ? 0.f : transparentColor;
         break;
     }
+    case 'K':
+    case 'k':
+    {
+        // Checkpoint the current generation, the board advancing while it is read back and written
+        if (!snapshotPending && oclKernel->enqueueSnapshot())
+        {
+            snapshotPending = true;
+            snapshotGeneration = generation;
+        }
+        break;
+    }
+    case 'U':
+    case 'u':
+    {
+        // Resume from the last checkpoint
+        snapshotWriter.wait();
+        resumeSnapshot();
+        break;
+    }
     case 'F':
     case 'f':
     {
@@ -288,8 +361,18 @@ void Cleanup(int iExitCode)
 {
     // Cleanup allocated objects
     std::cout << "\nStarting Cleanup...\n\n" << std::endl;
-    if (ubImage)
-        delete[] ubImage;
+    if (oclKernel)
+    {
+        // The board survives the viewer as a checkpoint
+        if (!snapshotPending && oclKernel->enqueueSnapshot())
+        {
+            snapshotPending = true;
+            snapshotGeneration = generation;
+        }
+        if (snapshotPending)
+            writeSnapshot();
+        snapshotWriter.wait();
+    }
     delete oclKernel;
 
     exit(iExitCode);
@@ -300,8 +383,22 @@ void createScene(int platform, int device)
     srand(static_cast<unsigned int>(time(NULL)));
 
     oclKernel = new OpenCLKernel(platform, device, 128, draft);
-    oclKernel->initializeDevice(window_width, window_height);
+    generation = 0;
+    oclKernel->initializeDevice(window_width, window_height, cellStorage);
     oclKernel->compileKernels(kst_file, "../../gol/Kernel.cl", "", "");
+
+    Pattern pattern;
+    bool patternOpened = !patternName.empty() && pattern.open(patternName);
+    std::string name = (ruleName.empty() && patternOpened) ? pattern.getRule() : ruleName;
+
+    Rule rule;
+    if (!name.empty() && rule.parse(name))
+        oclKernel->setRule(rule);
+    else if (!name.empty())
+        std::cout << "Invalid rule " << name << std::endl;
+
+    if (patternOpened)
+        oclKernel->loadPattern(pattern);
 }
 
 void main(int argc, char *argv[])
@@ -316,6 +413,9 @@ void main(int argc, char *argv[])
     std::cout << "  p: add plan (single faced)" << std::endl;
     std::cout << "  l: add lamp" << std::endl;
     std::cout << "  r: reset scene" << std::endl;
+    std::cout << "  m: cycle through cell states, float4 and packed cells" << std::endl;
+    std::cout << "  k: checkpoint the board into " << snapshotFileName << std::endl;
+    std::cout << "  u: resume from the checkpoint" << std::endl;
     std::cout << "Mouse:" << std::endl;
     std::cout << "  left       : Zoom in/out" << std::endl;
     std::cout << "  middle     : Rotate" << std::endl;
@@ -325,19 +425,23 @@ void main(int argc, char *argv[])
     std::cout << "---------------------------------------------------------------"
                  "-----------------"
               << std::endl;
-    if (argc == 5)
+    if (argc >= 5 && argc <= 7)
     {
         std::cout << argv[1] << std::endl;
         sscanf_s(argv[1], "%d", &platform);
         sscanf_s(argv[2], "%d", &device);
         sscanf_s(argv[3], "%d", &window_width);
         sscanf_s(argv[4], "%d", &window_height);
+        if (argc >= 6)
+            ruleName = argv[5];
+        if (argc == 7)
+            patternName = argv[6];
     }
     else
     {
         std::cout << "Usage:" << std::endl;
         std::cout << "  golViewer [platformId] [deviceId] "
-                     "[WindowWidth] [WindowHeight]"
+                     "[WindowWidth] [WindowHeight] [Rule] [Pattern]"
                   << std::endl;
         std::cout << std::endl;
         std::cout << "Example:" << std::endl;
@@ -0,0 +1,285 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <cstring>
+#include <iostream>
+
+#include "BoardBatch.h"
+#include "OpenCLStatus.h"
+
+BoardBatch::BoardBatch(OpenCLKernel &engine)
+    : m_engine(engine)
+    , m_hInitKernel(0)
+    , m_hBatchKernel(0)
+    , m_hStatisticsKernel(0)
+    , m_hCells(0)
+    , m_hParameters(0)
+    , m_hStatistics(0)
+    , m_hCounters(0)
+    , m_width(0)
+    , m_height(0)
+    , m_wordsPerRow(0)
+    , m_offset(-1)
+{
+    int status(0);
+    m_hInitKernel = clCreateKernel(engine.getCLProgram(), "batch_init_kernel", &status);
+    CHECKSTATUS(status);
+    m_hBatchKernel = clCreateKernel(engine.getCLProgram(), "batch_kernel", &status);
+    CHECKSTATUS(status);
+    m_hStatisticsKernel = clCreateKernel(engine.getCLProgram(), "batch_statistics_kernel", &status);
+    CHECKSTATUS(status);
+    for (int i(0); i < 3; ++i)
+        m_localWorkSize[i] = m_globalWorkSize[i] = 0;
+}
+
+BoardBatch::~BoardBatch()
+{
+    release();
+    if (m_hInitKernel)
+        CHECKSTATUS(clReleaseKernel(m_hInitKernel));
+    if (m_hBatchKernel)
+        CHECKSTATUS(clReleaseKernel(m_hBatchKernel));
+    if (m_hStatisticsKernel)
+        CHECKSTATUS(clReleaseKernel(m_hStatisticsKernel));
+}
+
+void BoardBatch::release()
+{
+    cl_mem buffers[] = {m_hCells, m_hParameters, m_hStatistics, m_hCounters};
+    for (size_t i(0); i < sizeof(buffers) / sizeof(cl_mem); ++i)
+        if (buffers[i])
+            CHECKSTATUS(clReleaseMemObject(buffers[i]));
+    m_hCells = m_hParameters = m_hStatistics = m_hCounters = 0;
+    m_boards.clear();
+    m_offset = -1;
+}
+
+// ---------- Boards ----------
+/*
+ * initialize
+ */
+void BoardBatch::initialize(const int width, const int height, const std::vector<BoardParameters> &boards)
+{
+    release();
+    if (boards.empty())
+        return;
+
+    int status(0);
+    m_boards = boards;
+    m_width = width;
+    m_height = height;
+    m_wordsPerRow = packedWords(width);
+    size_t count = boards.size();
+    size_t boardWords = m_wordsPerRow * height;
+    cl_context context = m_engine.getCLContext();
+    m_hCells = clCreateBuffer(context, CL_MEM_READ_WRITE, 2 * count * boardWords * sizeof(cl_uint), 0, &status);
+    CHECKSTATUS(status);
+    m_hParameters = clCreateBuffer(context, CL_MEM_READ_ONLY, count * sizeof(cl_uint4), 0, &status);
+    CHECKSTATUS(status);
+    m_hStatistics = clCreateBuffer(context, CL_MEM_READ_WRITE, count * sizeof(cl_uint4), 0, &status);
+    CHECKSTATUS(status);
+    m_hCounters = clCreateBuffer(context, CL_MEM_READ_WRITE, 2 * count * sizeof(cl_uint), 0, &status);
+    CHECKSTATUS(status);
+
+    // The limit is passed as the bits of a float
+    std::vector<cl_uint4> parameters(count);
+    for (size_t i(0); i < count; ++i)
+    {
+        parameters[i].s[0] = boards[i].birth;
+        parameters[i].s[1] = boards[i].survival;
+        parameters[i].s[2] = boards[i].seed;
+        memcpy(&parameters[i].s[3], &boards[i].limit, sizeof(cl_uint));
+    }
+    CHECKSTATUS(clEnqueueWriteBuffer(m_engine.getCLQueue(), m_hParameters, CL_TRUE, 0,
+                                     parameters.size() * sizeof(cl_uint4), &parameters[0], 0, NULL, NULL));
+
+    // Work-groups lie in a single board, the rows of small boards sharing a work-group
+    m_localWorkSize[0] = (m_wordsPerRow < gBatchGroupWords) ? m_wordsPerRow : gBatchGroupWords;
+    m_localWorkSize[1] = gBatchGroupSize / m_localWorkSize[0];
+    m_localWorkSize[1] = (static_cast<size_t>(height) < m_localWorkSize[1]) ? height : m_localWorkSize[1];
+    m_localWorkSize[2] = 1;
+    m_globalWorkSize[0] = (m_wordsPerRow + m_localWorkSize[0] - 1) / m_localWorkSize[0] * m_localWorkSize[0];
+    m_globalWorkSize[1] = (height + m_localWorkSize[1] - 1) / m_localWorkSize[1] * m_localWorkSize[1];
+    m_globalWorkSize[2] = count;
+
+    cl_kernel kernels[] = {m_hInitKernel, m_hBatchKernel};
+    for (size_t i(0); i < sizeof(kernels) / sizeof(cl_kernel); ++i)
+    {
+        CHECKSTATUS(clSetKernelArg(kernels[i], 0, sizeof(cl_int), (void *)&m_width));
+        CHECKSTATUS(clSetKernelArg(kernels[i], 1, sizeof(cl_int), (void *)&m_height));
+        CHECKSTATUS(clSetKernelArg(kernels[i], 2, sizeof(cl_int), (void *)&m_wordsPerRow));
+        CHECKSTATUS(clSetKernelArg(kernels[i], 3, sizeof(cl_mem), (void *)&m_hCells));
+    }
+    CHECKSTATUS(clSetKernelArg(m_hInitKernel, 4, sizeof(cl_mem), (void *)&m_hParameters));
+    CHECKSTATUS(clSetKernelArg(m_hInitKernel, 5, sizeof(cl_mem), (void *)&m_hCounters));
+    CHECKSTATUS(clSetKernelArg(m_hBatchKernel, 5, sizeof(cl_mem), (void *)&m_hParameters));
+    CHECKSTATUS(clSetKernelArg(m_hBatchKernel, 6, sizeof(cl_mem), (void *)&m_hStatistics));
+    CHECKSTATUS(clSetKernelArg(m_hBatchKernel, 7, sizeof(cl_mem), (void *)&m_hCounters));
+
+    cl_int boardCount = static_cast<cl_int>(count);
+    CHECKSTATUS(clSetKernelArg(m_hStatisticsKernel, 0, sizeof(cl_int), (void *)&boardCount));
+    CHECKSTATUS(clSetKernelArg(m_hStatisticsKernel, 1, sizeof(cl_mem), (void *)&m_hStatistics));
+    CHECKSTATUS(clSetKernelArg(m_hStatisticsKernel, 2, sizeof(cl_mem), (void *)&m_hCounters));
+}
+
+/*
+ * seed
+ */
+void BoardBatch::seed()
+{
+    if (m_boards.empty())
+        return;
+
+    cl_command_queue queue = m_engine.getCLQueue();
+    std::vector<cl_uint4> statistics(m_boards.size());
+    std::vector<cl_uint> counters(2 * m_boards.size(), 0);
+    memset(&statistics[0], 0, statistics.size() * sizeof(cl_uint4));
+    CHECKSTATUS(clEnqueueWriteBuffer(queue, m_hStatistics, CL_TRUE, 0, statistics.size() * sizeof(cl_uint4),
+                                     &statistics[0], 0, NULL, NULL));
+    CHECKSTATUS(clEnqueueWriteBuffer(queue, m_hCounters, CL_TRUE, 0, counters.size() * sizeof(cl_uint), &counters[0],
+                                     0, NULL, NULL));
+
+    cl_event event(0);
+    CHECKSTATUS(clEnqueueNDRangeKernel(queue, m_hInitKernel, 3, NULL, m_globalWorkSize, m_localWorkSize, 0, 0,
+                                       m_engine.getProfiler().event(event)));
+    m_engine.getProfiler().track(ps_simulation, event);
+    enqueueStatistics(0);
+    m_offset = 0;
+}
+
+/*
+ * step
+ */
+unsigned int BoardBatch::step(const unsigned int generations)
+{
+    if (m_boards.empty())
+        return 0;
+    if (m_offset == -1)
+        seed();
+
+    cl_command_queue queue = m_engine.getCLQueue();
+    unsigned int generation(0);
+    for (; generation < generations; ++generation)
+    {
+        // Every board settled, the remaining generations would not change anything
+        if (generation % gBatchCheckInterval == 0 && settled())
+            break;
+
+        cl_event event(0);
+        CHECKSTATUS(clSetKernelArg(m_hBatchKernel, 4, sizeof(cl_int), (void *)&m_offset));
+        CHECKSTATUS(clEnqueueNDRangeKernel(queue, m_hBatchKernel, 3, NULL, m_globalWorkSize, m_localWorkSize, 0, 0,
+                                           m_engine.getProfiler().event(event)));
+        m_engine.getProfiler().track(ps_simulation, event);
+        enqueueStatistics(1);
+        m_offset = (m_offset == 0) ? 1 : 0;
+    }
+    CHECKSTATUS(clFinish(queue));
+    m_engine.getProfiler().collect(false);
+    return generation;
+}
+
+/*
+ * enqueueStatistics
+ */
+void BoardBatch::enqueueStatistics(const cl_int generations)
+{
+    // Sums of the last launch into the statistics, one work-item per board
+    size_t boardWorkSize[] = {m_boards.size()};
+    cl_event event(0);
+    CHECKSTATUS(clSetKernelArg(m_hStatisticsKernel, 3, sizeof(cl_int), (void *)&generations));
+    CHECKSTATUS(clEnqueueNDRangeKernel(m_engine.getCLQueue(), m_hStatisticsKernel, 1, NULL, boardWorkSize, 0, 0, 0,
+                                       m_engine.getProfiler().event(event)));
+    m_engine.getProfiler().track(ps_simulation, event);
+}
+
+bool BoardBatch::settled()
+{
+    std::vector<BoardStatistics> statistics;
+    getStatistics(statistics);
+    for (size_t i(0); i < statistics.size(); ++i)
+        if (!statistics[i].settled)
+            return false;
+    return true;
+}
+
+void BoardBatch::getStatistics(std::vector<BoardStatistics> &statistics)
+{
+    statistics.clear();
+    if (m_boards.empty())
+        return;
+    if (m_offset == -1)
+        seed();
+
+    std::vector<cl_uint4> values(m_boards.size());
+    cl_event event(0);
+    CHECKSTATUS(clEnqueueReadBuffer(m_engine.getCLQueue(), m_hStatistics, CL_TRUE, 0,
+                                    values.size() * sizeof(cl_uint4), &values[0], 0, NULL,
+                                    m_engine.getProfiler().event(event)));
+    m_engine.getProfiler().track(ps_readback, event);
+
+    statistics.resize(values.size());
+    for (size_t i(0); i < values.size(); ++i)
+    {
+        statistics[i].population = values[i].s[0];
+        statistics[i].generations = values[i].s[1];
+        statistics[i].changedWords = values[i].s[2];
+        statistics[i].settled = (values[i].s[3] != 0);
+    }
+}
+
+// ---------- State ----------
+void BoardBatch::loadState(const int board, const std::vector<cl_uint> &cells)
+{
+    size_t boardWords = m_wordsPerRow * m_height;
+    if (board < 0 || board >= getBoardCount() || cells.size() != boardWords)
+    {
+        std::cerr << "Invalid board or state size" << std::endl;
+        return;
+    }
+    if (m_offset == -1)
+        seed();
+
+    // The state becomes the current generation of the board, which starts over
+    cl_command_queue queue = m_engine.getCLQueue();
+    cl_uint4 statistics = {{0, 0, 0, 0}};
+    for (size_t i(0); i < cells.size(); ++i)
+        for (cl_uint word = cells[i]; word != 0; word &= word - 1)
+            ++statistics.s[0];
+    CHECKSTATUS(clEnqueueWriteBuffer(queue, m_hCells, CL_TRUE, (board * 2 + m_offset) * boardWords * sizeof(cl_uint),
+                                     boardWords * sizeof(cl_uint), &cells[0], 0, NULL, NULL));
+    CHECKSTATUS(clEnqueueWriteBuffer(queue, m_hStatistics, CL_TRUE, board * sizeof(cl_uint4), sizeof(cl_uint4),
+                                     &statistics, 0, NULL, NULL));
+}
+
+void BoardBatch::saveState(const int board, std::vector<cl_uint> &cells)
+{
+    size_t boardWords = m_wordsPerRow * m_height;
+    cells.clear();
+    if (board < 0 || board >= getBoardCount())
+        return;
+    if (m_offset == -1)
+        seed();
+
+    cells.resize(boardWords);
+    CHECKSTATUS(clEnqueueReadBuffer(m_engine.getCLQueue(), m_hCells, CL_TRUE,
+                                    (board * 2 + m_offset) * boardWords * sizeof(cl_uint),
+                                    boardWords * sizeof(cl_uint), &cells[0], 0, NULL, NULL));
+}
@@ -0,0 +1,105 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include "OpenCLKernel.h"
+
+// Work-group of the batch kernels: words per row, and work-items
+const int gBatchGroupWords = 8;
+const int gBatchGroupSize = 64;
+// Generations between two checks of the settled boards
+const int gBatchCheckInterval = 64;
+
+// Rule, seed and seeding limit of one board of a batch
+struct BoardParameters
+{
+    cl_uint birth;
+    cl_uint survival;
+    cl_uint seed;
+    cl_float limit; // Cells are seeded alive with this probability
+};
+
+struct BoardStatistics
+{
+    cl_uint population;
+    cl_uint generations;  // Generations computed, the last one leaving a settled board unchanged
+    cl_uint changedWords; // Packed words changed by the last generation
+    bool settled;
+};
+
+/*
+ * Independent boards of packed cells advanced together, for parameter sweeps: every board of the batch is
+ * stacked in one buffer and a generation of all of them is a single 3D NDRange, the third dimension being
+ * the board. Boards that settle, a generation leaving them unchanged, are not advanced any more, and the
+ * batch stops early when all of them have settled. The batch shares the context, queue, program and
+ * profiler of an OpenCL engine whose kernels are compiled.
+ */
+class GOL_API BoardBatch
+{
+public:
+    BoardBatch(OpenCLKernel &engine);
+    ~BoardBatch();
+
+public:
+    // ---------- Boards ----------
+    void initialize(const int width, const int height, const std::vector<BoardParameters> &boards);
+    int getBoardCount() { return static_cast<int>(m_boards.size()); };
+
+    // Seeds every board from its seed and limit, clearing the statistics
+    void seed();
+
+    // Advances the boards that have not settled, seeding them first if needed. Returns the number of
+    // generations computed, less than requested when every board has settled
+    unsigned int step(const unsigned int generations);
+
+    void getStatistics(std::vector<BoardStatistics> &statistics);
+
+    // ---------- State ----------
+    // Packed cells of one board, (width+31)/32 words per row
+    void loadState(const int board, const std::vector<cl_uint> &cells);
+    void saveState(const int board, std::vector<cl_uint> &cells);
+
+private:
+    void release();
+    void enqueueStatistics(const cl_int generations);
+    bool settled();
+
+private:
+    OpenCLKernel &m_engine;
+    cl_kernel m_hInitKernel;
+    cl_kernel m_hBatchKernel;
+    cl_kernel m_hStatisticsKernel;
+
+    // Two generations per board, parameters, statistics and the sums of the last launch
+    cl_mem m_hCells;
+    cl_mem m_hParameters;
+    cl_mem m_hStatistics;
+    cl_mem m_hCounters;
+
+    std::vector<BoardParameters> m_boards;
+    cl_int m_width;
+    cl_int m_height;
+    cl_int m_wordsPerRow;
+    cl_int m_offset;
+    size_t m_localWorkSize[3];
+    size_t m_globalWorkSize[3];
+};
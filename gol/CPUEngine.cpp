@@ -0,0 +1,247 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <algorithm>
+#include <chrono>
+
+#include "CPUEngine.h"
+
+// Row of packed words of gPackedWordBits cells into a row of CPU words, and back
+static void widenRow(const uint32_t *source, const int sourceWords, CPUWord *destination, const int words)
+{
+    for (int x(0); x < words; ++x)
+    {
+        CPUWord low = source[2 * x];
+        CPUWord high = (2 * x + 1 < sourceWords) ? source[2 * x + 1] : 0;
+        destination[x] = low | (high << 32);
+    }
+}
+
+static void narrowRow(const CPUWord *source, uint32_t *destination, const int destinationWords)
+{
+    for (int x(0); x < destinationWords; ++x)
+        destination[x] = static_cast<uint32_t>(source[x / 2] >> ((x % 2) * 32));
+}
+
+/*
+ * CPUEngine constructor
+ */
+CPUEngine::CPUEngine(int threads)
+    : m_pool(threads)
+    , m_width(0)
+    , m_height(0)
+    , m_wordsPerRow(0)
+    , m_seeded(false)
+    , m_limit(0.5f)
+    , m_validBits(~0ULL)
+    , m_instructionSet(cis_scalar)
+    , m_rowKernel(advanceRowScalar)
+    , m_textures(gTextureWidth * gTextureHeight * gTextureDepth, 0)
+{
+    setRule(gConwayBirth, gConwaySurvival);
+    setInstructionSet(detectInstructionSet());
+}
+
+CPUEngine::~CPUEngine()
+{
+}
+
+// ---------- Board ----------
+void CPUEngine::initializeDevice(int width, int height, const CellStorage)
+{
+    m_width = width;
+    m_height = height;
+    m_wordsPerRow = (width + gCPUWordBits - 1) / gCPUWordBits;
+    int remainder = width % gCPUWordBits;
+    m_validBits = (remainder != 0) ? (1ULL << remainder) - 1ULL : ~0ULL;
+    m_cells.assign(m_wordsPerRow * height, 0);
+    m_rows.assign(m_pool.getThreadCount() * 4 * m_wordsPerRow, 0);
+    m_seeded = false;
+}
+
+/*
+ * getStrip
+ */
+void CPUEngine::getStrip(int index, int &begin, int &end)
+{
+    int threads = m_pool.getThreadCount();
+    begin = static_cast<int>(static_cast<long long>(m_height) * index / threads);
+    end = static_cast<int>(static_cast<long long>(m_height) * (index + 1) / threads);
+}
+
+/*
+ * seed
+ */
+void CPUEngine::seed()
+{
+    std::function<void(int)> task = [this](int index) {
+        int begin(0);
+        int end(0);
+        getStrip(index, begin, end);
+        std::vector<uint32_t> words(packedWords(m_width));
+        for (int y(begin); y < end; ++y)
+        {
+            seedPackedRow(&m_textures[0], m_width, m_height, 0, y, m_width, m_limit, &words[0]);
+            widenRow(&words[0], static_cast<int>(words.size()), &m_cells[y * m_wordsPerRow], m_wordsPerRow);
+        }
+    };
+    m_pool.run(task);
+    m_seeded = true;
+}
+
+/*
+ * step
+ */
+void CPUEngine::step(const unsigned int generations)
+{
+    if (!m_seeded)
+        seed();
+    if (generations == 0 || m_cells.empty())
+        return;
+
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    std::function<void(int)> task = [this, generations](int index) {
+        for (unsigned int i(0); i < generations; ++i)
+            advanceStrip(index);
+    };
+    m_pool.run(task);
+    m_profiler.record(ps_simulation, elapsedMicroseconds(start));
+}
+
+/*
+ * advanceStrip
+ */
+void CPUEngine::advanceStrip(int index)
+{
+    int begin(0);
+    int end(0);
+    getStrip(index, begin, end);
+    CPUWord *above = &m_rows[index * 4 * m_wordsPerRow];
+    CPUWord *below = above + m_wordsPerRow;
+    CPUWord *ring[] = {below + m_wordsPerRow, below + 2 * m_wordsPerRow};
+
+    // Rows bordering the strip, saved before any worker starts writing
+    if (begin < end)
+    {
+        if (begin > 0)
+            std::copy(&m_cells[(begin - 1) * m_wordsPerRow], &m_cells[begin * m_wordsPerRow], above);
+        else
+            std::fill(above, above + m_wordsPerRow, 0ULL);
+        if (end < m_height)
+            std::copy(&m_cells[end * m_wordsPerRow], &m_cells[end * m_wordsPerRow] + m_wordsPerRow, below);
+        else
+            std::fill(below, below + m_wordsPerRow, 0ULL);
+    }
+    m_pool.barrier();
+
+    // Each row is saved in the ring before being overwritten, the next row being still untouched
+    const CPUWord *previous = above;
+    for (int y(begin); y < end; ++y)
+    {
+        CPUWord *row = &m_cells[y * m_wordsPerRow];
+        CPUWord *saved = ring[(y - begin) & 1];
+        std::copy(row, row + m_wordsPerRow, saved);
+        m_rowKernel(previous, saved, (y + 1 < end) ? row + m_wordsPerRow : below, row, m_wordsPerRow, m_rule);
+        row[m_wordsPerRow - 1] &= m_validBits;
+        previous = saved;
+    }
+    m_pool.barrier();
+}
+
+/*
+ * readback
+ */
+void CPUEngine::readback(BYTE *bitmap)
+{
+    if (!m_seeded)
+        seed();
+
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    std::function<void(int)> task = [this, bitmap](int index) {
+        int begin(0);
+        int end(0);
+        getStrip(index, begin, end);
+        std::vector<uint32_t> words(packedWords(m_width));
+        for (int y(begin); y < end; ++y)
+        {
+            narrowRow(&m_cells[y * m_wordsPerRow], &words[0], static_cast<int>(words.size()));
+            colorizePackedRow(&m_textures[0], m_width, m_height, y, &words[0], bitmap + y * m_width * gColorDepth);
+        }
+    };
+    m_pool.run(task);
+    m_profiler.record(ps_colorize, elapsedMicroseconds(start));
+}
+
+// ---------- State ----------
+void CPUEngine::loadState(const std::vector<uint32_t> &cells)
+{
+    int wordsPerRow = packedWords(m_width);
+    if (cells.size() != static_cast<size_t>(wordsPerRow * m_height))
+        return;
+
+    for (int y(0); y < m_height; ++y)
+    {
+        CPUWord *destination = &m_cells[y * m_wordsPerRow];
+        widenRow(&cells[y * wordsPerRow], wordsPerRow, destination, m_wordsPerRow);
+        destination[m_wordsPerRow - 1] &= m_validBits;
+    }
+    m_seeded = true;
+}
+
+void CPUEngine::saveState(std::vector<uint32_t> &cells)
+{
+    if (!m_seeded)
+        seed();
+
+    int wordsPerRow = packedWords(m_width);
+    cells.assign(wordsPerRow * m_height, 0);
+    for (int y(0); y < m_height; ++y)
+        narrowRow(&m_cells[y * m_wordsPerRow], &cells[y * wordsPerRow], wordsPerRow);
+}
+
+// ---------- Seeding and rules ----------
+void CPUEngine::setTexture(int index, BYTE *texture)
+{
+    // Single texture
+    if (index != 0)
+        return;
+    storeTexture(texture, &m_textures[0]);
+}
+
+bool CPUEngine::setRule(const uint32_t birth, const uint32_t survival)
+{
+    for (int count(0); count < 9; ++count)
+    {
+        m_rule.born[count] = ((birth >> count) & 1) ? ~0ULL : 0ULL;
+        m_rule.stays[count] = ((survival >> count) & 1) ? ~0ULL : 0ULL;
+    }
+    return true;
+}
+
+bool CPUEngine::setInstructionSet(const CPUInstructionSet instructionSet)
+{
+    CPURowKernel kernel = getRowKernel(instructionSet);
+    if (kernel == 0 || instructionSet > detectInstructionSet())
+        return false;
+    m_instructionSet = instructionSet;
+    m_rowKernel = kernel;
+    return true;
+}
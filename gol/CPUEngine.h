@@ -0,0 +1,92 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include "CPUKernels.h"
+#include "SimulationEngine.h"
+#include "ThreadPool.h"
+
+/*
+ * Native multithreaded engine, for hosts without a usable OpenCL device. The board is split into one strip
+ * of rows per worker and updated in place: each worker keeps the previous generation of the rows it still
+ * needs in a small ring buffer, the rows bordering its strip being saved before any worker starts writing.
+ * Cells outside of the board are dead, as with the packed storage of the OpenCL kernels.
+ */
+class GOL_API CPUEngine : public SimulationEngine
+{
+public:
+    // 0 threads uses one per hardware thread
+    CPUEngine(int threads = 0);
+    virtual ~CPUEngine();
+
+public:
+    // ---------- Board ----------
+    // Cells are always packed, the storage is ignored
+    virtual void initializeDevice(int width, int height, const CellStorage storage = cs_packed);
+    virtual void step(const unsigned int generations);
+    virtual void readback(BYTE *bitmap);
+    virtual void reset() { m_seeded = false; };
+
+    // ---------- State ----------
+    virtual void loadState(const std::vector<uint32_t> &cells);
+    virtual void saveState(std::vector<uint32_t> &cells);
+
+    // ---------- Seeding and rules ----------
+    virtual void setTexture(int index, BYTE *texture);
+    virtual void setLimit(const float limit) { m_limit = limit; };
+    virtual bool setRule(const uint32_t birth, const uint32_t survival);
+
+    // ---------- Statistics ----------
+    virtual ProfilingStatistics getStatistics() { return m_profiler.getStatistics(); };
+
+    int getThreadCount() { return m_pool.getThreadCount(); };
+
+    // Row kernel, defaulting to the best one supported by the processor. Returns false when the
+    // instruction set is not available
+    bool setInstructionSet(const CPUInstructionSet instructionSet);
+    CPUInstructionSet getInstructionSet() { return m_instructionSet; };
+
+private:
+    void seed();
+    void getStrip(int index, int &begin, int &end);
+    void advanceStrip(int index);
+
+private:
+    ThreadPool m_pool;
+    Profiler m_profiler;
+
+    int m_width;
+    int m_height;
+    int m_wordsPerRow;
+    bool m_seeded;
+    float m_limit;
+    CPUWord m_validBits;
+    CPURule m_rule;
+    CPUInstructionSet m_instructionSet;
+    CPURowKernel m_rowKernel;
+
+    std::vector<CPUWord> m_cells;
+    std::vector<BYTE> m_textures;
+
+    // Per worker: rows bordering the strip, then the ring buffer of the two previous rows
+    std::vector<CPUWord> m_rows;
+};
@@ -0,0 +1,165 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef _MSC_VER
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+#include "CPUKernels.h"
+
+/*
+ * detectInstructionSet
+ */
+CPUInstructionSet detectInstructionSet()
+{
+#if defined(_MSC_VER)
+    // Features reported by the processor, and registers saved by the operating system
+    int info[4] = {0};
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return cis_scalar;
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    __cpuidex(info, 7, 0);
+    bool avx2 = osxsave && (xcr0 & 0x6) == 0x6 && (info[1] & (1 << 5)) != 0;
+    bool avx512 = osxsave && (xcr0 & 0xE6) == 0xE6 && (info[1] & (1 << 16)) != 0;
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    bool avx2 = __builtin_cpu_supports("avx2");
+    bool avx512 = __builtin_cpu_supports("avx512f");
+#else
+    bool avx2 = false;
+    bool avx512 = false;
+#endif
+
+#ifdef GOL_AVX512
+    if (avx512)
+        return cis_avx512;
+#endif
+#ifdef GOL_AVX2
+    if (avx2)
+        return cis_avx2;
+#endif
+    (void)avx2;
+    (void)avx512;
+    return cis_scalar;
+}
+
+/*
+ * getRowKernel
+ */
+CPURowKernel getRowKernel(const CPUInstructionSet instructionSet)
+{
+    switch (instructionSet)
+    {
+#ifdef GOL_AVX2
+    case cis_avx2:
+        return advanceRowAVX2;
+#endif
+#ifdef GOL_AVX512
+    case cis_avx512:
+        return advanceRowAVX512;
+#endif
+    case cis_scalar:
+        return advanceRowScalar;
+    default:
+        return 0;
+    }
+}
+
+const char *getInstructionSetName(const CPUInstructionSet instructionSet)
+{
+    switch (instructionSet)
+    {
+    case cis_avx2:
+        return "avx2";
+    case cis_avx512:
+        return "avx512";
+    default:
+        return "scalar";
+    }
+}
+
+/*
+ * advanceWords
+ */
+void advanceWords(const CPUWord *above, const CPUWord *row, const CPUWord *below, CPUWord *destination, int words,
+                  const CPURule &rule, int begin, int end)
+{
+    const int last = words - 1;
+    for (int x(begin); x < end; ++x)
+    {
+        CPUWord north = above[x];
+        CPUWord center = row[x];
+        CPUWord south = below[x];
+        CPUWord northWest = (x > 0) ? above[x - 1] : 0;
+        CPUWord west = (x > 0) ? row[x - 1] : 0;
+        CPUWord southWest = (x > 0) ? below[x - 1] : 0;
+        CPUWord northEast = (x < last) ? above[x + 1] : 0;
+        CPUWord east = (x < last) ? row[x + 1] : 0;
+        CPUWord southEast = (x < last) ? below[x + 1] : 0;
+
+        // Neighbors at x-1 and x+1, carrying bits across word boundaries
+        CPUWord nw = (north << 1) | (northWest >> 63);
+        CPUWord ne = (north >> 1) | (northEast << 63);
+        CPUWord w = (center << 1) | (west >> 63);
+        CPUWord e = (center >> 1) | (east << 63);
+        CPUWord sw = (south << 1) | (southWest >> 63);
+        CPUWord se = (south >> 1) | (southEast << 63);
+
+        // Rows above and below: full adders, current row: half adder
+        CPUWord top0 = nw ^ north ^ ne;
+        CPUWord top1 = (nw & north) | (ne & (nw ^ north));
+        CPUWord bottom0 = sw ^ south ^ se;
+        CPUWord bottom1 = (sw & south) | (se & (sw ^ south));
+        CPUWord middle0 = w ^ e;
+        CPUWord middle1 = w & e;
+
+        CPUWord s0 = top0 ^ bottom0 ^ middle0;
+        CPUWord carry0 = (top0 & bottom0) | (middle0 & (top0 ^ bottom0));
+        CPUWord twos = top1 ^ bottom1 ^ middle1;
+        CPUWord carry1 = (top1 & bottom1) | (middle1 & (top1 ^ bottom1));
+        CPUWord s1 = twos ^ carry0;
+        CPUWord carry2 = twos & carry0;
+        CPUWord s2 = carry1 ^ carry2;
+        CPUWord s3 = carry1 & carry2;
+
+        // Counts that neither give birth nor keep alive are skipped
+        CPUWord next(0);
+        for (int count(0); count < 9; ++count)
+        {
+            if ((rule.born[count] | rule.stays[count]) == 0)
+                continue;
+            CPUWord match = ((count & 1) ? s0 : ~s0) & ((count & 2) ? s1 : ~s1) & ((count & 4) ? s2 : ~s2) &
+                            ((count & 8) ? s3 : ~s3);
+            next |= match & ((center & rule.stays[count]) | (~center & rule.born[count]));
+        }
+        destination[x] = next;
+    }
+}
+
+void advanceRowScalar(const CPUWord *above, const CPUWord *row, const CPUWord *below, CPUWord *destination,
+                      int words, const CPURule &rule)
+{
+    advanceWords(above, row, below, destination, words, rule, 0, words);
+}
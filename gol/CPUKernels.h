@@ -0,0 +1,72 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include "DLL_API.h"
+
+// Cells of the native engine: one bit per cell, 64 cells per word
+typedef unsigned long long CPUWord;
+const int gCPUWordBits = 64;
+
+enum CPUInstructionSet
+{
+    cis_scalar,
+    cis_avx2,  // 4 words per register
+    cis_avx512 // 8 words per register
+};
+
+// Cells born and kept alive for each number of neighbors, as full words
+struct CPURule
+{
+    CPUWord born[9];
+    CPUWord stays[9];
+};
+
+/*
+ * Row kernels: advance the words of a row from the rows above and below, counting the eight neighbors of
+ * every cell with a carry-save adder tree over the shifted rows. Words outside of the row are dead.
+ */
+typedef void (*CPURowKernel)(const CPUWord *above, const CPUWord *row, const CPUWord *below,
+                             CPUWord *destination, int words, const CPURule &rule);
+
+// Best instruction set supported by both the build and the processor
+GOL_API CPUInstructionSet detectInstructionSet();
+
+// Row kernel of an instruction set, 0 when it is not part of the build
+GOL_API CPURowKernel getRowKernel(const CPUInstructionSet instructionSet);
+
+GOL_API const char *getInstructionSetName(const CPUInstructionSet instructionSet);
+
+// Scalar kernel on the words [begin, end) of a row, used by the vector kernels for the words at both ends
+void advanceWords(const CPUWord *above, const CPUWord *row, const CPUWord *below, CPUWord *destination, int words,
+                  const CPURule &rule, int begin, int end);
+
+void advanceRowScalar(const CPUWord *above, const CPUWord *row, const CPUWord *below, CPUWord *destination,
+                      int words, const CPURule &rule);
+#ifdef GOL_AVX2
+void advanceRowAVX2(const CPUWord *above, const CPUWord *row, const CPUWord *below, CPUWord *destination, int words,
+                    const CPURule &rule);
+#endif
+#ifdef GOL_AVX512
+void advanceRowAVX512(const CPUWord *above, const CPUWord *row, const CPUWord *below, CPUWord *destination,
+                      int words, const CPURule &rule);
+#endif
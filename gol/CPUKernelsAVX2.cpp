@@ -0,0 +1,111 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Compiled with AVX2 enabled, only called when the processor supports it
+
+#include <immintrin.h>
+
+#include "CPUKernels.h"
+
+/*
+ * advanceRowAVX2
+ */
+void advanceRowAVX2(const CPUWord *above, const CPUWord *row, const CPUWord *below, CPUWord *destination, int words,
+                    const CPURule &rule)
+{
+    const int lanes = 4;
+    const __m256i ones = _mm256_set1_epi64x(-1);
+
+    // Counts that give birth or keep alive
+    int counts[9];
+    __m256i born[9];
+    __m256i stays[9];
+    int active(0);
+    for (int count(0); count < 9; ++count)
+        if ((rule.born[count] | rule.stays[count]) != 0)
+        {
+            counts[active] = count;
+            born[active] = _mm256_set1_epi64x(static_cast<long long>(rule.born[count]));
+            stays[active] = _mm256_set1_epi64x(static_cast<long long>(rule.stays[count]));
+            ++active;
+        }
+
+    // Vectors of words having both neighbor words in the row, the words at both ends being scalar
+    int x(1);
+    for (; x + lanes < words; x += lanes)
+    {
+        __m256i north = _mm256_loadu_si256((const __m256i *)(above + x));
+        __m256i center = _mm256_loadu_si256((const __m256i *)(row + x));
+        __m256i south = _mm256_loadu_si256((const __m256i *)(below + x));
+
+        __m256i nw = _mm256_or_si256(_mm256_slli_epi64(north, 1),
+                                     _mm256_srli_epi64(_mm256_loadu_si256((const __m256i *)(above + x - 1)), 63));
+        __m256i ne = _mm256_or_si256(_mm256_srli_epi64(north, 1),
+                                     _mm256_slli_epi64(_mm256_loadu_si256((const __m256i *)(above + x + 1)), 63));
+        __m256i w = _mm256_or_si256(_mm256_slli_epi64(center, 1),
+                                    _mm256_srli_epi64(_mm256_loadu_si256((const __m256i *)(row + x - 1)), 63));
+        __m256i e = _mm256_or_si256(_mm256_srli_epi64(center, 1),
+                                    _mm256_slli_epi64(_mm256_loadu_si256((const __m256i *)(row + x + 1)), 63));
+        __m256i sw = _mm256_or_si256(_mm256_slli_epi64(south, 1),
+                                     _mm256_srli_epi64(_mm256_loadu_si256((const __m256i *)(below + x - 1)), 63));
+        __m256i se = _mm256_or_si256(_mm256_srli_epi64(south, 1),
+                                     _mm256_slli_epi64(_mm256_loadu_si256((const __m256i *)(below + x + 1)), 63));
+
+        // Carry-save adder tree
+        __m256i topXor = _mm256_xor_si256(nw, north);
+        __m256i top0 = _mm256_xor_si256(topXor, ne);
+        __m256i top1 = _mm256_or_si256(_mm256_and_si256(nw, north), _mm256_and_si256(ne, topXor));
+        __m256i bottomXor = _mm256_xor_si256(sw, south);
+        __m256i bottom0 = _mm256_xor_si256(bottomXor, se);
+        __m256i bottom1 = _mm256_or_si256(_mm256_and_si256(sw, south), _mm256_and_si256(se, bottomXor));
+        __m256i middle0 = _mm256_xor_si256(w, e);
+        __m256i middle1 = _mm256_and_si256(w, e);
+
+        __m256i onesXor = _mm256_xor_si256(top0, bottom0);
+        __m256i s0 = _mm256_xor_si256(onesXor, middle0);
+        __m256i carry0 = _mm256_or_si256(_mm256_and_si256(top0, bottom0), _mm256_and_si256(middle0, onesXor));
+        __m256i twosXor = _mm256_xor_si256(top1, bottom1);
+        __m256i twos = _mm256_xor_si256(twosXor, middle1);
+        __m256i carry1 = _mm256_or_si256(_mm256_and_si256(top1, bottom1), _mm256_and_si256(middle1, twosXor));
+        __m256i s1 = _mm256_xor_si256(twos, carry0);
+        __m256i carry2 = _mm256_and_si256(twos, carry0);
+        __m256i s2 = _mm256_xor_si256(carry1, carry2);
+        __m256i s3 = _mm256_and_si256(carry1, carry2);
+
+        __m256i sums[] = {s0, s1, s2, s3};
+        __m256i notSums[] = {_mm256_xor_si256(s0, ones), _mm256_xor_si256(s1, ones), _mm256_xor_si256(s2, ones),
+                             _mm256_xor_si256(s3, ones)};
+        __m256i next = _mm256_setzero_si256();
+        for (int i(0); i < active; ++i)
+        {
+            int count = counts[i];
+            __m256i match = _mm256_and_si256(
+                _mm256_and_si256((count & 1) ? sums[0] : notSums[0], (count & 2) ? sums[1] : notSums[1]),
+                _mm256_and_si256((count & 4) ? sums[2] : notSums[2], (count & 8) ? sums[3] : notSums[3]));
+            __m256i state = _mm256_or_si256(_mm256_and_si256(center, stays[i]), _mm256_andnot_si256(center, born[i]));
+            next = _mm256_or_si256(next, _mm256_and_si256(match, state));
+        }
+        _mm256_storeu_si256((__m256i *)(destination + x), next);
+    }
+
+    advanceWords(above, row, below, destination, words, rule, 0, (words < 1) ? words : 1);
+    advanceWords(above, row, below, destination, words, rule, (x < words) ? x : words, words);
+}
@@ -0,0 +1,111 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Compiled with AVX-512F enabled, only called when the processor supports it
+
+#include <immintrin.h>
+
+#include "CPUKernels.h"
+
+// Truth tables of _mm512_ternarylogic_epi64
+const int gXor3 = 0x96;
+const int gMajority = 0xE8;
+
+/*
+ * advanceRowAVX512
+ */
+void advanceRowAVX512(const CPUWord *above, const CPUWord *row, const CPUWord *below, CPUWord *destination,
+                      int words, const CPURule &rule)
+{
+    const int lanes = 8;
+
+    // Counts that give birth or keep alive
+    int counts[9];
+    __m512i born[9];
+    __m512i stays[9];
+    int active(0);
+    for (int count(0); count < 9; ++count)
+        if ((rule.born[count] | rule.stays[count]) != 0)
+        {
+            counts[active] = count;
+            born[active] = _mm512_set1_epi64(static_cast<long long>(rule.born[count]));
+            stays[active] = _mm512_set1_epi64(static_cast<long long>(rule.stays[count]));
+            ++active;
+        }
+
+    // Vectors of words having both neighbor words in the row, the words at both ends being scalar
+    int x(1);
+    for (; x + lanes < words; x += lanes)
+    {
+        __m512i north = _mm512_loadu_si512(above + x);
+        __m512i center = _mm512_loadu_si512(row + x);
+        __m512i south = _mm512_loadu_si512(below + x);
+
+        __m512i nw =
+            _mm512_or_si512(_mm512_slli_epi64(north, 1), _mm512_srli_epi64(_mm512_loadu_si512(above + x - 1), 63));
+        __m512i ne =
+            _mm512_or_si512(_mm512_srli_epi64(north, 1), _mm512_slli_epi64(_mm512_loadu_si512(above + x + 1), 63));
+        __m512i w =
+            _mm512_or_si512(_mm512_slli_epi64(center, 1), _mm512_srli_epi64(_mm512_loadu_si512(row + x - 1), 63));
+        __m512i e =
+            _mm512_or_si512(_mm512_srli_epi64(center, 1), _mm512_slli_epi64(_mm512_loadu_si512(row + x + 1), 63));
+        __m512i sw =
+            _mm512_or_si512(_mm512_slli_epi64(south, 1), _mm512_srli_epi64(_mm512_loadu_si512(below + x - 1), 63));
+        __m512i se =
+            _mm512_or_si512(_mm512_srli_epi64(south, 1), _mm512_slli_epi64(_mm512_loadu_si512(below + x + 1), 63));
+
+        // Carry-save adder tree, each full adder being two ternary logic instructions
+        __m512i top0 = _mm512_ternarylogic_epi64(nw, north, ne, gXor3);
+        __m512i top1 = _mm512_ternarylogic_epi64(nw, north, ne, gMajority);
+        __m512i bottom0 = _mm512_ternarylogic_epi64(sw, south, se, gXor3);
+        __m512i bottom1 = _mm512_ternarylogic_epi64(sw, south, se, gMajority);
+        __m512i middle0 = _mm512_xor_si512(w, e);
+        __m512i middle1 = _mm512_and_si512(w, e);
+
+        __m512i s0 = _mm512_ternarylogic_epi64(top0, bottom0, middle0, gXor3);
+        __m512i carry0 = _mm512_ternarylogic_epi64(top0, bottom0, middle0, gMajority);
+        __m512i twos = _mm512_ternarylogic_epi64(top1, bottom1, middle1, gXor3);
+        __m512i carry1 = _mm512_ternarylogic_epi64(top1, bottom1, middle1, gMajority);
+        __m512i s1 = _mm512_xor_si512(twos, carry0);
+        __m512i carry2 = _mm512_and_si512(twos, carry0);
+        __m512i s2 = _mm512_xor_si512(carry1, carry2);
+        __m512i s3 = _mm512_and_si512(carry1, carry2);
+
+        __m512i sums[] = {s0, s1, s2, s3};
+        __m512i next = _mm512_setzero_si512();
+        for (int i(0); i < active; ++i)
+        {
+            // Matching bits of the count: s & (count bit) | ~s & ~(count bit), that is ~(s ^ bit)
+            int count = counts[i];
+            __m512i match = _mm512_set1_epi64(-1);
+            for (int bit(0); bit < 4; ++bit)
+                match = (count & (1 << bit)) ? _mm512_and_si512(match, sums[bit])
+                                             : _mm512_andnot_si512(sums[bit], match);
+            // center ? stays : born
+            __m512i state = _mm512_ternarylogic_epi64(center, stays[i], born[i], 0xCA);
+            next = _mm512_or_si512(next, _mm512_and_si512(match, state));
+        }
+        _mm512_storeu_si512(destination + x, next);
+    }
+
+    advanceWords(above, row, below, destination, words, rule, 0, (words < 1) ? words : 1);
+    advanceWords(above, row, below, destination, words, rule, (x < words) ? x : words, words);
+}
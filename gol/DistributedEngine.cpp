@@ -0,0 +1,518 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "DistributedEngine.h"
+
+// Directions of the neighbors: (row + 1) * 3 + column + 1 for offsets of -1 to 1, 4 being the tile itself
+const int gDirections = 9;
+const int gCenter = 4;
+// Neighbors of the bands: north, south, west and east
+const int gBandDirections[] = {1, 7, 3, 5};
+
+// Checkpoint header: width and height of the board
+const MPI_Offset gCheckpointHeader = 2 * sizeof(int32_t);
+
+static MPI_Offset checkpointSize(const int width, const int height)
+{
+    return gCheckpointHeader + static_cast<MPI_Offset>(packedWords(width)) * height * sizeof(uint32_t);
+}
+
+/*
+ * copyCells: copies a width x height region of packed rows, at any bit offset
+ */
+static void copyCells(const std::vector<uint32_t> &source, const int sourceWordsPerRow, const int sourceX,
+                      const int sourceY, std::vector<uint32_t> &destination, const int destinationWordsPerRow,
+                      const int destinationX, const int destinationY, const int width, const int height)
+{
+    for (int y(0); y < height; ++y)
+    {
+        const uint32_t *from = &source[(sourceY + y) * sourceWordsPerRow];
+        uint32_t *to = &destination[(destinationY + y) * destinationWordsPerRow];
+        int sourceBit = sourceX;
+        int destinationBit = destinationX;
+        for (int count = width; count > 0;)
+        {
+            // Largest run of bits within one word of both rows
+            int sourceShift = sourceBit % gPackedWordBits;
+            int destinationShift = destinationBit % gPackedWordBits;
+            int bits = std::min(count, gPackedWordBits - std::max(sourceShift, destinationShift));
+            uint32_t mask = (bits == gPackedWordBits) ? ~0u : (1u << bits) - 1u;
+            uint32_t value = (from[sourceBit / gPackedWordBits] >> sourceShift) & mask;
+            uint32_t &word = to[destinationBit / gPackedWordBits];
+            word = (word & ~(mask << destinationShift)) | (value << destinationShift);
+            sourceBit += bits;
+            destinationBit += bits;
+            count -= bits;
+        }
+    }
+}
+
+/*
+ * hashCell: mixes the index of a cell on the board (splitmix64)
+ */
+static unsigned long long hashCell(unsigned long long index)
+{
+    index += 0x9E3779B97F4A7C15ULL;
+    index = (index ^ (index >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    index = (index ^ (index >> 27)) * 0x94D049BB133111EBULL;
+    return index ^ (index >> 31);
+}
+
+/*
+ * checksumCells: sum of the hashes of the alive cells of packed rows starting at column x and row y of the board
+ */
+static unsigned long long checksumCells(const std::vector<uint32_t> &cells, const int width, const int height,
+                                        const int x, const int y, const int boardWidth)
+{
+    int wordsPerRow = packedWords(width);
+    unsigned long long sum(0);
+    for (int row(0); row < height; ++row)
+        for (int word(0); word < wordsPerRow; ++word)
+        {
+            uint32_t bits = cells[row * wordsPerRow + word];
+            for (int bit(0); bits != 0; ++bit, bits >>= 1)
+            {
+                int column = word * gPackedWordBits + bit;
+                if ((bits & 1) && column < width)
+                    sum += hashCell(static_cast<unsigned long long>(y + row) * boardWidth + x + column);
+            }
+        }
+    return sum;
+}
+
+/*
+ * DistributedEngine constructor
+ */
+DistributedEngine::DistributedEngine(MPI_Comm communicator, SimulationEngine &engine)
+    : m_engine(engine)
+    , m_rank(0)
+    , m_width(0)
+    , m_height(0)
+    , m_ghostCells(0)
+    , m_seeded(false)
+    , m_limit(0.5f)
+    , m_birth(gConwayBirth)
+    , m_survival(gConwaySurvival)
+    , m_textures(gTextureWidth * gTextureHeight * gTextureDepth, 0)
+{
+    // Grid as square as the number of ranks allows, with at least as many rows as columns
+    int size(0);
+    int periods[] = {0, 0};
+    MPI_Comm_size(communicator, &size);
+    m_dimensions[0] = m_dimensions[1] = 0;
+    MPI_Dims_create(size, 2, m_dimensions);
+    MPI_Cart_create(communicator, 2, m_dimensions, periods, 0, &m_communicator);
+    MPI_Comm_rank(m_communicator, &m_rank);
+    MPI_Cart_coords(m_communicator, m_rank, 2, m_coordinates);
+
+    for (int d(0); d < gDirections; ++d)
+    {
+        int coordinates[] = {m_coordinates[0] + d / 3 - 1, m_coordinates[1] + d % 3 - 1};
+        m_neighbors[d] = MPI_PROC_NULL;
+        if (d != gCenter && coordinates[0] >= 0 && coordinates[0] < m_dimensions[0] && coordinates[1] >= 0 &&
+            coordinates[1] < m_dimensions[1])
+            MPI_Cart_rank(m_communicator, coordinates, &m_neighbors[d]);
+    }
+    for (int i(0); i < 4; ++i)
+        m_bands[i] = NULL;
+    m_tile.x = m_tile.y = m_tile.width = m_tile.height = 0;
+    m_tile.left = m_tile.top = m_tile.regionWidth = m_tile.regionHeight = m_tile.wordsPerRow = 0;
+}
+
+DistributedEngine::~DistributedEngine()
+{
+    for (int i(0); i < 4; ++i)
+        delete m_bands[i];
+    MPI_Comm_free(&m_communicator);
+}
+
+// ---------- Board ----------
+/*
+ * getColumns: columns of the tiles of a column of the grid, on word boundaries
+ */
+void DistributedEngine::getColumns(int column, int &begin, int &end)
+{
+    long long words = packedWords(m_width);
+    begin = std::min(static_cast<int>(words * column / m_dimensions[1]) * gPackedWordBits, m_width);
+    end = std::min(static_cast<int>(words * (column + 1) / m_dimensions[1]) * gPackedWordBits, m_width);
+}
+
+/*
+ * getRows
+ */
+void DistributedEngine::getRows(int row, int &begin, int &end)
+{
+    begin = static_cast<int>(static_cast<long long>(m_height) * row / m_dimensions[0]);
+    end = static_cast<int>(static_cast<long long>(m_height) * (row + 1) / m_dimensions[0]);
+}
+
+bool DistributedEngine::initialize(int width, int height)
+{
+    if (packedWords(width) < m_dimensions[1] || height < m_dimensions[0])
+    {
+        if (m_rank == 0)
+            std::cerr << "A board of " << width << "x" << height << " cells cannot be split over " << m_dimensions[1]
+                      << "x" << m_dimensions[0] << " ranks" << std::endl;
+        return false;
+    }
+    m_width = width;
+    m_height = height;
+
+    // Ghost cells never reach beyond the tiles of the neighbors
+    m_ghostCells = gDistributedGhostCells;
+    for (int column(0); column < m_dimensions[1]; ++column)
+    {
+        int begin(0);
+        int end(0);
+        getColumns(column, begin, end);
+        m_ghostCells = std::min(m_ghostCells, end - begin);
+    }
+    for (int row(0); row < m_dimensions[0]; ++row)
+    {
+        int begin(0);
+        int end(0);
+        getRows(row, begin, end);
+        m_ghostCells = std::min(m_ghostCells, end - begin);
+    }
+
+    int end(0);
+    getColumns(m_coordinates[1], m_tile.x, end);
+    m_tile.width = end - m_tile.x;
+    getRows(m_coordinates[0], m_tile.y, end);
+    m_tile.height = end - m_tile.y;
+    m_tile.left = (m_neighbors[3] != MPI_PROC_NULL) ? m_ghostCells : 0;
+    m_tile.top = (m_neighbors[1] != MPI_PROC_NULL) ? m_ghostCells : 0;
+    m_tile.regionWidth = m_tile.left + m_tile.width + ((m_neighbors[5] != MPI_PROC_NULL) ? m_ghostCells : 0);
+    m_tile.regionHeight = m_tile.top + m_tile.height + ((m_neighbors[7] != MPI_PROC_NULL) ? m_ghostCells : 0);
+    m_tile.wordsPerRow = packedWords(m_tile.regionWidth);
+    m_tile.cells.assign(m_tile.wordsPerRow * m_tile.regionHeight, 0);
+
+    // Edges sent to, and ghost cells received from, each neighbor
+    for (int d(0); d < gDirections; ++d)
+    {
+        int columns = (d % 3 == 1) ? m_tile.width : m_ghostCells;
+        int rows = (d / 3 == 1) ? m_tile.height : m_ghostCells;
+        size_t words = (m_neighbors[d] != MPI_PROC_NULL) ? packedWords(columns) * rows : 0;
+        m_sent[d].assign(words, 0);
+        m_received[d].assign(words, 0);
+    }
+
+    // Bands along the neighbors: the ghost cells and twice as many cells of the tile, or the whole region
+    for (int i(0); i < 4; ++i)
+    {
+        delete m_bands[i];
+        m_bands[i] = NULL;
+        if (m_neighbors[gBandDirections[i]] == MPI_PROC_NULL)
+            continue;
+        bool horizontal = (i < 2);
+        int bandWidth = horizontal ? m_tile.regionWidth : std::min(3 * m_ghostCells, m_tile.regionWidth);
+        int bandHeight = horizontal ? std::min(3 * m_ghostCells, m_tile.regionHeight) : m_tile.regionHeight;
+        m_bands[i] = new CPUEngine(1);
+        m_bands[i]->initializeDevice(bandWidth, bandHeight);
+        m_bands[i]->setRule(m_birth, m_survival);
+    }
+
+    m_engine.initializeDevice(m_tile.width, m_tile.height, cs_packed);
+    m_engine.setRule(m_birth, m_survival);
+    m_seeded = false;
+    return true;
+}
+
+/*
+ * seed
+ */
+void DistributedEngine::seed()
+{
+    // The texture is stretched over the whole board
+    int wordsPerRow = packedWords(m_tile.width);
+    std::vector<uint32_t> cells(wordsPerRow * m_tile.height, 0);
+    for (int y(0); y < m_tile.height; ++y)
+        seedPackedRow(&m_textures[0], m_width, m_height, m_tile.x, m_tile.y + y, m_tile.width, m_limit,
+                      &cells[y * wordsPerRow]);
+    m_engine.loadState(cells);
+    storeTile(cells);
+    m_seeded = true;
+}
+
+/*
+ * storeTile: copies the packed rows of the tile into the region
+ */
+void DistributedEngine::storeTile(const std::vector<uint32_t> &cells)
+{
+    copyCells(cells, packedWords(m_tile.width), 0, 0, m_tile.cells, m_tile.wordsPerRow, m_tile.left, m_tile.top,
+              m_tile.width, m_tile.height);
+}
+
+/*
+ * postExchange: sends the edges of the tile to the neighbors, and receives their ghost cells
+ */
+void DistributedEngine::postExchange(std::vector<MPI_Request> &requests)
+{
+    for (int d(0); d < gDirections; ++d)
+    {
+        if (m_neighbors[d] == MPI_PROC_NULL)
+            continue;
+        int columns = (d % 3 == 1) ? m_tile.width : m_ghostCells;
+        int rows = (d / 3 == 1) ? m_tile.height : m_ghostCells;
+        int x = (d % 3 == 2) ? m_tile.width - m_ghostCells : 0;
+        int y = (d / 3 == 2) ? m_tile.height - m_ghostCells : 0;
+        copyCells(m_tile.cells, m_tile.wordsPerRow, m_tile.left + x, m_tile.top + y, m_sent[d], packedWords(columns),
+                  0, 0, columns, rows);
+
+        // Messages are tagged with the direction they are sent to
+        requests.push_back(MPI_REQUEST_NULL);
+        MPI_Irecv(&m_received[d][0], static_cast<int>(m_received[d].size()), MPI_UNSIGNED, m_neighbors[d],
+                  gDirections - 1 - d, m_communicator, &requests.back());
+        requests.push_back(MPI_REQUEST_NULL);
+        MPI_Isend(&m_sent[d][0], static_cast<int>(m_sent[d].size()), MPI_UNSIGNED, m_neighbors[d], d,
+                  m_communicator, &requests.back());
+    }
+}
+
+/*
+ * advanceBands: advances the bands of the region from the previous generation, now that the ghost cells are in,
+ * and replaces the cells of the tile they got right, those the engine got wrong, in cells
+ */
+void DistributedEngine::advanceBands(const int generations, std::vector<uint32_t> &cells)
+{
+    int wordsPerRow = packedWords(m_tile.width);
+    std::vector<uint32_t> band;
+    for (int i(0); i < 4; ++i)
+    {
+        if (m_bands[i] == NULL)
+            continue;
+        bool horizontal = (i < 2);
+        int bandWidth = horizontal ? m_tile.regionWidth : std::min(3 * m_ghostCells, m_tile.regionWidth);
+        int bandHeight = horizontal ? std::min(3 * m_ghostCells, m_tile.regionHeight) : m_tile.regionHeight;
+        // Band on the region, then the cells of the tile it fixes
+        int bandX = (i == 3) ? m_tile.regionWidth - bandWidth : 0;
+        int bandY = (i == 1) ? m_tile.regionHeight - bandHeight : 0;
+        int columns = horizontal ? m_tile.width : std::min(generations, m_tile.width);
+        int rows = horizontal ? std::min(generations, m_tile.height) : m_tile.height;
+        int x = (i == 3) ? m_tile.width - columns : 0;
+        int y = (i == 1) ? m_tile.height - rows : 0;
+
+        band.assign(packedWords(bandWidth) * bandHeight, 0);
+        copyCells(m_tile.cells, m_tile.wordsPerRow, bandX, bandY, band, packedWords(bandWidth), 0, 0, bandWidth,
+                  bandHeight);
+        m_bands[i]->loadState(band);
+        m_bands[i]->step(generations);
+        m_bands[i]->saveState(band);
+        copyCells(band, packedWords(bandWidth), m_tile.left + x - bandX, m_tile.top + y - bandY, cells, wordsPerRow,
+                  x, y, columns, rows);
+    }
+}
+
+void DistributedEngine::step(const unsigned int generations)
+{
+    if (!m_seeded)
+        seed();
+
+    std::vector<uint32_t> cells;
+    std::vector<MPI_Request> requests;
+    for (unsigned int done(0); done < generations;)
+    {
+        int count = static_cast<int>(std::min(static_cast<unsigned int>(m_ghostCells), generations - done));
+
+        // The engine advances the tile with stale ghost cells while the edges travel
+        requests.clear();
+        postExchange(requests);
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        m_engine.step(count);
+        m_engine.saveState(cells);
+        m_profiler.record(ps_simulation, elapsedMicroseconds(start));
+
+        start = std::chrono::high_resolution_clock::now();
+        if (!requests.empty())
+            MPI_Waitall(static_cast<int>(requests.size()), &requests[0], MPI_STATUSES_IGNORE);
+        for (int d(0); d < gDirections; ++d)
+        {
+            if (m_neighbors[d] == MPI_PROC_NULL)
+                continue;
+            int columns = (d % 3 == 1) ? m_tile.width : m_ghostCells;
+            int rows = (d / 3 == 1) ? m_tile.height : m_ghostCells;
+            int x = (d % 3 == 0) ? 0 : (d % 3 == 1) ? m_tile.left : m_tile.left + m_tile.width;
+            int y = (d / 3 == 0) ? 0 : (d / 3 == 1) ? m_tile.top : m_tile.top + m_tile.height;
+            copyCells(m_received[d], packedWords(columns), 0, 0, m_tile.cells, m_tile.wordsPerRow, x, y, columns,
+                      rows);
+        }
+        m_profiler.record(ps_exchange, elapsedMicroseconds(start));
+
+        if (!requests.empty())
+        {
+            start = std::chrono::high_resolution_clock::now();
+            advanceBands(count, cells);
+            m_engine.loadState(cells);
+            m_profiler.record(ps_simulation, elapsedMicroseconds(start));
+        }
+        storeTile(cells);
+        done += count;
+    }
+}
+
+// ---------- Checkpoints ----------
+bool DistributedEngine::saveCheckpoint(const std::string &fileName)
+{
+    MPI_File file;
+    if (MPI_File_open(m_communicator, const_cast<char *>(fileName.c_str()), MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                      MPI_INFO_NULL, &file) != MPI_SUCCESS)
+    {
+        if (m_rank == 0)
+            std::cerr << "Cannot write checkpoint " << fileName << std::endl;
+        return false;
+    }
+
+    std::vector<uint32_t> cells;
+    if (!m_seeded)
+        seed();
+    m_engine.saveState(cells);
+
+    // Rows of the tile are runs of words of the rows of the board
+    int wordsPerRow = packedWords(m_width);
+    int sizes[] = {m_height, wordsPerRow};
+    int subsizes[] = {m_tile.height, packedWords(m_tile.width)};
+    int starts[] = {m_tile.y, m_tile.x / gPackedWordBits};
+    MPI_Datatype tile;
+    MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C, MPI_UNSIGNED, &tile);
+    MPI_Type_commit(&tile);
+
+    int32_t header[] = {m_width, m_height};
+    bool success = (MPI_File_set_size(file, checkpointSize(m_width, m_height)) == MPI_SUCCESS);
+    if (m_rank == 0)
+        success = success && (MPI_File_write_at(file, 0, header, 2, MPI_INT, MPI_STATUS_IGNORE) == MPI_SUCCESS);
+    success = (MPI_File_set_view(file, gCheckpointHeader, MPI_UNSIGNED, tile, const_cast<char *>("native"),
+                                 MPI_INFO_NULL) == MPI_SUCCESS) &&
+              success;
+    success = (MPI_File_write_all(file, &cells[0], static_cast<int>(cells.size()), MPI_UNSIGNED,
+                                  MPI_STATUS_IGNORE) == MPI_SUCCESS) &&
+              success;
+    MPI_Type_free(&tile);
+    MPI_File_close(&file);
+
+    int failures = success ? 0 : 1;
+    MPI_Allreduce(MPI_IN_PLACE, &failures, 1, MPI_INT, MPI_SUM, m_communicator);
+    if (failures != 0 && m_rank == 0)
+        std::cerr << "Cannot write checkpoint " << fileName << std::endl;
+    return failures == 0;
+}
+
+bool DistributedEngine::loadCheckpoint(const std::string &fileName)
+{
+    MPI_File file;
+    if (MPI_File_open(m_communicator, const_cast<char *>(fileName.c_str()), MPI_MODE_RDONLY, MPI_INFO_NULL,
+                      &file) != MPI_SUCCESS)
+    {
+        if (m_rank == 0)
+            std::cerr << "Cannot read checkpoint " << fileName << std::endl;
+        return false;
+    }
+
+    int wordsPerRow = packedWords(m_width);
+    int32_t header[] = {0, 0};
+    MPI_Offset size(0);
+    MPI_File_get_size(file, &size);
+    MPI_File_read_at_all(file, 0, header, 2, MPI_INT, MPI_STATUS_IGNORE);
+    if (header[0] != m_width || header[1] != m_height || size != checkpointSize(m_width, m_height))
+    {
+        MPI_File_close(&file);
+        if (m_rank == 0)
+            std::cerr << "Checkpoint " << fileName << " holds a board of " << header[0] << "x" << header[1]
+                      << " cells instead of " << m_width << "x" << m_height << std::endl;
+        return false;
+    }
+
+    int sizes[] = {m_height, wordsPerRow};
+    int subsizes[] = {m_tile.height, packedWords(m_tile.width)};
+    int starts[] = {m_tile.y, m_tile.x / gPackedWordBits};
+    MPI_Datatype tile;
+    MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C, MPI_UNSIGNED, &tile);
+    MPI_Type_commit(&tile);
+
+    std::vector<uint32_t> cells(subsizes[0] * subsizes[1], 0);
+    MPI_File_set_view(file, gCheckpointHeader, MPI_UNSIGNED, tile, const_cast<char *>("native"), MPI_INFO_NULL);
+    MPI_File_read_all(file, &cells[0], static_cast<int>(cells.size()), MPI_UNSIGNED, MPI_STATUS_IGNORE);
+    MPI_Type_free(&tile);
+    MPI_File_close(&file);
+
+    // Bits beyond the last column are not cells
+    int remainder = m_tile.width % gPackedWordBits;
+    if (remainder != 0)
+        for (int y(0); y < subsizes[0]; ++y)
+            cells[(y + 1) * subsizes[1] - 1] &= (1u << remainder) - 1u;
+    m_engine.loadState(cells);
+    storeTile(cells);
+    m_seeded = true;
+    return true;
+}
+
+// ---------- Seeding and rules ----------
+void DistributedEngine::setTexture(BYTE *texture)
+{
+    // Every rank seeds its tile from the same texture
+    storeTexture(texture, &m_textures[0]);
+}
+
+bool DistributedEngine::setRule(const uint32_t birth, const uint32_t survival)
+{
+    if (!m_engine.setRule(birth, survival))
+        return false;
+    m_birth = birth;
+    m_survival = survival;
+    for (int i(0); i < 4; ++i)
+        if (m_bands[i] != NULL)
+            m_bands[i]->setRule(birth, survival);
+    return true;
+}
+
+// ---------- Reductions ----------
+unsigned long long DistributedEngine::getPopulation()
+{
+    if (!m_seeded)
+        seed();
+    std::vector<uint32_t> cells;
+    m_engine.saveState(cells);
+    unsigned long long population(0);
+    for (size_t i(0); i < cells.size(); ++i)
+        for (uint32_t bits = cells[i]; bits != 0; bits &= bits - 1)
+            ++population;
+    MPI_Allreduce(MPI_IN_PLACE, &population, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, m_communicator);
+    return population;
+}
+
+unsigned long long DistributedEngine::getChecksum()
+{
+    if (!m_seeded)
+        seed();
+    std::vector<uint32_t> cells;
+    m_engine.saveState(cells);
+    unsigned long long sum = checksumCells(cells, m_tile.width, m_tile.height, m_tile.x, m_tile.y, m_width);
+    MPI_Allreduce(MPI_IN_PLACE, &sum, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, m_communicator);
+    return sum;
+}
+
+unsigned long long DistributedEngine::checksum(const std::vector<uint32_t> &cells, const int width, const int height)
+{
+    return checksumCells(cells, width, height, 0, 0, width);
+}
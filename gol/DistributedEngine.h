@@ -0,0 +1,141 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <mpi.h>
+
+#include "CPUEngine.h"
+#include <string>
+
+// Ghost cells around a tile, and generations advanced between two exchanges
+const int gDistributedGhostCells = 16;
+
+/*
+ * Region of the board held by a rank: its tile, surrounded by the ghost cells of its neighbors on the sides
+ * where it has some. Left and right tile edges are multiples of gPackedWordBits, so that the rows of a tile are
+ * runs of words of the rows of the board.
+ */
+struct DistributedTile
+{
+    int x; // First column and row of the tile on the board
+    int y;
+    int width;
+    int height;
+
+    // Host copy of the region: ghost cells, then the tile at (left, top)
+    int left;
+    int top;
+    int regionWidth;
+    int regionHeight;
+    int wordsPerRow;
+    std::vector<uint32_t> cells;
+};
+
+/*
+ * Packed cells of a board larger than one node, split over the ranks of an MPI communicator arranged as a 2D
+ * Cartesian grid. Each rank advances its tile with the engine it is given, an OpenCLKernel or a CPUEngine with
+ * packed cells, gDistributedGhostCells generations at a time:
+ * - the edges of the tile are sent to the eight neighbors with non-blocking point-to-point messages, while
+ *   the engine advances the whole tile with stale ghosts, which only spoils its cells close to the neighbors
+ * - once the ghost cells are in, small CPU engines advance the bands of the region along each neighbor, and
+ *   the cells of the tile they got right replace the spoiled ones
+ * Cells outside of the board are dead. Every method is collective, and the engine is destroyed before
+ * MPI_Finalize().
+ */
+class GOL_API DistributedEngine
+{
+public:
+    // The engine of the tile is owned by the caller
+    DistributedEngine(MPI_Comm communicator, SimulationEngine &engine);
+    ~DistributedEngine();
+
+public:
+    // ---------- Board ----------
+    // Splits the board over the ranks and sizes the engine of the tile. Returns false when the grid has more
+    // columns than the rows of the board have words, or more rows than the board
+    bool initialize(int width, int height);
+    void step(const unsigned int generations);
+    void reset() { m_seeded = false; };
+
+    // ---------- Checkpoints ----------
+    // The file holds the width and height of the board, then its packed rows, written and read with collective
+    // MPI-IO. Returns false when the file cannot be written, or holds another board
+    bool saveCheckpoint(const std::string &fileName);
+    bool loadCheckpoint(const std::string &fileName);
+
+    // ---------- Seeding and rules ----------
+    void setTexture(BYTE *texture);
+    void setLimit(const float limit) { m_limit = limit; };
+    bool setRule(const uint32_t birth, const uint32_t survival);
+
+    // ---------- Reductions ----------
+    // Alive cells of the board
+    unsigned long long getPopulation();
+    // Order independent checksum of the alive cells of the board, as checksum() of its packed rows
+    unsigned long long getChecksum();
+    static unsigned long long checksum(const std::vector<uint32_t> &cells, const int width, const int height);
+
+    // ---------- Statistics ----------
+    ProfilingStatistics getStatistics() { return m_profiler.getStatistics(); };
+
+    int getRank() { return m_rank; };
+    int getGridWidth() { return m_dimensions[1]; };
+    int getGridHeight() { return m_dimensions[0]; };
+    int getGhostCells() { return m_ghostCells; };
+    const DistributedTile &getTile() { return m_tile; };
+
+private:
+    void seed();
+    void getColumns(int column, int &begin, int &end);
+    void getRows(int row, int &begin, int &end);
+    void postExchange(std::vector<MPI_Request> &requests);
+    void advanceBands(const int generations, std::vector<uint32_t> &cells);
+    void storeTile(const std::vector<uint32_t> &cells);
+
+private:
+    MPI_Comm m_communicator;
+    SimulationEngine &m_engine;
+    Profiler m_profiler;
+    int m_rank;
+    int m_dimensions[2]; // Rows and columns of the grid
+    int m_coordinates[2];
+    // Ranks of the neighbors, MPI_PROC_NULL outside of the grid, indexed by direction
+    int m_neighbors[9];
+
+    int m_width;
+    int m_height;
+    int m_ghostCells;
+    bool m_seeded;
+    float m_limit;
+    uint32_t m_birth;
+    uint32_t m_survival;
+    DistributedTile m_tile;
+
+    // Per direction: edge of the tile sent, and ghost cells received
+    std::vector<uint32_t> m_sent[9];
+    std::vector<uint32_t> m_received[9];
+
+    // Per side of the tile with a neighbor: engine of the band of the region along it
+    CPUEngine *m_bands[4];
+
+    std::vector<BYTE> m_textures;
+};
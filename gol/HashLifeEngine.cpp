@@ -0,0 +1,546 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "HashLifeEngine.h"
+
+// Nodes allocated at once
+const size_t gHashLifeBlockSize = 65536;
+
+static size_t hashNode(const HashLifeNode *nw, const HashLifeNode *ne, const HashLifeNode *sw,
+                       const HashLifeNode *se)
+{
+    unsigned long long hash = reinterpret_cast<size_t>(nw);
+    hash = hash * 0x9E3779B97F4A7C15ULL + reinterpret_cast<size_t>(ne);
+    hash = hash * 0x9E3779B97F4A7C15ULL + reinterpret_cast<size_t>(sw);
+    hash = hash * 0x9E3779B97F4A7C15ULL + reinterpret_cast<size_t>(se);
+    return static_cast<size_t>(hash ^ (hash >> 29));
+}
+
+/*
+ * HashLifeEngine constructor
+ */
+HashLifeEngine::HashLifeEngine()
+    : m_buckets(1024, 0)
+    , m_free(0)
+    , m_nodeCount(0)
+    , m_memoryBudget(gHashLifeMemoryBudget)
+    , m_collectionUsage(0)
+    , m_stepCacheExponent(-1)
+    , m_root(0)
+    , m_generation(0)
+    , m_width(0)
+    , m_height(0)
+    , m_wordsPerRow(0)
+    , m_seeded(false)
+    , m_limit(0.5f)
+    , m_birth(gConwayBirth)
+    , m_survival(gConwaySurvival)
+    , m_textures(gTextureWidth * gTextureHeight * gTextureDepth, 0)
+{
+    // Leaves are the only nodes of level 0, and are never collected
+    for (int i(0); i < 2; ++i)
+    {
+        HashLifeNode &leaf = m_leaves[i];
+        leaf.nw = leaf.ne = leaf.sw = leaf.se = leaf.result = leaf.next = 0;
+        leaf.population = i;
+        leaf.level = 0;
+        leaf.marked = false;
+    }
+    m_empty.push_back(&m_leaves[0]);
+}
+
+HashLifeEngine::~HashLifeEngine()
+{
+    for (size_t i(0); i < m_blocks.size(); ++i)
+        delete[] m_blocks[i];
+}
+
+// ---------- Nodes ----------
+HashLifeNode *HashLifeEngine::allocate()
+{
+    if (m_free == 0)
+    {
+        HashLifeNode *block = new HashLifeNode[gHashLifeBlockSize];
+        m_blocks.push_back(block);
+        for (size_t i(0); i < gHashLifeBlockSize; ++i)
+        {
+            block[i].next = m_free;
+            m_free = &block[i];
+        }
+    }
+    HashLifeNode *node = m_free;
+    m_free = node->next;
+    return node;
+}
+
+/*
+ * node
+ */
+HashLifeNode *HashLifeEngine::node(HashLifeNode *nw, HashLifeNode *ne, HashLifeNode *sw, HashLifeNode *se)
+{
+    size_t bucket = hashNode(nw, ne, sw, se) & (m_buckets.size() - 1);
+    for (HashLifeNode *node = m_buckets[bucket]; node != 0; node = node->next)
+        if (node->nw == nw && node->ne == ne && node->sw == sw && node->se == se)
+            return node;
+
+    HashLifeNode *node = allocate();
+    node->nw = nw;
+    node->ne = ne;
+    node->sw = sw;
+    node->se = se;
+    node->result = 0;
+    node->population = nw->population + ne->population + sw->population + se->population;
+    node->level = nw->level + 1;
+    node->marked = false;
+    node->next = m_buckets[bucket];
+    m_buckets[bucket] = node;
+    if (++m_nodeCount > m_buckets.size())
+        resize();
+    return node;
+}
+
+void HashLifeEngine::resize()
+{
+    std::vector<HashLifeNode *> buckets(m_buckets.size() * 2, 0);
+    for (size_t i(0); i < m_buckets.size(); ++i)
+    {
+        HashLifeNode *node = m_buckets[i];
+        while (node != 0)
+        {
+            HashLifeNode *next = node->next;
+            size_t bucket = hashNode(node->nw, node->ne, node->sw, node->se) & (buckets.size() - 1);
+            node->next = buckets[bucket];
+            buckets[bucket] = node;
+            node = next;
+        }
+    }
+    m_buckets.swap(buckets);
+}
+
+HashLifeNode *HashLifeEngine::empty(int level)
+{
+    while (static_cast<int>(m_empty.size()) <= level)
+    {
+        HashLifeNode *child = m_empty.back();
+        m_empty.push_back(node(child, child, child, child));
+    }
+    return m_empty[level];
+}
+
+// Same cells, one level up, surrounded by empty cells
+HashLifeNode *HashLifeEngine::expand(HashLifeNode *n)
+{
+    HashLifeNode *e = empty(n->level - 1);
+    return node(node(e, e, e, n->nw), node(e, e, n->ne, e), node(e, n->sw, e, e), node(n->se, e, e, e));
+}
+
+// Center of the node, one level down
+HashLifeNode *HashLifeEngine::centered(HashLifeNode *n)
+{
+    return node(n->nw->se, n->ne->sw, n->sw->ne, n->se->nw);
+}
+
+// ---------- Evolution ----------
+/*
+ * baseSuccessor
+ */
+HashLifeNode *HashLifeEngine::baseSuccessor(HashLifeNode *n)
+{
+    // 4x4 cells, the 2x2 center being advanced by one generation
+    int cells[4][4];
+    HashLifeNode *quadrants[] = {n->nw, n->ne, n->sw, n->se};
+    for (int q(0); q < 4; ++q)
+    {
+        int x = (q % 2) * 2;
+        int y = (q / 2) * 2;
+        cells[y][x] = static_cast<int>(quadrants[q]->nw->population);
+        cells[y][x + 1] = static_cast<int>(quadrants[q]->ne->population);
+        cells[y + 1][x] = static_cast<int>(quadrants[q]->sw->population);
+        cells[y + 1][x + 1] = static_cast<int>(quadrants[q]->se->population);
+    }
+
+    HashLifeNode *next[4];
+    for (int i(0); i < 4; ++i)
+    {
+        int x = 1 + i % 2;
+        int y = 1 + i / 2;
+        int count = cells[y - 1][x - 1] + cells[y - 1][x] + cells[y - 1][x + 1] + cells[y][x - 1] +
+                    cells[y][x + 1] + cells[y + 1][x - 1] + cells[y + 1][x] + cells[y + 1][x + 1];
+        uint32_t mask = cells[y][x] ? m_survival : m_birth;
+        next[i] = &m_leaves[(mask >> count) & 1];
+    }
+    return node(next[0], next[1], next[2], next[3]);
+}
+
+/*
+ * successor
+ *
+ * Center of the node advanced by 2^exponent generations, exponent being at most level-2. The nine overlapping
+ * subnodes of half size are advanced, or just centered for smaller steps, then recombined into four nodes
+ * whose centers are advanced again.
+ */
+HashLifeNode *HashLifeEngine::successor(HashLifeNode *n, int exponent)
+{
+    if (n->population == 0)
+        return empty(n->level - 1);
+
+    bool full = (exponent == n->level - 2);
+    if (full && n->result != 0)
+        return n->result;
+    if (!full)
+    {
+        std::unordered_map<HashLifeNode *, HashLifeNode *>::iterator it = m_stepCache.find(n);
+        if (it != m_stepCache.end())
+            return it->second;
+    }
+
+    // Nodes of the computation are kept on the stack, so that a collection in the middle of a step spares them
+    size_t stackSize = m_stack.size();
+    keep(n);
+    collectOverBudget();
+
+    HashLifeNode *result(0);
+    if (n->level == 2)
+        result = baseSuccessor(n);
+    else
+    {
+        HashLifeNode *n00 = n->nw;
+        HashLifeNode *n01 = keep(node(n->nw->ne, n->ne->nw, n->nw->se, n->ne->sw));
+        HashLifeNode *n02 = n->ne;
+        HashLifeNode *n10 = keep(node(n->nw->sw, n->nw->se, n->sw->nw, n->sw->ne));
+        HashLifeNode *n11 = keep(node(n->nw->se, n->ne->sw, n->sw->ne, n->se->nw));
+        HashLifeNode *n12 = keep(node(n->ne->sw, n->ne->se, n->se->nw, n->se->ne));
+        HashLifeNode *n20 = n->sw;
+        HashLifeNode *n21 = keep(node(n->sw->ne, n->se->nw, n->sw->se, n->se->sw));
+        HashLifeNode *n22 = n->se;
+
+        HashLifeNode *r00 = keep(full ? successor(n00, exponent - 1) : centered(n00));
+        HashLifeNode *r01 = keep(full ? successor(n01, exponent - 1) : centered(n01));
+        HashLifeNode *r02 = keep(full ? successor(n02, exponent - 1) : centered(n02));
+        HashLifeNode *r10 = keep(full ? successor(n10, exponent - 1) : centered(n10));
+        HashLifeNode *r11 = keep(full ? successor(n11, exponent - 1) : centered(n11));
+        HashLifeNode *r12 = keep(full ? successor(n12, exponent - 1) : centered(n12));
+        HashLifeNode *r20 = keep(full ? successor(n20, exponent - 1) : centered(n20));
+        HashLifeNode *r21 = keep(full ? successor(n21, exponent - 1) : centered(n21));
+        HashLifeNode *r22 = keep(full ? successor(n22, exponent - 1) : centered(n22));
+
+        // The second half of a full step, or the whole of a smaller one
+        int remaining = full ? exponent - 1 : exponent;
+        HashLifeNode *q0 = keep(successor(keep(node(r00, r01, r10, r11)), remaining));
+        HashLifeNode *q1 = keep(successor(keep(node(r01, r02, r11, r12)), remaining));
+        HashLifeNode *q2 = keep(successor(keep(node(r10, r11, r20, r21)), remaining));
+        HashLifeNode *q3 = keep(successor(keep(node(r11, r12, r21, r22)), remaining));
+        result = node(q0, q1, q2, q3);
+    }
+    m_stack.resize(stackSize);
+
+    if (full)
+        n->result = result;
+    else
+        m_stepCache[n] = result;
+    return result;
+}
+
+/*
+ * stepPower
+ */
+void HashLifeEngine::stepPower(int exponent)
+{
+    // The root is expanded until the pattern lies in its inner quarter, which it cannot leave during the step
+    for (;;)
+    {
+        HashLifeNode *root = m_root;
+        if (root->level >= exponent + 3 &&
+            root->nw->se->se->population + root->ne->sw->sw->population + root->sw->ne->ne->population +
+                    root->se->nw->nw->population ==
+                root->population)
+            break;
+        m_root = expand(m_root);
+    }
+
+    if (exponent != m_stepCacheExponent)
+    {
+        m_stepCache.clear();
+        m_stepCacheExponent = exponent;
+    }
+    m_root = successor(m_root, exponent);
+
+    // Shrinks the root back around the pattern
+    while (m_root->level > 3 &&
+           m_root->nw->se->population + m_root->ne->sw->population + m_root->sw->ne->population +
+                   m_root->se->nw->population ==
+               m_root->population)
+        m_root = centered(m_root);
+}
+
+/*
+ * advance
+ */
+void HashLifeEngine::advance(unsigned long long generations)
+{
+    if (!m_seeded)
+        seed();
+    if (generations == 0)
+        return;
+
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    for (int exponent(0); generations != 0; ++exponent, generations >>= 1)
+    {
+        if ((generations & 1) == 0)
+            continue;
+        // An empty board stays empty
+        if (m_root->population != 0)
+            stepPower(exponent);
+        m_generation += 1ULL << exponent;
+        collectOverBudget();
+    }
+    m_profiler.record(ps_simulation, elapsedMicroseconds(start));
+}
+
+unsigned long long HashLifeEngine::getPopulation()
+{
+    if (!m_seeded)
+        seed();
+    return m_root->population;
+}
+
+// ---------- Node cache ----------
+size_t HashLifeEngine::getMemoryUsage()
+{
+    // Live nodes, the free ones being reused before any block is allocated
+    return m_nodeCount * sizeof(HashLifeNode) + m_buckets.size() * sizeof(HashLifeNode *) +
+           m_stepCache.size() * 4 * sizeof(HashLifeNode *);
+}
+
+HashLifeNode *HashLifeEngine::keep(HashLifeNode *n)
+{
+    m_stack.push_back(n);
+    return n;
+}
+
+/*
+ * collectOverBudget
+ */
+void HashLifeEngine::collectOverBudget()
+{
+    if (getMemoryUsage() <= std::max(m_memoryBudget, m_collectionUsage))
+        return;
+
+    // Nodes surviving a collection cannot be freed, the next one waits for the usage to double
+    collectGarbage();
+    m_collectionUsage = 2 * getMemoryUsage();
+}
+
+void HashLifeEngine::mark(HashLifeNode *n)
+{
+    if (n->marked || n->level == 0)
+        return;
+    n->marked = true;
+    mark(n->nw);
+    mark(n->ne);
+    mark(n->sw);
+    mark(n->se);
+}
+
+/*
+ * collectGarbage
+ */
+void HashLifeEngine::collectGarbage()
+{
+    m_stepCache.clear();
+    m_stepCacheExponent = -1;
+    if (m_root)
+        mark(m_root);
+    for (size_t i(0); i < m_empty.size(); ++i)
+        mark(m_empty[i]);
+    for (size_t i(0); i < m_stack.size(); ++i)
+        mark(m_stack[i]);
+
+    // Unreachable nodes go back to the free list
+    for (size_t i(0); i < m_buckets.size(); ++i)
+    {
+        HashLifeNode **link = &m_buckets[i];
+        while (*link != 0)
+        {
+            HashLifeNode *n = *link;
+            if (n->marked)
+            {
+                link = &n->next;
+                continue;
+            }
+            *link = n->next;
+            n->next = m_free;
+            m_free = n;
+            --m_nodeCount;
+        }
+    }
+
+    // Results are kept when they survived
+    for (size_t i(0); i < m_buckets.size(); ++i)
+        for (HashLifeNode *n = m_buckets[i]; n != 0; n = n->next)
+        {
+            if (n->result != 0 && n->result->level != 0 && !n->result->marked)
+                n->result = 0;
+        }
+    for (size_t i(0); i < m_buckets.size(); ++i)
+        for (HashLifeNode *n = m_buckets[i]; n != 0; n = n->next)
+            n->marked = false;
+}
+
+void HashLifeEngine::clearResults()
+{
+    m_stepCache.clear();
+    m_stepCacheExponent = -1;
+    for (size_t i(0); i < m_buckets.size(); ++i)
+        for (HashLifeNode *n = m_buckets[i]; n != 0; n = n->next)
+            n->result = 0;
+}
+
+// ---------- Board ----------
+void HashLifeEngine::initializeDevice(int width, int height, const CellStorage)
+{
+    m_width = width;
+    m_height = height;
+    m_wordsPerRow = packedWords(width);
+    m_seeded = false;
+}
+
+/*
+ * build
+ */
+HashLifeNode *HashLifeEngine::build(const std::vector<uint32_t> &cells, int level, long long x, long long y)
+{
+    long long size = 1LL << level;
+    if (x + size <= 0 || y + size <= 0 || x >= m_width || y >= m_height)
+        return empty(level);
+    if (level == 0)
+        return &m_leaves[(cells[y * m_wordsPerRow + x / gPackedWordBits] >> (x % gPackedWordBits)) & 1];
+
+    // Empty words of the board, the node being aligned on them
+    if (level == 5 && x >= 0)
+    {
+        uint32_t bits(0);
+        for (long long row(y); row < y + size && row < m_height; ++row)
+            bits |= cells[row * m_wordsPerRow + x / gPackedWordBits];
+        if (bits == 0)
+            return empty(level);
+    }
+
+    long long half = size / 2;
+    return node(build(cells, level - 1, x, y), build(cells, level - 1, x + half, y),
+                build(cells, level - 1, x, y + half), build(cells, level - 1, x + half, y + half));
+}
+
+/*
+ * extract
+ */
+void HashLifeEngine::extract(HashLifeNode *n, long long x, long long y, std::vector<uint32_t> &cells)
+{
+    long long size = 1LL << n->level;
+    if (n->population == 0 || x + size <= 0 || y + size <= 0 || x >= m_width || y >= m_height)
+        return;
+    if (n->level == 0)
+    {
+        cells[y * m_wordsPerRow + x / gPackedWordBits] |= 1u << (x % gPackedWordBits);
+        return;
+    }
+    long long half = size / 2;
+    extract(n->nw, x, y, cells);
+    extract(n->ne, x + half, y, cells);
+    extract(n->sw, x, y + half, cells);
+    extract(n->se, x + half, y + half, cells);
+}
+
+/*
+ * seed
+ */
+void HashLifeEngine::seed()
+{
+    std::vector<uint32_t> cells(m_wordsPerRow * m_height, 0);
+    for (int y(0); y < m_height; ++y)
+        seedPackedRow(&m_textures[0], m_width, m_height, 0, y, m_width, m_limit, &cells[y * m_wordsPerRow]);
+    loadState(cells);
+}
+
+/*
+ * readback
+ */
+void HashLifeEngine::readback(BYTE *bitmap)
+{
+    std::vector<uint32_t> cells;
+    saveState(cells);
+
+    for (int y(0); y < m_height; ++y)
+        colorizePackedRow(&m_textures[0], m_width, m_height, y, &cells[y * m_wordsPerRow],
+                          bitmap + y * m_width * gColorDepth);
+}
+
+// ---------- State ----------
+void HashLifeEngine::loadState(const std::vector<uint32_t> &cells)
+{
+    if (cells.size() != static_cast<size_t>(m_wordsPerRow * m_height))
+    {
+        std::cerr << "Invalid state size" << std::endl;
+        return;
+    }
+
+    // Smallest root, centered on the origin, containing the board
+    int level(3);
+    while ((1LL << (level - 1)) < m_width || (1LL << (level - 1)) < m_height)
+        ++level;
+    long long origin = -(1LL << (level - 1));
+    m_root = build(cells, level, origin, origin);
+    m_generation = 0;
+    m_seeded = true;
+}
+
+void HashLifeEngine::saveState(std::vector<uint32_t> &cells)
+{
+    if (!m_seeded)
+        seed();
+    cells.assign(m_wordsPerRow * m_height, 0);
+    long long origin = -(1LL << (m_root->level - 1));
+    extract(m_root, origin, origin, cells);
+}
+
+// ---------- Seeding and rules ----------
+void HashLifeEngine::setTexture(int index, BYTE *texture)
+{
+    // Single texture
+    if (index != 0)
+        return;
+    storeTexture(texture, &m_textures[0]);
+}
+
+bool HashLifeEngine::setRule(const uint32_t birth, const uint32_t survival)
+{
+    // Births out of nothing would fill the unbounded plane
+    if (birth & 1)
+        return false;
+    m_birth = birth;
+    m_survival = survival;
+    clearResults();
+    return true;
+}
@@ -0,0 +1,147 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include "SimulationEngine.h"
+#include <unordered_map>
+
+// Bytes of nodes kept before unreachable nodes and their memoized results are collected
+const size_t gHashLifeMemoryBudget = 1024 * 1024 * 1024;
+
+/*
+ * Quadtree node. A node of level n covers 2^n x 2^n cells, leaves being single cells. Nodes are hash-consed:
+ * two nodes with the same children are the same node, which makes the result of a node computed once for
+ * every occurrence of the same pattern.
+ */
+struct HashLifeNode
+{
+    HashLifeNode *nw;
+    HashLifeNode *ne;
+    HashLifeNode *sw;
+    HashLifeNode *se;
+    HashLifeNode *result; // Center advanced by 2^(level-2) generations
+    HashLifeNode *next;   // Hash table chain, or free list
+    unsigned long long population;
+    int level;
+    bool marked;
+};
+
+/*
+ * HashLife engine, for long runs of structured patterns. The board is the window [0, width) x [0, height) of
+ * an unbounded plane: unlike the other engines, cells leaving the board keep evolving and may come back.
+ * Runs of generations are decomposed into power of two steps, each one being a single memoized RESULT
+ * computation on the root. Rules giving birth with 0 neighbors are rejected by setRule().
+ */
+class GOL_API HashLifeEngine : public SimulationEngine
+{
+public:
+    HashLifeEngine();
+    virtual ~HashLifeEngine();
+
+public:
+    // ---------- Board ----------
+    // Cells are always packed, the storage is ignored
+    virtual void initializeDevice(int width, int height, const CellStorage storage = cs_packed);
+    virtual void step(const unsigned int generations) { advance(generations); };
+    virtual void readback(BYTE *bitmap);
+    virtual void reset() { m_seeded = false; };
+
+    // Advances by any number of generations
+    void advance(unsigned long long generations);
+    unsigned long long getGeneration() { return m_generation; };
+    unsigned long long getPopulation();
+
+    // ---------- State ----------
+    virtual void loadState(const std::vector<uint32_t> &cells);
+    virtual void saveState(std::vector<uint32_t> &cells);
+
+    // ---------- Seeding and rules ----------
+    virtual void setTexture(int index, BYTE *texture);
+    virtual void setLimit(const float limit) { m_limit = limit; };
+    virtual bool setRule(const uint32_t birth, const uint32_t survival);
+
+    // ---------- Statistics ----------
+    virtual ProfilingStatistics getStatistics() { return m_profiler.getStatistics(); };
+
+    // ---------- Node cache ----------
+    // Bytes of the live nodes and caches over which nodes are collected, during a step as well as after it
+    void setMemoryBudget(const size_t bytes) { m_memoryBudget = bytes; };
+    size_t getMemoryUsage();
+    size_t getNodeCount() { return m_nodeCount; };
+
+    // Frees the nodes that are not part of the current generation, and the results referring to them
+    void collectGarbage();
+
+private:
+    // Nodes
+    HashLifeNode *allocate();
+    HashLifeNode *node(HashLifeNode *nw, HashLifeNode *ne, HashLifeNode *sw, HashLifeNode *se);
+    HashLifeNode *empty(int level);
+    HashLifeNode *expand(HashLifeNode *node);
+    HashLifeNode *centered(HashLifeNode *node);
+    void resize();
+    void mark(HashLifeNode *node);
+    HashLifeNode *keep(HashLifeNode *node);
+    void collectOverBudget();
+    void clearResults();
+
+    // Evolution
+    HashLifeNode *baseSuccessor(HashLifeNode *node);
+    HashLifeNode *successor(HashLifeNode *node, int exponent);
+    void stepPower(int exponent);
+
+    // Board
+    void seed();
+    HashLifeNode *build(const std::vector<uint32_t> &cells, int level, long long x, long long y);
+    void extract(HashLifeNode *node, long long x, long long y, std::vector<uint32_t> &cells);
+
+private:
+    // Hash-consed nodes, allocated by blocks
+    std::vector<HashLifeNode *> m_buckets;
+    std::vector<HashLifeNode *> m_blocks;
+    HashLifeNode *m_free;
+    size_t m_nodeCount;
+    size_t m_memoryBudget;
+    size_t m_collectionUsage;
+    HashLifeNode m_leaves[2];
+    std::vector<HashLifeNode *> m_empty;
+    // Nodes of the successors being computed
+    std::vector<HashLifeNode *> m_stack;
+
+    // Results of the nodes advanced by less than their full step, for the exponent of the current step
+    std::unordered_map<HashLifeNode *, HashLifeNode *> m_stepCache;
+    int m_stepCacheExponent;
+
+    // Current generation, the root being centered on the origin
+    HashLifeNode *m_root;
+    unsigned long long m_generation;
+
+    int m_width;
+    int m_height;
+    int m_wordsPerRow;
+    bool m_seeded;
+    float m_limit;
+    uint32_t m_birth;
+    uint32_t m_survival;
+    std::vector<BYTE> m_textures;
+    Profiler m_profiler;
+};
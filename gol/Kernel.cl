@@ -21,10 +21,8 @@
 *
 */
 
-// Textures
-__constant int gTextureWidth  = 1920;
-__constant int gTextureHeight = 1080;
-__constant int gTextureDepth  = 3;
+// Textures: RGBA images of any size, stretched over the board
+__constant sampler_t gTextureSampler = CLK_NORMALIZED_COORDS_TRUE | CLK_ADDRESS_REPEAT | CLK_FILTER_NEAREST;
 
 __constant int gVideoColor  = 4;
 __constant int gVideoWidth  = 640;
@@ -36,6 +34,56 @@ __constant int gDepthHeight = 240;
 
 __constant int   gStep = 1;
 
+// Packed cells
+__constant int  gPackedWordBits = 32;
+
+uint packedPopulation( uint word )
+{
+	word = word - ((word>>1) & 0x55555555u);
+	word = (word & 0x33333333u) + ((word>>2) & 0x33333333u);
+	return (((word + (word>>4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24;
+}
+
+// Rule of the program, see Rule::getBuildOptions(). RULE_BIRTH and RULE_SURVIVAL
+// replace the birth and survival arguments of the kernels, RULE_TABLE gives the
+// next state of every 3x3 neighborhood of an isotropic rule, and RULE_STATES the
+// states of a Generations rule. Without them, the float4 kernels keep their own
+// rule and the others take the rule as arguments.
+#ifdef RULE_BIRTH
+#define ruleBirth(birth)       (RULE_BIRTH)
+#define ruleSurvival(survival) (RULE_SURVIVAL)
+#else
+#define ruleBirth(birth)       (birth)
+#define ruleSurvival(survival) (survival)
+#endif
+
+#ifdef RULE_TABLE
+__constant uint gRuleTable[16] = { RULE_TABLE };
+#endif
+
+#ifdef RULE_STATES
+__constant int gRuleStates = RULE_STATES;
+#else
+__constant int gRuleStates = 2;
+#endif
+
+// Whether a cell is alive on the next generation. Bit 4 of the neighborhood is the
+// cell itself, bits 0 to 8 its 3x3 neighborhood in row order, and count the number
+// of alive neighbors
+int ruleNext(
+	uint neighborhood,
+	uint count,
+	uint birth,
+	uint survival)
+{
+#ifdef RULE_TABLE
+	return (gRuleTable[neighborhood>>5]>>(neighborhood&31))&1u;
+#else
+	uint mask = ( neighborhood&0x10u ) ? ruleSurvival(survival) : ruleBirth(birth);
+	return (mask>>count)&1u;
+#endif
+}
+
 int pixelPower( float4 pixel, float limit )
 {
 	return( ((pixel.x+pixel.y+pixel.z)/3.f)>limit ) ? 0 : 1;
@@ -44,63 +92,111 @@ int pixelPower( float4 pixel, float limit )
 
 // ________________________________________________________________________________
 void makeOpenGLColor( 
-	float4         color, 
-	__global char* bitmap, 
-	int            index)
+	float4           color, 
+	__global uchar4* bitmap, 
+	int              index)
 {
-	int mdc_index = index*4; 
-
-	color.x = (color.x>1.f) ? 1.f : color.x;
-	color.y = (color.y>1.f) ? 1.f : color.y; 
-	color.z = (color.z>1.f) ? 1.f : color.z;
-	color.w = (color.w>1.f) ? 1.f : color.w;
+	// Premultiplied by alpha, clamped and converted as a vector, one store per pixel
+	color = clamp(color, 0.f, 1.f);
+	float4 pixel = color*color.w;
+	pixel.w = color.w;
+	bitmap[index] = convert_uchar4_sat_rtz(pixel*256.f);
+}
 
-	color.x = (color.x<0.f) ? 0.f : color.x;
-	color.y = (color.y<0.f) ? 0.f : color.y; 
-	color.z = (color.z<0.f) ? 0.f : color.z;
-	color.w = (color.w<0.f) ? 0.f : color.w;
+// ________________________________________________________________________________
+float4 textureColor(
+	__read_only image2d_t textures,
+	int                   x,
+	int                   y,
+	int                   width,
+	int                   height)
+{
+	// Each cell samples the center of its texel, which the cpu engines compute the
+	// same way, in normalized coordinates
+	int textureWidth  = get_image_width(textures);
+	int textureHeight = get_image_height(textures);
+	float2 coordinates = (float2)(
+		((float)((long)x*textureWidth/width)+0.5f)/(float)textureWidth,
+		((float)((long)y*textureHeight/height)+0.5f)/(float)textureHeight);
 
-	unsigned char r = color.w*color.x*256.f;
-	unsigned char g = color.w*color.y*256.f;
-	unsigned char b = color.w*color.z*256.f;
-	unsigned char a = color.w*256.f;
+	float4 color = convert_float4(read_imageui(textures, gTextureSampler, coordinates))/256.f;
+	color.w = 1.f;
+	return color;
+}
 
-	bitmap[mdc_index  ] = r; // Red
-	bitmap[mdc_index+1] = g; // Green
-	bitmap[mdc_index+2] = b; // Blue
-	bitmap[mdc_index+3] = a; // Alpha
+// Next state of a cell from its neighborhood, see ruleNext()
+void gameOfLifeRule(
+	int              index,
+	uint             neighborhood,
+	__global float4* buffer,
+	int              offsetIndex,
+	int              notOffsetIndex,
+	float4           bitmapColor)
+{
+	float4 black = 0;
+	int sum = packedPopulation(neighborhood&0x1EFu);
+#ifdef RULE_STATES
+	// Alive cells are black and dead ones white, as loaded by loadState()
+	float4 white = 1.f;
+	buffer[notOffsetIndex+index] = ruleNext(neighborhood, sum, 0, 0) ? black : white;
+#else
+	// Fading rule of kernels built without a rule
+	if( sum < 1 ) 
+	{
+		// dying
+		buffer[notOffsetIndex+index] = buffer[offsetIndex+index];
+		buffer[notOffsetIndex+index].w -= 0.002f; 
+		if( buffer[notOffsetIndex+index].w <= 0.f ) 
+		{
+			buffer[notOffsetIndex] = black;
+		}
+	}
+	else
+	{
+		if( sum > 7 ) 
+		{
+			// dead
+			buffer[notOffsetIndex+index] = black;
+		}
+		else 
+		{
+			// alive
+			buffer[notOffsetIndex+index] = bitmapColor;
+		}
+	}
+#endif
 }
 
 void gameOfLife(
-	int              x,
-	int              y,
-	int              width,
-	int              height,
-	__global char*   bitmap,
-	__global float4* buffer,
-	__global char*   video,
-	__global char*   depth,
-	__global char*   textures,
-	int              offset,
-	float            limit,
-	float            timer)
+	int                   x,
+	int                   y,
+	int                   width,
+	int                   height,
+	__global float4*      buffer,
+	__global char*        video,
+	__global char*        depth,
+	__read_only image2d_t textures,
+	int                   offset,
+	float                 limit,
+	float                 timer,
+	__global uchar*       mask)
 {
 	int index = y*width+x;
 
 	float4 black = 0;
-	float4 bitmapColor;
-	bitmapColor.x = ((unsigned char)textures[index*gTextureDepth+0])/256.f;
-	bitmapColor.y = ((unsigned char)textures[index*gTextureDepth+1])/256.f;
-	bitmapColor.z = ((unsigned char)textures[index*gTextureDepth+2])/256.f;
-	bitmapColor.w = 1.f;
+	float4 bitmapColor = textureColor(textures, x, y, width, height);
 
 	int outputSize = height*width;
 
 	if( offset == -1 ) 
 	{
+#ifdef RULE_STATES
+		// The rule starts from the texture
+		buffer[index] = bitmapColor;
+#else
 		buffer[index] = black;
+#endif
 		buffer[index+outputSize] = bitmapColor;
-		makeOpenGLColor( bitmapColor, bitmap, index ); 
 	}
 	else
 	{
@@ -109,8 +205,6 @@ void gameOfLife(
 			int offsetIndex =    ( offset == 0 ) ? 0 : outputSize;
 			int notOffsetIndex = ( offset == 0 ) ? outputSize : 0;
 
-			makeOpenGLColor( buffer[offsetIndex+index], bitmap, index ); 
-
 			int indexTop         = (y-gStep)*width + x;
 			int indexTopRight    = (y-gStep)*width + x+gStep;
 			int indexRight       = y*width         + x+gStep;
@@ -120,66 +214,40 @@ void gameOfLife(
 			int indexLeft        = y*width         + x-gStep;
 			int indexTopLeft     = (y-gStep)*width + x-gStep;
 
-			int sum = 0;
-
-			sum = sum + pixelPower(buffer[offsetIndex+indexTop],limit);
-			sum = sum + pixelPower(buffer[offsetIndex+indexTopRight],limit);
-			sum = sum + pixelPower(buffer[offsetIndex+indexRight],limit);
-			sum = sum + pixelPower(buffer[offsetIndex+indexBottomRight],limit);
-			sum = sum + pixelPower(buffer[offsetIndex+indexBottom],limit);
-			sum = sum + pixelPower(buffer[offsetIndex+indexBottomLeft],limit);
-			sum = sum + pixelPower(buffer[offsetIndex+indexLeft],limit);
-			sum = sum + pixelPower(buffer[offsetIndex+indexTopLeft],limit);
+			// Alive cells of the current generation, see alive_kernel
+			uint neighborhood =
+				(mask[indexTopLeft]<<0) |
+				(mask[indexTop]<<1) |
+				(mask[indexTopRight]<<2) |
+				(mask[indexLeft]<<3) |
+				(mask[index]<<4) |
+				(mask[indexRight]<<5) |
+				(mask[indexBottomLeft]<<6) |
+				(mask[indexBottom]<<7) |
+				(mask[indexBottomRight]<<8);
 
-			if( sum < 1 ) 
-			{
-				// dying
-				buffer[notOffsetIndex+index] = buffer[offsetIndex+index];
-				buffer[notOffsetIndex+index].w -= 0.002f; 
-				if( buffer[notOffsetIndex+index].w <= 0.f ) 
-				{
-					buffer[notOffsetIndex] = black;
-				}
-			}
-			else
-			{
-				if( sum > 7 ) 
-				{
-					// dead
-					buffer[notOffsetIndex+index] = black;
-				}
-				else 
-				{
-					// alive
-					buffer[notOffsetIndex+index] = bitmapColor;
-				}
-			}
+			gameOfLifeRule( index, neighborhood, buffer, offsetIndex, notOffsetIndex, bitmapColor );
 		}
 	}
 }
 
 void average(
-	int              x,
-	int              y,
-	int              width,
-	int              height,
-	__global char*   bitmap,
-	__global float4* buffer,
-	__global char*   video,
-	__global char*   depth,
-	__global char*   textures,
-	int              offset,
-	float            limit,
-	float            timer)
+	int                   x,
+	int                   y,
+	int                   width,
+	int                   height,
+	__global float4*      buffer,
+	__global char*        video,
+	__global char*        depth,
+	__read_only image2d_t textures,
+	int                   offset,
+	float                 limit,
+	float                 timer)
 {
 	int index = y*width+x;
 
 	float4 black = 0;
-	float4 bitmapColor;
-	bitmapColor.x = ((unsigned char)textures[index*gTextureDepth+0])/256.f;
-	bitmapColor.y = ((unsigned char)textures[index*gTextureDepth+1])/256.f;
-	bitmapColor.z = ((unsigned char)textures[index*gTextureDepth+2])/256.f;
-	bitmapColor.w = 1.f;
+	float4 bitmapColor = textureColor(textures, x, y, width, height);
 
 	int outputSize = height*width;
 
@@ -188,7 +256,6 @@ void average(
 		// Initialization
 		buffer[index] = bitmapColor;
 		buffer[index+outputSize] = bitmapColor;
-		makeOpenGLColor( bitmapColor, bitmap, index ); 
 	}
 	else
 	{
@@ -197,8 +264,6 @@ void average(
 
 		if( x>gStep && x<width-gStep && y>gStep && y<height-gStep ) 
 		{
-			makeOpenGLColor( buffer[offsetIndex+index], bitmap, index ); 
-
 			int indexTop         = (y-gStep)*width + x;
 			int indexTopRight    = (y-gStep)*width + x+gStep;
 			int indexRight       = y*width         + x+gStep;
@@ -234,17 +299,1063 @@ void average(
 * ________________________________________________________________________________
 */
 __kernel void main_kernel(
+	int                   width,
+	int                   height,
+	__global float4*      buffer,
+	__global char*        video,
+	__global char*        depth,
+	__read_only image2d_t textures,
+	int                   offset,
+	float                 limit,
+	float                 timer,
+	__global uchar*       mask)
+{
+	// The global work size may be rounded up to a multiple of the work-group size
+	if( get_global_id(0)>=width || get_global_id(1)>=height ) return;
+	gameOfLife( get_global_id(0), get_global_id(1), width, height, buffer, video, depth, textures, offset, limit, timer, mask );
+}
+
+/**
+* ________________________________________________________________________________
+* Alive mask
+*
+* Threshold pass of the float4 cells: one byte per cell, 1 when the color of the
+* current generation is alive under limit, so that the kernels reading neighbors
+* load one byte instead of averaging a float4 nine times. Run once before each
+* generation, limit being free to change from one generation to the next.
+* ________________________________________________________________________________
+*/
+__kernel void alive_kernel(
+	int              width,
+	int              height,
+	__global float4* buffer,
+	__global uchar*  mask,
+	int              offset,
+	float            limit)
+{
+	int x = get_global_id(0);
+	int y = get_global_id(1);
+	if( x>=width || y>=height ) return;
+
+	int index = y*width+x;
+	mask[index] = pixelPower(buffer[(( offset == 0 ) ? 0 : width*height) + index], limit);
+}
+
+/**
+* ________________________________________________________________________________
+* Average Kernel
+* ________________________________________________________________________________
+*/
+__kernel void average_kernel(
+	int                   width,
+	int                   height,
+	__global float4*      buffer,
+	__global char*        video,
+	__global char*        depth,
+	__read_only image2d_t textures,
+	int                   offset,
+	float                 limit,
+	float                 timer)
+{
+	if( get_global_id(0)>=width || get_global_id(1)>=height ) return;
+	average( get_global_id(0), get_global_id(1), width, height, buffer, video, depth, textures, offset, limit, timer );
+}
+
+/**
+* ________________________________________________________________________________
+* Colorize Kernel
+*
+* Turns the current generation into an OpenGL frame. Only run when a frame is
+* requested, the simulation kernels never touch the bitmap.
+* ________________________________________________________________________________
+*/
+__kernel void colorize_kernel(
+	int              width,
+	int              height,
+	__global uchar4* bitmap,
+	__global float4* buffer,
+	int              offset)
+{
+	int x = get_global_id(0);
+	int y = get_global_id(1);
+	if( x>=width || y>=height ) return;
+
+	// Border cells are never updated and remain black
+	int index = y*width+x;
+	float4 black = 0;
+	int offsetIndex = ( offset == 0 ) ? 0 : height*width;
+	bool inside = ( x>gStep && x<width-gStep && y>gStep && y<height-gStep );
+	makeOpenGLColor( inside ? buffer[offsetIndex+index] : black, bitmap, index );
+}
+
+/**
+* ________________________________________________________________________________
+* Tiled Kernel
+*
+* Same rule as main_kernel, but each work-group first stages the alive mask of its
+* TILE_WIDTH x TILE_HEIGHT tile and of a one-cell halo in local memory, so that
+* every cell is read from global memory once instead of nine times.
+* The work-group size must match the tile.
+* ________________________________________________________________________________
+*/
+#ifndef TILE_WIDTH
+#define TILE_WIDTH 16
+#endif
+#ifndef TILE_HEIGHT
+#define TILE_HEIGHT 8
+#endif
+#define TILE_HALO 1
+#define TILE_PITCH (TILE_WIDTH+2*TILE_HALO)
+#define TILE_SIZE (TILE_PITCH*(TILE_HEIGHT+2*TILE_HALO))
+
+__kernel __attribute__((reqd_work_group_size(TILE_WIDTH, TILE_HEIGHT, 1)))
+void tiled_kernel(
+	int                   width,
+	int                   height,
+	__global float4*      buffer,
+	__global char*        video,
+	__global char*        depth,
+	__read_only image2d_t textures,
+	int                   offset,
+	float                 limit,
+	float                 timer,
+	__global uchar*       mask)
+{
+	__local int alive[TILE_SIZE];
+
+	int x = get_global_id(0);
+	int y = get_global_id(1);
+	bool inside = ( x<width && y<height );
+
+	if( offset == -1 )
+	{
+		// Initialization does not read any neighbor
+		if( inside ) gameOfLife( x, y, width, height, buffer, video, depth, textures, offset, limit, timer, mask );
+		return;
+	}
+
+	int outputSize     = height*width;
+	int offsetIndex    = ( offset == 0 ) ? 0 : outputSize;
+	int notOffsetIndex = ( offset == 0 ) ? outputSize : 0;
+
+	// Stage tile and halo
+	int originX = get_group_id(0)*TILE_WIDTH  - TILE_HALO;
+	int originY = get_group_id(1)*TILE_HEIGHT - TILE_HALO;
+	for( int i=get_local_id(1)*TILE_WIDTH+get_local_id(0); i<TILE_SIZE; i+=TILE_WIDTH*TILE_HEIGHT )
+	{
+		int tileX = originX + i%TILE_PITCH;
+		int tileY = originY + i/TILE_PITCH;
+		alive[i] = ( tileX>=0 && tileX<width && tileY>=0 && tileY<height ) ? mask[tileY*width+tileX] : 0;
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	if( inside && x>gStep && x<width-gStep && y>gStep && y<height-gStep )
+	{
+		int index = y*width+x;
+		int center = (get_local_id(1)+TILE_HALO)*TILE_PITCH + get_local_id(0)+TILE_HALO;
+		uint neighborhood =
+			(alive[center-TILE_PITCH-1]<<0) | (alive[center-TILE_PITCH]<<1) | (alive[center-TILE_PITCH+1]<<2) |
+			(alive[center-1]<<3)            | (alive[center]<<4)            | (alive[center+1]<<5) |
+			(alive[center+TILE_PITCH-1]<<6) | (alive[center+TILE_PITCH]<<7) | (alive[center+TILE_PITCH+1]<<8);
+
+		gameOfLifeRule( index, neighborhood, buffer, offsetIndex, notOffsetIndex, textureColor(textures, x, y, width, height) );
+	}
+}
+
+/**
+* ________________________________________________________________________________
+* Packed cells
+*
+* Each cell is a single bit, 32 cells per word, bit i of word w being cell w*32+i
+* of the row. A work-item advances one word, counting the eight neighbors of its
+* 32 cells in parallel with a bit-sliced adder tree. Cells outside of the board
+* are dead.
+* ________________________________________________________________________________
+*/
+uint packedWord(
+	__global uint* cells,
+	int            x,
+	int            y,
+	int            wordsPerRow,
+	int            height)
+{
+	return ( x>=0 && x<wordsPerRow && y>=0 && y<height ) ? cells[y*wordsPerRow+x] : 0;
+}
+
+uint packedValidBits(
+	int x,
+	int width,
+	int wordsPerRow)
+{
+	int remainder = width%gPackedWordBits;
+	return ( x==wordsPerRow-1 && remainder!=0 ) ? (1u<<remainder)-1u : 0xFFFFFFFFu;
+}
+
+uint packedRule(
+	uint alive,
+	uint s0,
+	uint s1,
+	uint s2,
+	uint s3,
+	uint birth,
+	uint survival)
+{
+	uint next = 0;
+	for( int count=0; count<9; ++count )
+	{
+		// Cells having exactly 'count' neighbors
+		uint match =
+			((count&1) ? s0 : ~s0) &
+			((count&2) ? s1 : ~s1) &
+			((count&4) ? s2 : ~s2) &
+			((count&8) ? s3 : ~s3);
+		uint born  = 0u-((birth>>count)&1u);
+		uint stays = 0u-((survival>>count)&1u);
+		next |= match & ((alive&stays) | (~alive&born));
+	}
+	return next;
+}
+
+uint packedNextWord(
+	uint northWest, uint north,  uint northEast,
+	uint west,      uint center, uint east,
+	uint southWest, uint south,  uint southEast,
+	uint birth,
+	uint survival)
+{
+	// Neighbors at x-1 and x+1, carrying bits across word boundaries
+	uint n  = north;
+	uint nw = (north<<1)  | (northWest>>31);
+	uint ne = (north>>1)  | (northEast<<31);
+	uint w  = (center<<1) | (west>>31);
+	uint e  = (center>>1) | (east<<31);
+	uint s  = south;
+	uint sw = (south<<1)  | (southWest>>31);
+	uint se = (south>>1)  | (southEast<<31);
+
+	// Row above and row below: full adders
+	uint top0    = nw^n^ne;
+	uint top1    = (nw&n) | (ne&(nw^n));
+	uint bottom0 = sw^s^se;
+	uint bottom1 = (sw&s) | (se&(sw^s));
+	// Current row: half adder
+	uint middle0 = w^e;
+	uint middle1 = w&e;
+
+	// Ones
+	uint s0     = top0^bottom0^middle0;
+	uint carry0 = (top0&bottom0) | (middle0&(top0^bottom0));
+	// Twos
+	uint twos   = top1^bottom1^middle1;
+	uint carry1 = (top1&bottom1) | (middle1&(top1^bottom1));
+	uint s1     = twos^carry0;
+	uint carry2 = twos&carry0;
+	// Fours and eights
+	uint s2     = carry1^carry2;
+	uint s3     = carry1&carry2;
+
+	return packedRule( center, s0, s1, s2, s3, birth, survival );
+}
+
+__kernel void packed_init_kernel(
+	int                   width,
+	int                   height,
+	int                   wordsPerRow,
+	__global uint*        cells,
+	__read_only image2d_t textures,
+	float                 limit)
+{
+	int x = get_global_id(0);
+	int y = get_global_id(1);
+	if( x>=wordsPerRow || y>=height ) return;
+
+	uint word = 0;
+	for( int bit=0; bit<gPackedWordBits; ++bit )
+	{
+		int column = x*gPackedWordBits+bit;
+		if( column<width )
+		{
+			word |= ((uint)pixelPower(textureColor(textures, column, y, width, height), limit))<<bit;
+		}
+	}
+	cells[y*wordsPerRow+x] = word;
+}
+
+__kernel void packed_scatter_kernel(
+	__global uint*       cells,
+	__global const uint* words,
+	int                  count)
+{
+	// Alive words of a pattern as pairs of index and bits, parts of the pattern possibly sharing a word
+	int i = get_global_id(0);
+	if( i>=count ) return;
+
+	atomic_or(&cells[words[2*i]], words[2*i+1]);
+}
+
+__kernel void packed_kernel(
+	int              width,
+	int              height,
+	int              wordsPerRow,
+	__global uint*   cells,
+	int              offset,
+	uint             birth,
+	uint             survival)
+{
+	int x = get_global_id(0);
+	int y = get_global_id(1);
+	if( x>=wordsPerRow || y>=height ) return;
+
+	int generationSize = wordsPerRow*height;
+	__global uint* source      = cells + (( offset == 0 ) ? 0 : generationSize);
+	__global uint* destination = cells + (( offset == 0 ) ? generationSize : 0);
+
+	uint next = packedNextWord(
+		packedWord(source, x-1, y-1, wordsPerRow, height),
+		packedWord(source, x,   y-1, wordsPerRow, height),
+		packedWord(source, x+1, y-1, wordsPerRow, height),
+		packedWord(source, x-1, y,   wordsPerRow, height),
+		packedWord(source, x,   y,   wordsPerRow, height),
+		packedWord(source, x+1, y,   wordsPerRow, height),
+		packedWord(source, x-1, y+1, wordsPerRow, height),
+		packedWord(source, x,   y+1, wordsPerRow, height),
+		packedWord(source, x+1, y+1, wordsPerRow, height),
+		ruleBirth(birth), ruleSurvival(survival) );
+
+	destination[y*wordsPerRow+x] = next & packedValidBits(x, width, wordsPerRow);
+}
+
+__kernel void packed_colorize_kernel(
+	int                   width,
+	int                   height,
+	int                   wordsPerRow,
+	__global uchar4*      bitmap,
+	__global uint*        cells,
+	__read_only image2d_t textures,
+	int                   offset)
+{
+	int x = get_global_id(0);
+	int y = get_global_id(1);
+	if( x>=width || y>=height ) return;
+
+	__global uint* source = cells + (( offset == 0 ) ? 0 : wordsPerRow*height);
+	uint word = source[y*wordsPerRow + x/gPackedWordBits];
+	float4 black = 0;
+	float4 color = ((word>>(x%gPackedWordBits))&1u) ? textureColor(textures, x, y, width, height) : black;
+	makeOpenGLColor( color, bitmap, y*width+x );
+}
+
+/**
+* ________________________________________________________________________________
+* Temporal blocking of packed cells
+*
+* A work-group advances a tile of TEMPORAL_WORDS x TEMPORAL_ROWS packed words by
+* up to TEMPORAL_MAX_GENERATIONS generations in local memory. The tile is staged
+* with a halo of one word horizontally and one row per generation vertically:
+* errors coming from the unknown cells beyond the halo spread by one cell per
+* generation and never reach the tile. Only the tile is written back.
+* ________________________________________________________________________________
+*/
+#ifndef TEMPORAL_WORDS
+#define TEMPORAL_WORDS 8
+#endif
+#ifndef TEMPORAL_ROWS
+#define TEMPORAL_ROWS 32
+#endif
+#ifndef TEMPORAL_GROUP_ROWS
+#define TEMPORAL_GROUP_ROWS 16
+#endif
+#ifndef TEMPORAL_MAX_GENERATIONS
+#define TEMPORAL_MAX_GENERATIONS 8
+#endif
+#define TEMPORAL_PITCH (TEMPORAL_WORDS+2)
+#define TEMPORAL_SIZE (TEMPORAL_PITCH*(TEMPORAL_ROWS+2*TEMPORAL_MAX_GENERATIONS))
+
+uint stagedWord(
+	__local uint* staged,
+	int           column,
+	int           row,
+	int           stagedRows)
+{
+	return ( column>=0 && column<TEMPORAL_PITCH && row>=0 && row<stagedRows ) ? staged[row*TEMPORAL_PITCH+column] : 0;
+}
+
+__kernel __attribute__((reqd_work_group_size(TEMPORAL_WORDS, TEMPORAL_GROUP_ROWS, 1)))
+void packed_temporal_kernel(
+	int              width,
+	int              height,
+	int              wordsPerRow,
+	__global uint*   cells,
+	int              offset,
+	uint             birth,
+	uint             survival,
+	int              generations)
+{
+	__local uint stagedA[TEMPORAL_SIZE];
+	__local uint stagedB[TEMPORAL_SIZE];
+
+	int generationSize = wordsPerRow*height;
+	__global uint* source      = cells + (( offset == 0 ) ? 0 : generationSize);
+	__global uint* destination = cells + (( offset == 0 ) ? generationSize : 0);
+
+	int stagedRows = TEMPORAL_ROWS+2*generations;
+	int stagedSize = TEMPORAL_PITCH*stagedRows;
+	int originX = get_group_id(0)*TEMPORAL_WORDS - 1;
+	int originY = get_group_id(1)*TEMPORAL_ROWS  - generations;
+	int first   = get_local_id(1)*TEMPORAL_WORDS + get_local_id(0);
+	int stride  = TEMPORAL_WORDS*TEMPORAL_GROUP_ROWS;
+
+	// Stage tile and halo
+	for( int i=first; i<stagedSize; i+=stride )
+	{
+		stagedA[i] = packedWord(source, originX+i%TEMPORAL_PITCH, originY+i/TEMPORAL_PITCH, wordsPerRow, height);
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	__local uint* current = stagedA;
+	__local uint* next    = stagedB;
+	for( int generation=0; generation<generations; ++generation )
+	{
+		for( int i=first; i<stagedSize; i+=stride )
+		{
+			int column = i%TEMPORAL_PITCH;
+			int row    = i/TEMPORAL_PITCH;
+			int x      = originX+column;
+			int y      = originY+row;
+			uint word = 0;
+			if( x>=0 && x<wordsPerRow && y>=0 && y<height )
+			{
+				word = packedNextWord(
+					stagedWord(current, column-1, row-1, stagedRows),
+					stagedWord(current, column,   row-1, stagedRows),
+					stagedWord(current, column+1, row-1, stagedRows),
+					stagedWord(current, column-1, row,   stagedRows),
+					stagedWord(current, column,   row,   stagedRows),
+					stagedWord(current, column+1, row,   stagedRows),
+					stagedWord(current, column-1, row+1, stagedRows),
+					stagedWord(current, column,   row+1, stagedRows),
+					stagedWord(current, column+1, row+1, stagedRows),
+					ruleBirth(birth), ruleSurvival(survival) ) & packedValidBits(x, width, wordsPerRow);
+			}
+			next[i] = word;
+		}
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		__local uint* swap = current;
+		current = next;
+		next    = swap;
+	}
+
+	// Write the tile back
+	for( int i=first; i<TEMPORAL_WORDS*TEMPORAL_ROWS; i+=stride )
+	{
+		int column = 1+i%TEMPORAL_WORDS;
+		int row    = generations+i/TEMPORAL_WORDS;
+		int x      = originX+column;
+		int y      = originY+row;
+		if( x<wordsPerRow && y<height )
+		{
+			destination[y*wordsPerRow+x] = current[row*TEMPORAL_PITCH+column];
+		}
+	}
+}
+
+/**
+* ________________________________________________________________________________
+* Active tiles of packed cells
+*
+* The board is split into tiles of ACTIVE_WORDS x ACTIVE_ROWS packed words, each
+* tile keeping a flag per generation telling whether it changed. A tile can only
+* change when it, or one of its eight neighbors, changed in the previous
+* generation: the other tiles are skipped, their previous generation already
+* holding the same cells. The list of active tiles is compacted on the device and
+* one work-group is launched per tile, the groups beyond the list returning at
+* once.
+* ________________________________________________________________________________
+*/
+#ifndef ACTIVE_WORDS
+#define ACTIVE_WORDS 8
+#endif
+#ifndef ACTIVE_ROWS
+#define ACTIVE_ROWS 32
+#endif
+
+__kernel void active_tiles_kernel(
+	int              tilesPerRow,
+	int              tileRows,
+	__global int*    flags,
+	__global int*    tiles,
+	__global int*    counts,
+	int              offset)
+{
+	int tile = get_global_id(0);
+	int tileCount = tilesPerRow*tileRows;
+	if( tile>=tileCount ) return;
+
+	__global int* changed = flags + (( offset == 0 ) ? 0 : tileCount);
+	__global int* next    = flags + (( offset == 0 ) ? tileCount : 0);
+
+	int tileX = tile%tilesPerRow;
+	int tileY = tile/tilesPerRow;
+	int active = 0;
+	for( int y=max(tileY-1,0); y<=min(tileY+1,tileRows-1); ++y )
+	{
+		for( int x=max(tileX-1,0); x<=min(tileX+1,tilesPerRow-1); ++x )
+		{
+			active |= changed[y*tilesPerRow+x];
+		}
+	}
+
+	next[tile] = 0;
+	if( active!=0 )
+	{
+		tiles[atomic_inc(&counts[offset])] = tile;
+	}
+}
+
+__kernel __attribute__((reqd_work_group_size(ACTIVE_WORDS, ACTIVE_ROWS, 1)))
+void packed_active_kernel(
+	int              width,
+	int              height,
+	int              wordsPerRow,
+	__global uint*   cells,
+	int              offset,
+	uint             birth,
+	uint             survival,
+	int              tilesPerRow,
+	__global int*    flags,
+	__global int*    tiles,
+	__global int*    counts)
+{
+	__local int changed;
+
+	int first = ( get_local_id(0)==0 && get_local_id(1)==0 );
+	if( first && get_group_id(0)==0 )
+	{
+		// List of the next generation
+		counts[1-offset] = 0;
+	}
+	if( get_group_id(0)>=counts[offset] ) return;
+
+	if( first ) changed = 0;
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	int generationSize = wordsPerRow*height;
+	__global uint* source      = cells + (( offset == 0 ) ? 0 : generationSize);
+	__global uint* destination = cells + (( offset == 0 ) ? generationSize : 0);
+
+	int tile = tiles[get_group_id(0)];
+	int x = (tile%tilesPerRow)*ACTIVE_WORDS + get_local_id(0);
+	int y = (tile/tilesPerRow)*ACTIVE_ROWS  + get_local_id(1);
+	if( x<wordsPerRow && y<height )
+	{
+		uint word = packedWord(source, x, y, wordsPerRow, height);
+		uint next = packedNextWord(
+			packedWord(source, x-1, y-1, wordsPerRow, height),
+			packedWord(source, x,   y-1, wordsPerRow, height),
+			packedWord(source, x+1, y-1, wordsPerRow, height),
+			packedWord(source, x-1, y,   wordsPerRow, height),
+			word,
+			packedWord(source, x+1, y,   wordsPerRow, height),
+			packedWord(source, x-1, y+1, wordsPerRow, height),
+			packedWord(source, x,   y+1, wordsPerRow, height),
+			packedWord(source, x+1, y+1, wordsPerRow, height),
+			ruleBirth(birth), ruleSurvival(survival) ) & packedValidBits(x, width, wordsPerRow);
+		destination[y*wordsPerRow+x] = next;
+		if( next!=word ) changed = 1;
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	if( first && changed!=0 )
+	{
+		int tileCount = tilesPerRow*((height+ACTIVE_ROWS-1)/ACTIVE_ROWS);
+		flags[(( offset == 0 ) ? tileCount : 0)+tile] = 1;
+	}
+}
+
+/**
+* ________________________________________________________________________________
+* Chunks of an unbounded board
+*
+* The board is a sparse set of CHUNK_SIZE x CHUNK_SIZE chunks of packed cells,
+* two generations per chunk slot. A work-group advances one chunk of the batch,
+* the words beyond its borders being read from the neighbor chunks given by the
+* batch table, missing neighbors being dead. Each chunk also reports which of
+* its neighbors its alive cells touch, bit 4 telling that the chunk itself is
+* not empty, so that the host creates and frees chunks as the pattern moves.
+* ________________________________________________________________________________
+*/
+#ifndef CHUNK_SIZE
+#define CHUNK_SIZE 64
+#endif
+#define CHUNK_WORDS (CHUNK_SIZE/gPackedWordBits)
+#define CHUNK_WORD_COUNT (CHUNK_WORDS*CHUNK_SIZE)
+
+uint chunkWord(
+	__global uint* chunks,
+	__global int*  neighbors,
+	int            x,
+	int            y,
+	int            offset)
+{
+	int column = ( x<0 ) ? 0 : (( x>=CHUNK_WORDS ) ? 2 : 1);
+	int row    = ( y<0 ) ? 0 : (( y>=CHUNK_SIZE ) ? 2 : 1);
+	int slot = neighbors[row*3+column];
+	if( slot<0 ) return 0;
+	x -= (column-1)*CHUNK_WORDS;
+	y -= (row-1)*CHUNK_SIZE;
+	return chunks[(slot*2+offset)*CHUNK_WORD_COUNT + y*CHUNK_WORDS + x];
+}
+
+__kernel __attribute__((reqd_work_group_size(CHUNK_WORDS, CHUNK_SIZE, 1)))
+void chunk_kernel(
+	__global uint*   chunks,
+	__global int*    neighbors,
+	__global uint*   summaries,
+	int              offset,
+	uint             birth,
+	uint             survival)
+{
+	__local uint summary;
+
+	int x = get_local_id(0);
+	int y = get_local_id(1);
+	int chunk = get_group_id(2);
+	int first = ( x==0 && y==0 );
+	if( first ) summary = 0;
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// Neighbors of the chunk, row by row, the chunk itself being the fifth one. Births
+	// with 0 neighbors would fill the unbounded board
+	__global int* table = neighbors + chunk*9;
+	uint next = packedNextWord(
+		chunkWord(chunks, table, x-1, y-1, offset),
+		chunkWord(chunks, table, x,   y-1, offset),
+		chunkWord(chunks, table, x+1, y-1, offset),
+		chunkWord(chunks, table, x-1, y,   offset),
+		chunkWord(chunks, table, x,   y,   offset),
+		chunkWord(chunks, table, x+1, y,   offset),
+		chunkWord(chunks, table, x-1, y+1, offset),
+		chunkWord(chunks, table, x,   y+1, offset),
+		chunkWord(chunks, table, x+1, y+1, offset),
+		ruleBirth(birth)&~1u, ruleSurvival(survival) );
+	chunks[(table[4]*2+1-offset)*CHUNK_WORD_COUNT + y*CHUNK_WORDS + x] = next;
+
+	if( next!=0 )
+	{
+		int north = ( y==0 );
+		int south = ( y==CHUNK_SIZE-1 );
+		int west  = ( x==0 && (next&1u)!=0 );
+		int east  = ( x==CHUNK_WORDS-1 && (next>>31)!=0 );
+		uint bits = 1u<<4;
+		bits |= ( north ) ? 1u<<1 : 0;
+		bits |= ( south ) ? 1u<<7 : 0;
+		bits |= ( west ) ? 1u<<3 : 0;
+		bits |= ( east ) ? 1u<<5 : 0;
+		bits |= ( north && west ) ? 1u<<0 : 0;
+		bits |= ( north && east ) ? 1u<<2 : 0;
+		bits |= ( south && west ) ? 1u<<6 : 0;
+		bits |= ( south && east ) ? 1u<<8 : 0;
+		atomic_or(&summary, bits);
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	if( first ) summaries[chunk] = summary;
+}
+
+__kernel void chunk_window_kernel(
+	int              width,
+	int              height,
+	int              wordsPerRow,
+	__global uint*   cells,
+	__global uint*   chunks,
+	__global int*    windowSlots,
+	int              offset)
+{
+	// Packed words of the board window [0,width) x [0,height), chunk (0,0) starting at its origin
+	int x = get_global_id(0);
+	int y = get_global_id(1);
+	if( x>=wordsPerRow || y>=height ) return;
+
+	int chunksPerRow = (wordsPerRow+CHUNK_WORDS-1)/CHUNK_WORDS;
+	int slot = windowSlots[(y/CHUNK_SIZE)*chunksPerRow + x/CHUNK_WORDS];
+	uint word = ( slot<0 ) ? 0 : chunks[(slot*2+offset)*CHUNK_WORD_COUNT + (y%CHUNK_SIZE)*CHUNK_WORDS + x%CHUNK_WORDS];
+	cells[y*wordsPerRow+x] = word & packedValidBits(x, width, wordsPerRow);
+}
+
+/**
+* ________________________________________________________________________________
+* Cell states
+*
+* Two bytes per cell instead of the two float4 colors: the state in the low byte,
+* 0 for dead cells, 1 for alive ones, and 2 to gRuleStates-1 for the dying cells
+* of a Generations rule, which age by one state per generation and are not counted
+* as neighbors. The high byte is the age, generations since the cell was last
+* alive up to gStateMaxAge, and only fades the cells out in state_colorize_kernel,
+* the texture being read there and when seeding only. Any rule of the program
+* applies, the transition table of an isotropic rule included. Cells outside of
+* the board are dead.
+* ________________________________________________________________________________
+*/
+__constant uint gStateMaxAge = 255;
+
+uint stateAlive(
+	__global ushort* states,
+	int              x,
+	int              y,
+	int              width,
+	int              height)
+{
+	return ( x>=0 && x<width && y>=0 && y<height && (states[y*width+x]&0xFFu)==1 ) ? 1u : 0u;
+}
+
+__kernel void state_init_kernel(
+	int                   width,
+	int                   height,
+	__global ushort*      states,
+	__read_only image2d_t textures,
+	float                 limit)
+{
+	int x = get_global_id(0);
+	int y = get_global_id(1);
+	if( x>=width || y>=height ) return;
+
+	// Dead cells were never alive
+	states[y*width+x] = pixelPower(textureColor(textures, x, y, width, height), limit) ? 1 : gStateMaxAge<<8;
+}
+
+__kernel void state_scatter_kernel(
+	int                  width,
+	int                  wordsPerRow,
+	__global ushort*     states,
+	__global const uint* words,
+	int                  count)
+{
+	// Alive words of a pattern as pairs of index and bits, on dead cells that were never alive
+	int i = get_global_id(0);
+	if( i>=count ) return;
+
+	uint index = words[2*i];
+	uint bits  = words[2*i+1];
+	int  y     = index/wordsPerRow;
+	int  x     = (index%wordsPerRow)*32;
+	for( int bit=0; bit<32 && x+bit<width; ++bit )
+	{
+		if( (bits>>bit)&1u ) states[y*width+x+bit] = 1;
+	}
+}
+
+__kernel void state_kernel(
+	int              width,
+	int              height,
+	__global ushort* states,
+	int              offset,
+	uint             birth,
+	uint             survival)
+{
+	int x = get_global_id(0);
+	int y = get_global_id(1);
+	if( x>=width || y>=height ) return;
+
+	int generationSize = width*height;
+	__global ushort* source      = states + (( offset == 0 ) ? 0 : generationSize);
+	__global ushort* destination = states + (( offset == 0 ) ? generationSize : 0);
+
+	uint neighborhood = 0;
+	for( int i=0; i<9; ++i )
+	{
+		neighborhood |= stateAlive(source, x+i%3-1, y+i/3-1, width, height)<<i;
+	}
+	uint next = ruleNext(neighborhood, packedPopulation(neighborhood&0x1EFu), birth, survival);
+
+	// Dead cells are born, alive ones survive or start dying, and dying ones age
+	uint cell  = source[y*width+x];
+	uint state = cell&0xFFu;
+	uint age   = cell>>8;
+	state = ( state==0 ) ? next : (( state==1 && next ) ? 1 : (state+1)%gRuleStates);
+	age = ( state==1 ) ? 0 : min(age+1, gStateMaxAge);
+	destination[y*width+x] = state | (age<<8);
+}
+
+__kernel void state_colorize_kernel(
+	int                   width,
+	int                   height,
+	__global uchar4*      bitmap,
+	__global ushort*      states,
+	__read_only image2d_t textures,
+	int                   offset)
+{
+	int x = get_global_id(0);
+	int y = get_global_id(1);
+	if( x>=width || y>=height ) return;
+
+	// Dying cells fade out as their state ages, and dead ones as they get older
+	uint cell  = states[(( offset == 0 ) ? 0 : width*height) + y*width+x];
+	uint state = cell&0xFFu;
+	uint age   = cell>>8;
+	float4 color = textureColor(textures, x, y, width, height);
+	color.w = ( state==0 ) ?
+		(float)(gStateMaxAge-age)/(float)(2*gStateMaxAge) :
+		(float)(gRuleStates-(int)state)/(float)(gRuleStates-1);
+	makeOpenGLColor( color, bitmap, y*width+x );
+}
+
+/**
+* ________________________________________________________________________________
+* Larger than Life
+*
+* Rules counting the alive cells of the (2*RULE_RANGE+1)^2 square around a cell,
+* the cell itself included when RULE_MIDDLE is 1, on the float4 cells. The count
+* costs the same for any range: sat_rows_kernel and sat_columns_kernel build the
+* summed-area table of the alive mask of the current generation, (width+1) x
+* (height+1) sums whose first row and column are zeros, and larger_kernel gets
+* the count of each square from 4 of them. Cells outside of the board are dead.
+* ________________________________________________________________________________
+*/
+#ifndef RULE_RANGE
+#define RULE_RANGE        1
+#define RULE_MIDDLE       0
+#define RULE_BIRTH_MIN    3
+#define RULE_BIRTH_MAX    3
+#define RULE_SURVIVAL_MIN 2
+#define RULE_SURVIVAL_MAX 3
+#endif
+#ifndef SAT_GROUP_SIZE
+#define SAT_GROUP_SIZE 128
+#endif
+
+__kernel void sat_rows_kernel(
+	int              width,
+	int              height,
+	__global uchar*  mask,
+	__global uint*   sums)
+{
+	// One work-group per row, scanning it by blocks of SAT_GROUP_SIZE cells
+	__local uint scan[SAT_GROUP_SIZE];
+	int i = get_local_id(0);
+	int y = get_group_id(1);
+	int pitch = width+1;
+
+	if( i==0 ) sums[(y+1)*pitch] = 0;
+	for( int x=i; y==0 && x<pitch; x+=SAT_GROUP_SIZE ) sums[x] = 0;
+
+	uint carry = 0;
+	for( int block=0; block<width; block+=SAT_GROUP_SIZE )
+	{
+		int x = block+i;
+		scan[i] = ( x<width ) ? mask[y*width+x] : 0;
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		// Inclusive scan of the block, each step adding the value twice as far
+		for( int distance=1; distance<SAT_GROUP_SIZE; distance*=2 )
+		{
+			uint value = ( i>=distance ) ? scan[i-distance] : 0;
+			barrier(CLK_LOCAL_MEM_FENCE);
+			scan[i] += value;
+			barrier(CLK_LOCAL_MEM_FENCE);
+		}
+
+		if( x<width ) sums[(y+1)*pitch+x+1] = carry+scan[i];
+		carry += scan[SAT_GROUP_SIZE-1];
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+}
+
+__kernel void sat_columns_kernel(
+	int              width,
+	int              height,
+	__global uint*   sums)
+{
+	// One work-item per column, neighboring work-items reading neighboring sums
+	int x = get_global_id(0);
+	if( x>=width ) return;
+
+	int pitch = width+1;
+	uint sum = 0;
+	for( int y=1; y<=height; ++y )
+	{
+		sum += sums[y*pitch+x+1];
+		sums[y*pitch+x+1] = sum;
+	}
+}
+
+__kernel void larger_kernel(
 	int              width,
 	int              height,
-	__global char*   bitmap,
 	__global float4* buffer,
-	__global char*   video,
-	__global char*   depth,
-	__global char*   textures,
+	__global uint*   sums,
+	__global uchar*  mask,
+	int              offset)
+{
+	int x = get_global_id(0);
+	int y = get_global_id(1);
+	if( x>=width || y>=height ) return;
+
+	__global float4* destination = buffer + (( offset == 0 ) ? width*height : 0);
+
+	// Square clipped to the board
+	int pitch  = width+1;
+	int left   = max(x-RULE_RANGE, 0);
+	int right  = min(x+RULE_RANGE, width-1)+1;
+	int top    = max(y-RULE_RANGE, 0);
+	int bottom = min(y+RULE_RANGE, height-1)+1;
+	uint count = sums[bottom*pitch+right] - sums[top*pitch+right] - sums[bottom*pitch+left] + sums[top*pitch+left];
+
+	uint alive = mask[y*width+x];
+	count -= ( RULE_MIDDLE ) ? 0 : alive;
+	int next = alive ?
+		( count>=RULE_SURVIVAL_MIN && count<=RULE_SURVIVAL_MAX ) :
+		( count>=RULE_BIRTH_MIN && count<=RULE_BIRTH_MAX );
+
+	// Alive cells are black and dead ones white, as loaded by loadState()
+	float4 black = 0;
+	float4 white = 1.f;
+	destination[y*width+x] = next ? black : white;
+}
+
+/**
+* ________________________________________________________________________________
+* Batches of boards
+*
+* Independent boards of packed cells stacked in one buffer, two generations per
+* board, advanced together by a single 3D NDRange: the third dimension is the
+* board. Each board has its own rule, seed and limit (birth, survival, seed and
+* limit bits as a uint4), and its statistics (population, generations, words
+* changed by the last generation, settled flag as a uint4). A board settles when
+* a generation leaves it unchanged: its two generations are then the same and it
+* is not advanced any more.
+* ________________________________________________________________________________
+*/
+uint batchHash( uint seed, int x, int y )
+{
+	uint hash = seed*0x9E3779B9u ^ ((uint)x)*0x85EBCA6Bu ^ ((uint)y)*0xC2B2AE35u;
+	hash ^= hash>>16;
+	hash *= 0x7FEB352Du;
+	hash ^= hash>>15;
+	hash *= 0x846CA68Bu;
+	hash ^= hash>>16;
+	return hash;
+}
+
+void batchCount(
+	__global uint* counters,
+	__local uint*  sums,
+	int            board,
+	uint           population,
+	uint           changed,
+	int            valid)
+{
+	// Per work-group sums first, the work-group lying in a single board
+	int first = ( get_local_id(0)==0 && get_local_id(1)==0 );
+	if( first )
+	{
+		sums[0] = 0;
+		sums[1] = 0;
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+	if( valid && population!=0 ) atomic_add(&sums[0], population);
+	if( valid && changed!=0 ) atomic_inc(&sums[1]);
+	barrier(CLK_LOCAL_MEM_FENCE);
+	if( first && sums[0]!=0 ) atomic_add(&counters[board*2], sums[0]);
+	if( first && sums[1]!=0 ) atomic_add(&counters[board*2+1], sums[1]);
+}
+
+__kernel void batch_init_kernel(
+	int              width,
+	int              height,
+	int              wordsPerRow,
+	__global uint*   cells,
+	__global uint4*  parameters,
+	__global uint*   counters)
+{
+	// Cells are alive when the hash of the seed and of their coordinates, in [0,1), is under the limit
+	__local uint sums[2];
+	int x = get_global_id(0);
+	int y = get_global_id(1);
+	int board = get_global_id(2);
+	int valid = ( x<wordsPerRow && y<height );
+
+	uint4 parameter = parameters[board];
+	float limit = as_float(parameter.w);
+	uint word = 0;
+	for( int bit=0; valid && bit<gPackedWordBits; ++bit )
+	{
+		int column = x*gPackedWordBits+bit;
+		if( column<width && batchHash(parameter.z, column, y)*(1.f/4294967296.f)<limit )
+		{
+			word |= 1u<<bit;
+		}
+	}
+	if( valid )
+	{
+		cells[board*2*wordsPerRow*height + y*wordsPerRow+x] = word;
+	}
+	batchCount(counters, sums, board, packedPopulation(word), word, valid);
+}
+
+__kernel void batch_kernel(
+	int              width,
+	int              height,
+	int              wordsPerRow,
+	__global uint*   cells,
 	int              offset,
-	float            limit,
-	float            timer)
+	__global uint4*  parameters,
+	__global uint4*  statistics,
+	__global uint*   counters)
 {
-	gameOfLife( get_global_id(0), get_global_id(1), width, height, bitmap, buffer, video, depth, textures, offset, limit, timer );
-	//average( get_global_id(0), get_global_id(1), width, height, bitmap, buffer, video, depth, textures, offset, limit, timer );
+	__local uint sums[2];
+	int x = get_global_id(0);
+	int y = get_global_id(1);
+	int board = get_global_id(2);
+	if( statistics[board].w!=0 ) return;
+	int valid = ( x<wordsPerRow && y<height );
+
+	int generationSize = wordsPerRow*height;
+	__global uint* source      = cells + (board*2 + (( offset == 0 ) ? 0 : 1))*generationSize;
+	__global uint* destination = cells + (board*2 + (( offset == 0 ) ? 1 : 0))*generationSize;
+
+	uint word = 0;
+	uint next = 0;
+	if( valid )
+	{
+		uint4 parameter = parameters[board];
+		word = source[y*wordsPerRow+x];
+		next = packedNextWord(
+			packedWord(source, x-1, y-1, wordsPerRow, height),
+			packedWord(source, x,   y-1, wordsPerRow, height),
+			packedWord(source, x+1, y-1, wordsPerRow, height),
+			packedWord(source, x-1, y,   wordsPerRow, height),
+			word,
+			packedWord(source, x+1, y,   wordsPerRow, height),
+			packedWord(source, x-1, y+1, wordsPerRow, height),
+			packedWord(source, x,   y+1, wordsPerRow, height),
+			packedWord(source, x+1, y+1, wordsPerRow, height),
+			parameter.x, parameter.y ) & packedValidBits(x, width, wordsPerRow);
+		destination[y*wordsPerRow+x] = next;
+	}
+	batchCount(counters, sums, board, packedPopulation(next), next^word, valid);
+}
+
+__kernel void batch_statistics_kernel(
+	int              boards,
+	__global uint4*  statistics,
+	__global uint*   counters,
+	int              generations)
+{
+	// Sums of the last launch, 'generations' being 0 after seeding and 1 after a generation
+	int board = get_global_id(0);
+	if( board>=boards ) return;
+
+	uint population = counters[board*2];
+	uint changed    = counters[board*2+1];
+	counters[board*2]   = 0;
+	counters[board*2+1] = 0;
+
+	uint4 statistic = statistics[board];
+	if( statistic.w!=0 ) return;
+	statistic.x = population;
+	statistic.y += generations;
+	statistic.z = changed;
+	statistic.w = ( generations!=0 && changed==0 ) ? 1 : 0;
+	statistics[board] = statistic;
 }
@@ -0,0 +1,139 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <iostream>
+
+#include "MappedFile.h"
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+ * MappedFile constructor
+ */
+MappedFile::MappedFile()
+    : m_data(NULL)
+    , m_size(0)
+    , m_existing(false)
+{
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const std::string &fileName)
+{
+    return map(fileName, 0, false);
+}
+
+bool MappedFile::create(const std::string &fileName, const size_t size)
+{
+    return map(fileName, size, true);
+}
+
+void MappedFile::close()
+{
+    if (m_data != NULL)
+    {
+#ifdef WIN32
+        UnmapViewOfFile(m_data);
+#else
+        munmap(m_data, m_size);
+#endif
+    }
+    m_data = NULL;
+    m_size = 0;
+    m_existing = false;
+}
+
+/*
+ * map: size is the size of the file when writable, the whole file being mapped otherwise
+ */
+bool MappedFile::map(const std::string &fileName, const size_t size, const bool writable)
+{
+    close();
+    size_t bytes(size);
+    void *memory(NULL);
+#ifdef WIN32
+    HANDLE file = CreateFileA(fileName.c_str(), writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+                              FILE_SHARE_READ, NULL, writable ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                              NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        std::cerr << "Cannot open " << fileName << std::endl;
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(file, &fileSize);
+    m_existing = writable && (static_cast<size_t>(fileSize.QuadPart) == bytes);
+    if (!writable)
+        bytes = static_cast<size_t>(fileSize.QuadPart);
+    if (bytes != 0 && (!writable || m_existing || fileSize.QuadPart == 0))
+    {
+        // The mapping extends an empty file, and stays alive with its view
+        HANDLE mapping = CreateFileMappingA(file, NULL, writable ? PAGE_READWRITE : PAGE_READONLY,
+                                           static_cast<DWORD>(static_cast<unsigned long long>(bytes) >> 32),
+                                           static_cast<DWORD>(bytes & 0xFFFFFFFF), NULL);
+        if (mapping != NULL)
+        {
+            memory = MapViewOfFile(mapping, writable ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, 0, 0, bytes);
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+#else
+    int file = ::open(fileName.c_str(), writable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+    if (file < 0)
+    {
+        std::cerr << "Cannot open " << fileName << std::endl;
+        return false;
+    }
+    struct stat status;
+    if (fstat(file, &status) != 0)
+        status.st_size = -1;
+    m_existing = writable && (static_cast<size_t>(status.st_size) == bytes);
+    if (!writable && status.st_size > 0)
+        bytes = static_cast<size_t>(status.st_size);
+    if (bytes != 0 && (!writable || m_existing || (status.st_size == 0 && ftruncate(file, bytes) == 0)))
+    {
+        memory = mmap(NULL, bytes, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, file, 0);
+        if (memory == MAP_FAILED)
+            memory = NULL;
+    }
+    ::close(file);
+#endif
+
+    if (memory == NULL)
+    {
+        std::cerr << "Cannot map " << fileName << " (" << bytes << " bytes)" << std::endl;
+        m_existing = false;
+        return false;
+    }
+    m_data = static_cast<BYTE *>(memory);
+    m_size = bytes;
+    return true;
+}
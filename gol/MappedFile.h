@@ -0,0 +1,57 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include "SimulationEngine.h"
+#include <string>
+
+/*
+ * Whole file mapped into memory, read-only, or shared for reading and writing so that stores reach the file
+ */
+class GOL_API MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+public:
+    // Maps an existing file for reading
+    bool open(const std::string &fileName);
+    // Maps a file of size bytes for reading and writing. An existing file of that size keeps its content, a missing
+    // or empty one is created with zeros, and a file of another size is left untouched and not mapped
+    bool create(const std::string &fileName, const size_t size);
+    void close();
+
+    BYTE *getData() { return m_data; };
+    const BYTE *getData() const { return m_data; };
+    size_t getSize() const { return m_size; };
+    // Whether create() mapped the content of an existing file
+    bool isExisting() const { return m_existing; };
+
+private:
+    bool map(const std::string &fileName, const size_t size, const bool writable);
+
+private:
+    BYTE *m_data;
+    size_t m_size;
+    bool m_existing;
+};
@@ -0,0 +1,383 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <iostream>
+
+#include "MultiDeviceEngine.h"
+#include "OpenCLStatus.h"
+
+// Platforms and devices queried
+const cl_uint gMaxDevices = 16;
+
+/*
+ * MultiDeviceEngine constructor
+ */
+MultiDeviceEngine::MultiDeviceEngine(int platformId, const bool subDevices)
+    : m_stripCount(0)
+    , m_width(0)
+    , m_height(0)
+    , m_wordsPerRow(0)
+    , m_offset(0)
+    , m_seeded(false)
+    , m_limit(0.5f)
+    , m_birth(gConwayBirth)
+    , m_survival(gConwaySurvival)
+    , m_textures(gTextureWidth * gTextureHeight * gTextureDepth, 0)
+{
+    cl_platform_id platforms[gMaxDevices];
+    cl_uint platformCount(0);
+    CHECKSTATUS(clGetPlatformIDs(gMaxDevices, platforms, &platformCount));
+    if (platformId < 0 || platformId >= static_cast<int>(platformCount))
+    {
+        std::cerr << "Invalid platform " << platformId << std::endl;
+        return;
+    }
+
+    cl_device_id devices[gMaxDevices];
+    cl_uint deviceCount(0);
+    CHECKSTATUS(clGetDeviceIDs(platforms[platformId], CL_DEVICE_TYPE_ALL, gMaxDevices, devices, &deviceCount));
+
+    // CPU devices are split by NUMA node, or whatever the runtime partitions first, when they can be
+    std::vector<cl_device_id> stripDevices;
+    for (cl_uint d(0); d < deviceCount; ++d)
+    {
+        cl_device_type type(0);
+        cl_uint count(0);
+        cl_device_partition_property properties[] = {CL_DEVICE_PARTITION_BY_AFFINITY_DOMAIN,
+                                                     CL_DEVICE_AFFINITY_DOMAIN_NEXT_PARTITIONABLE, 0};
+        CHECKSTATUS(clGetDeviceInfo(devices[d], CL_DEVICE_TYPE, sizeof(type), &type, NULL));
+        if (subDevices && (type & CL_DEVICE_TYPE_CPU) &&
+            clCreateSubDevices(devices[d], properties, 0, NULL, &count) == CL_SUCCESS && count > 1)
+        {
+            size_t first = m_subDevices.size();
+            m_subDevices.resize(first + count);
+            CHECKSTATUS(clCreateSubDevices(devices[d], properties, count, &m_subDevices[first], NULL));
+            stripDevices.insert(stripDevices.end(), m_subDevices.begin() + first, m_subDevices.end());
+        }
+        else
+            stripDevices.push_back(devices[d]);
+    }
+
+    for (size_t i(0); i < stripDevices.size(); ++i)
+    {
+        DeviceStrip strip = DeviceStrip();
+        strip.engine = new OpenCLKernel(stripDevices[i]);
+        m_strips.push_back(strip);
+    }
+}
+
+MultiDeviceEngine::~MultiDeviceEngine()
+{
+    release();
+    for (size_t i(0); i < m_strips.size(); ++i)
+    {
+        if (m_strips[i].hKernel)
+            CHECKSTATUS(clReleaseKernel(m_strips[i].hKernel));
+        delete m_strips[i].engine;
+    }
+    for (size_t i(0); i < m_subDevices.size(); ++i)
+        CHECKSTATUS(clReleaseDevice(m_subDevices[i]));
+}
+
+void MultiDeviceEngine::release()
+{
+    finish();
+    for (int i(0); i < m_stripCount; ++i)
+    {
+        if (m_strips[i].hCells)
+            CHECKSTATUS(clReleaseMemObject(m_strips[i].hCells));
+        m_strips[i].hCells = 0;
+    }
+    m_stripCount = 0;
+    m_seeded = false;
+}
+
+/*
+ * compileKernels
+ */
+void MultiDeviceEngine::compileKernels(const KernelSourceType sourceType, const std::string &source)
+{
+    for (size_t i(0); i < m_strips.size(); ++i)
+    {
+        DeviceStrip &strip = m_strips[i];
+        int status(0);
+        strip.engine->compileKernels(sourceType, source, "", "");
+        if (strip.hKernel)
+            CHECKSTATUS(clReleaseKernel(strip.hKernel));
+        strip.hKernel = clCreateKernel(strip.engine->getCLProgram(), "packed_kernel", &status);
+        CHECKSTATUS(status);
+    }
+}
+
+// ---------- Board ----------
+void MultiDeviceEngine::initializeDevice(int width, int height, const CellStorage)
+{
+    release();
+    m_width = width;
+    m_height = height;
+    m_wordsPerRow = packedWords(width);
+    m_offset = 0;
+    m_stripCount = (static_cast<int>(m_strips.size()) < height) ? static_cast<int>(m_strips.size()) : height;
+
+    for (int i(0); i < m_stripCount; ++i)
+    {
+        DeviceStrip &strip = m_strips[i];
+        int status(0);
+        strip.begin = static_cast<int>(static_cast<long long>(height) * i / m_stripCount);
+        strip.end = static_cast<int>(static_cast<long long>(height) * (i + 1) / m_stripCount);
+        strip.top = (i > 0) ? 1 : 0;
+        strip.rows = strip.top + strip.end - strip.begin + ((i < m_stripCount - 1) ? 1 : 0);
+        strip.hCells = clCreateBuffer(strip.engine->getCLContext(), CL_MEM_READ_WRITE,
+                                      2 * strip.rows * m_wordsPerRow * sizeof(cl_uint), 0, &status);
+        CHECKSTATUS(status);
+        strip.edges[0].assign(2 * m_wordsPerRow, 0);
+        strip.edges[1].assign(2 * m_wordsPerRow, 0);
+
+        CHECKSTATUS(clSetKernelArg(strip.hKernel, 0, sizeof(cl_int), (void *)&m_width));
+        CHECKSTATUS(clSetKernelArg(strip.hKernel, 1, sizeof(cl_int), (void *)&strip.rows));
+        CHECKSTATUS(clSetKernelArg(strip.hKernel, 2, sizeof(cl_int), (void *)&m_wordsPerRow));
+        CHECKSTATUS(clSetKernelArg(strip.hKernel, 3, sizeof(cl_mem), (void *)&strip.hCells));
+    }
+    setRule(m_birth, m_survival);
+}
+
+/*
+ * seed
+ */
+void MultiDeviceEngine::seed()
+{
+    std::vector<cl_uint> cells(m_wordsPerRow * m_height, 0);
+    for (int y(0); y < m_height; ++y)
+        seedPackedRow(&m_textures[0], m_width, m_height, 0, y, m_width, m_limit, &cells[y * m_wordsPerRow]);
+    loadState(cells);
+}
+
+/*
+ * step
+ */
+void MultiDeviceEngine::step(const unsigned int generations)
+{
+    if (!m_seeded)
+        seed();
+    for (unsigned int i(0); i < generations; ++i)
+    {
+        enqueueGeneration();
+        exchangeHalos();
+        m_offset = (m_offset == 0) ? 1 : 0;
+    }
+    finish();
+}
+
+/*
+ * enqueueGeneration
+ */
+void MultiDeviceEngine::enqueueGeneration()
+{
+    int next = (m_offset == 0) ? 1 : 0;
+    for (int i(0); i < m_stripCount; ++i)
+    {
+        DeviceStrip &strip = m_strips[i];
+        cl_command_queue queue = strip.engine->getCLQueue();
+        cl_command_queue transferQueue = strip.engine->getCLTransferQueue();
+        bool above = (i > 0);
+        bool below = (i < m_stripCount - 1);
+        int first = strip.top;
+        int last = strip.top + strip.end - strip.begin - 1;
+        size_t nextRows = static_cast<size_t>(next) * strip.rows;
+        CHECKSTATUS(clSetKernelArg(strip.hKernel, 4, sizeof(cl_int), (void *)&m_offset));
+
+        // Rows bordering the neighbors, once the halos of the current generation are written
+        int edgeRows[] = {first, last};
+        bool edges[] = {above, below && (last != first || !above)};
+        std::vector<cl_event> edgeEvents;
+        for (int e(0); e < 2; ++e)
+        {
+            if (!edges[e])
+                continue;
+            size_t offset[] = {0, static_cast<size_t>(edgeRows[e])};
+            size_t workSize[] = {static_cast<size_t>(m_wordsPerRow), 1};
+            cl_event event(0);
+            CHECKSTATUS(clEnqueueNDRangeKernel(queue, strip.hKernel, 2, offset, workSize, 0,
+                                               static_cast<cl_uint>(strip.haloEvents.size()),
+                                               strip.haloEvents.empty() ? NULL : &strip.haloEvents[0], &event));
+            edgeEvents.push_back(event);
+        }
+        for (size_t e(0); e < strip.haloEvents.size(); ++e)
+            m_profiler.trackOrRelease(ps_exchange, strip.haloEvents[e]);
+        strip.haloEvents.clear();
+
+        // Read back on the transfer queue while the rest of the strip is advanced
+        if (!edgeEvents.empty())
+        {
+            for (int e(0); e < 2; ++e)
+            {
+                if (!(e == 0 ? above : below))
+                    continue;
+                cl_event event(0);
+                CHECKSTATUS(clEnqueueReadBuffer(
+                    transferQueue, strip.hCells, CL_FALSE, (nextRows + edgeRows[e]) * m_wordsPerRow * sizeof(cl_uint),
+                    m_wordsPerRow * sizeof(cl_uint), &strip.edges[next][e * m_wordsPerRow],
+                    static_cast<cl_uint>(edgeEvents.size()), &edgeEvents[0], &event));
+                strip.readEvents.push_back(event);
+            }
+            CHECKSTATUS(clFlush(transferQueue));
+        }
+
+        int interiorBegin = above ? first + 1 : first;
+        int interiorEnd = below ? last : last + 1;
+        if (interiorEnd > interiorBegin)
+        {
+            size_t offset[] = {0, static_cast<size_t>(interiorBegin)};
+            size_t workSize[] = {static_cast<size_t>(m_wordsPerRow), static_cast<size_t>(interiorEnd - interiorBegin)};
+            cl_event event(0);
+            CHECKSTATUS(clEnqueueNDRangeKernel(queue, strip.hKernel, 2, offset, workSize, 0, 0, 0,
+                                               m_profiler.event(event)));
+            m_profiler.track(ps_simulation, event);
+        }
+        CHECKSTATUS(clFlush(queue));
+
+        for (size_t e(0); e < edgeEvents.size(); ++e)
+            m_profiler.trackOrRelease(ps_simulation, edgeEvents[e]);
+    }
+}
+
+/*
+ * exchangeHalos
+ */
+void MultiDeviceEngine::exchangeHalos()
+{
+    // The first row of a strip goes to the bottom halo of the strip above, its last row to the top halo of the
+    // strip below, in the generation just enqueued
+    int next = (m_offset == 0) ? 1 : 0;
+    for (int i(0); i < m_stripCount; ++i)
+    {
+        DeviceStrip &strip = m_strips[i];
+        if (strip.readEvents.empty())
+            continue;
+        CHECKSTATUS(clWaitForEvents(static_cast<cl_uint>(strip.readEvents.size()), &strip.readEvents[0]));
+        for (size_t e(0); e < strip.readEvents.size(); ++e)
+            m_profiler.trackOrRelease(ps_exchange, strip.readEvents[e]);
+        strip.readEvents.clear();
+
+        for (int e(0); e < 2; ++e)
+        {
+            int neighbor = (e == 0) ? i - 1 : i + 1;
+            if (neighbor < 0 || neighbor >= m_stripCount)
+                continue;
+            DeviceStrip &target = m_strips[neighbor];
+            size_t row = static_cast<size_t>(next) * target.rows + ((e == 0) ? target.rows - 1 : 0);
+            cl_event event(0);
+            CHECKSTATUS(clEnqueueWriteBuffer(target.engine->getCLTransferQueue(), target.hCells, CL_FALSE,
+                                             row * m_wordsPerRow * sizeof(cl_uint), m_wordsPerRow * sizeof(cl_uint),
+                                             &strip.edges[next][e * m_wordsPerRow], 0, NULL, &event));
+            target.haloEvents.push_back(event);
+            CHECKSTATUS(clFlush(target.engine->getCLTransferQueue()));
+        }
+    }
+}
+
+/*
+ * finish
+ */
+void MultiDeviceEngine::finish()
+{
+    for (int i(0); i < m_stripCount; ++i)
+    {
+        DeviceStrip &strip = m_strips[i];
+        CHECKSTATUS(clFinish(strip.engine->getCLQueue()));
+        CHECKSTATUS(clFinish(strip.engine->getCLTransferQueue()));
+        for (size_t e(0); e < strip.haloEvents.size(); ++e)
+            m_profiler.trackOrRelease(ps_exchange, strip.haloEvents[e]);
+        strip.haloEvents.clear();
+    }
+    m_profiler.collect(false);
+}
+
+/*
+ * readback
+ */
+void MultiDeviceEngine::readback(BYTE *bitmap)
+{
+    std::vector<cl_uint> cells;
+    saveState(cells);
+
+    for (int y(0); y < m_height; ++y)
+        colorizePackedRow(&m_textures[0], m_width, m_height, y, &cells[y * m_wordsPerRow],
+                          bitmap + y * m_width * gColorDepth);
+}
+
+// ---------- State ----------
+void MultiDeviceEngine::loadState(const std::vector<cl_uint> &cells)
+{
+    if (cells.size() != static_cast<size_t>(m_wordsPerRow * m_height))
+    {
+        std::cerr << "Invalid state size" << std::endl;
+        return;
+    }
+
+    // Each strip gets its rows and halos, as the current generation
+    m_offset = 0;
+    for (int i(0); i < m_stripCount; ++i)
+    {
+        DeviceStrip &strip = m_strips[i];
+        CHECKSTATUS(clEnqueueWriteBuffer(strip.engine->getCLQueue(), strip.hCells, CL_TRUE, 0,
+                                         strip.rows * m_wordsPerRow * sizeof(cl_uint),
+                                         &cells[(strip.begin - strip.top) * m_wordsPerRow], 0, NULL, NULL));
+    }
+    m_seeded = true;
+}
+
+void MultiDeviceEngine::saveState(std::vector<cl_uint> &cells)
+{
+    if (!m_seeded)
+        seed();
+    cells.assign(m_wordsPerRow * m_height, 0);
+    for (int i(0); i < m_stripCount; ++i)
+    {
+        DeviceStrip &strip = m_strips[i];
+        size_t first = static_cast<size_t>(m_offset) * strip.rows + strip.top;
+        CHECKSTATUS(clEnqueueReadBuffer(strip.engine->getCLQueue(), strip.hCells, CL_TRUE,
+                                        first * m_wordsPerRow * sizeof(cl_uint),
+                                        (strip.end - strip.begin) * m_wordsPerRow * sizeof(cl_uint),
+                                        &cells[strip.begin * m_wordsPerRow], 0, NULL, NULL));
+    }
+}
+
+// ---------- Seeding and rules ----------
+void MultiDeviceEngine::setTexture(int index, BYTE *texture)
+{
+    // Single texture
+    if (index != 0)
+        return;
+    storeTexture(texture, &m_textures[0]);
+}
+
+bool MultiDeviceEngine::setRule(const cl_uint birth, const cl_uint survival)
+{
+    m_birth = birth;
+    m_survival = survival;
+    for (int i(0); i < m_stripCount; ++i)
+    {
+        CHECKSTATUS(clSetKernelArg(m_strips[i].hKernel, 5, sizeof(cl_uint), (void *)&m_birth));
+        CHECKSTATUS(clSetKernelArg(m_strips[i].hKernel, 6, sizeof(cl_uint), (void *)&m_survival));
+    }
+    return true;
+}
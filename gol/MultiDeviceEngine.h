@@ -0,0 +1,110 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include "OpenCLKernel.h"
+
+/*
+ * Strip of the board advanced by one device: the rows [begin, end) of the board, between the halo rows copied
+ * from the neighboring strips after every generation. Cells beyond the first and last strips are dead.
+ */
+struct DeviceStrip
+{
+    OpenCLKernel *engine;
+    cl_kernel hKernel;
+    cl_mem hCells; // Two generations of the rows of the strip and its halos
+    int begin;
+    int end;
+    int top;  // Halo rows above the strip, 0 or 1
+    int rows; // Rows of a generation, halos included
+
+    // Host copies of the first and last rows of the strip, per generation parity, and the events of their reads
+    std::vector<cl_uint> edges[2];
+    std::vector<cl_event> readEvents;
+    // Writes into the halo rows, waited for by the next generation
+    std::vector<cl_event> haloEvents;
+};
+
+/*
+ * Packed cells of one board advanced by every device of a platform, each device owning a horizontal strip of
+ * rows in its own context and queues. A generation first advances the two rows of each strip bordering its
+ * neighbors, then reads them back on the transfer queue while the other rows of the strip are advanced; the
+ * host then writes them into the halos of the neighbors for the next generation. CPU devices are split into
+ * sub-devices by affinity domain, so that each NUMA node gets its own strip.
+ */
+class GOL_API MultiDeviceEngine : public SimulationEngine
+{
+public:
+    MultiDeviceEngine(int platformId, const bool subDevices = true);
+    virtual ~MultiDeviceEngine();
+
+public:
+    // Builds the kernels on every device, before initializeDevice()
+    void compileKernels(const KernelSourceType sourceType, const std::string &source);
+
+    // ---------- Board ----------
+    // Cells are always packed, the storage is ignored. Boards with fewer rows than devices use fewer strips
+    virtual void initializeDevice(int width, int height, const CellStorage storage = cs_packed);
+    virtual void step(const unsigned int generations);
+    virtual void readback(BYTE *bitmap);
+    virtual void reset() { m_seeded = false; };
+
+    // ---------- State ----------
+    virtual void loadState(const std::vector<cl_uint> &cells);
+    virtual void saveState(std::vector<cl_uint> &cells);
+
+    // ---------- Seeding and rules ----------
+    virtual void setTexture(int index, BYTE *texture);
+    virtual void setLimit(const float limit) { m_limit = limit; };
+    virtual bool setRule(const cl_uint birth, const cl_uint survival);
+
+    // ---------- Statistics ----------
+    virtual ProfilingStatistics getStatistics() { return m_profiler.getStatistics(); };
+
+    int getDeviceCount() { return static_cast<int>(m_strips.size()); };
+    int getStripCount() { return m_stripCount; };
+
+private:
+    void seed();
+    void release();
+    void enqueueGeneration();
+    void exchangeHalos();
+    void finish();
+
+private:
+    // Sub-devices created for the engines, released after them
+    std::vector<cl_device_id> m_subDevices;
+    std::vector<DeviceStrip> m_strips;
+    int m_stripCount;
+    OpenCLProfiler m_profiler;
+
+    cl_int m_width;
+    cl_int m_height;
+    cl_int m_wordsPerRow;
+    cl_int m_offset;
+    bool m_seeded;
+    float m_limit;
+    cl_uint m_birth;
+    cl_uint m_survival;
+
+    std::vector<BYTE> m_textures;
+};
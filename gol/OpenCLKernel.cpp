@@ -23,6 +23,7 @@
 #include <iostream>
 #include <math.h>
 #include <sstream>
+#include <string.h>
 #include <time.h>
 #ifdef USE_DIRECTX
 #include <CL/cl_d3d10_ext.h>
@@ -34,9 +35,10 @@
 #else
 #define LOG_INFO(msg) std::cout << msg << std::endl;
 #define LOG_ERROR(msg) std::cerr << msg << std::endl;
-#endif NDEBUG
+#endif // ETW_LOGGING
 
 #include "OpenCLKernel.h"
+#include "OpenCLStatus.h"
 
 const long MAX_SOURCE_SIZE = 65535;
 const long MAX_DEVICES = 10;
@@ -47,107 +49,6 @@ clGetDeviceIDsFromD3D10NV_fn clGetDeviceIDsFromD3D10NV = NULL;
 ID3D10Device *g_pd3dDevice = NULL; // Our rendering device
 #endif                             // USE_DIRECTX
 
-/*
- * getErrorDesc
- */
-std::string getErrorDesc(int err)
-{
-    switch (err)
-    {
-    case CL_SUCCESS:
-        return "CL_SUCCESS";
-    case CL_DEVICE_NOT_FOUND:
-        return "CL_DEVICE_NOT_FOUND";
-    case CL_COMPILER_NOT_AVAILABLE:
-        return "CL_COMPILER_NOT_AVAILABLE";
-    case CL_MEM_OBJECT_ALLOCATION_FAILURE:
-        return "CL_MEM_OBJECT_ALLOCATION_FAILURE";
-    case CL_OUT_OF_RESOURCES:
-        return "CL_OUT_OF_RESOURCES";
-    case CL_OUT_OF_HOST_MEMORY:
-        return "CL_OUT_OF_HOST_MEMORY";
-    case CL_PROFILING_INFO_NOT_AVAILABLE:
-        return "CL_PROFILING_INFO_NOT_AVAILABLE";
-    case CL_MEM_COPY_OVERLAP:
-        return "CL_MEM_COPY_OVERLAP";
-    case CL_IMAGE_FORMAT_MISMATCH:
-        return "CL_IMAGE_FORMAT_MISMATCH";
-    case CL_IMAGE_FORMAT_NOT_SUPPORTED:
-        return "CL_IMAGE_FORMAT_NOT_SUPPORTED";
-    case CL_BUILD_PROGRAM_FAILURE:
-        return "CL_BUILD_PROGRAM_FAILURE";
-    case CL_MAP_FAILURE:
-        return "CL_MAP_FAILURE";
-
-    case CL_INVALID_VALUE:
-        return "CL_INVALID_VALUE";
-    case CL_INVALID_DEVICE_TYPE:
-        return "CL_INVALID_DEVICE_TYPE";
-    case CL_INVALID_PLATFORM:
-        return "CL_INVALID_PLATFORM";
-    case CL_INVALID_DEVICE:
-        return "CL_INVALID_DEVICE";
-    case CL_INVALID_CONTEXT:
-        return "CL_INVALID_CONTEXT";
-    case CL_INVALID_QUEUE_PROPERTIES:
-        return "CL_INVALID_QUEUE_PROPERTIES";
-    case CL_INVALID_COMMAND_QUEUE:
-        return "CL_INVALID_COMMAND_QUEUE";
-    case CL_INVALID_HOST_PTR:
-        return "CL_INVALID_HOST_PTR";
-    case CL_INVALID_MEM_OBJECT:
-        return "CL_INVALID_MEM_OBJECT";
-    case CL_INVALID_IMAGE_FORMAT_DESCRIPTOR:
-        return "CL_INVALID_IMAGE_FORMAT_DESCRIPTOR";
-    case CL_INVALID_IMAGE_SIZE:
-        return "CL_INVALID_IMAGE_SIZE";
-    case CL_INVALID_SAMPLER:
-        return "CL_INVALID_SAMPLER";
-    case CL_INVALID_BINARY:
-        return "CL_INVALID_BINARY";
-    case CL_INVALID_BUILD_OPTIONS:
-        return "CL_INVALID_BUILD_OPTIONS";
-    case CL_INVALID_PROGRAM:
-        return "CL_INVALID_PROGRAM";
-    case CL_INVALID_PROGRAM_EXECUTABLE:
-        return "CL_INVALID_PROGRAM_EXECUTABLE";
-    case CL_INVALID_KERNEL_NAME:
-        return "CL_INVALID_KERNEL_NAME";
-    case CL_INVALID_KERNEL_DEFINITION:
-        return "CL_INVALID_KERNEL_DEFINITION";
-    case CL_INVALID_KERNEL:
-        return "CL_INVALID_KERNEL";
-    case CL_INVALID_ARG_INDEX:
-        return "CL_INVALID_ARG_INDEX";
-    case CL_INVALID_ARG_VALUE:
-        return "CL_INVALID_ARG_VALUE";
-    case CL_INVALID_ARG_SIZE:
-        return "CL_INVALID_ARG_SIZE";
-    case CL_INVALID_KERNEL_ARGS:
-        return "CL_INVALID_KERNEL_ARGS";
-    case CL_INVALID_WORK_DIMENSION:
-        return "CL_INVALID_WORK_DIMENSION";
-    case CL_INVALID_WORK_GROUP_SIZE:
-        return "CL_INVALID_WORK_GROUP_SIZE";
-    case CL_INVALID_WORK_ITEM_SIZE:
-        return "CL_INVALID_WORK_ITEM_SIZE";
-    case CL_INVALID_GLOBAL_OFFSET:
-        return "CL_INVALID_GLOBAL_OFFSET";
-    case CL_INVALID_EVENT_WAIT_LIST:
-        return "CL_INVALID_EVENT_WAIT_LIST";
-    case CL_INVALID_OPERATION:
-        return "CL_INVALID_OPERATION";
-    case CL_INVALID_GL_OBJECT:
-        return "CL_INVALID_GL_OBJECT";
-    case CL_INVALID_BUFFER_SIZE:
-        return "CL_INVALID_BUFFER_SIZE";
-    case CL_INVALID_MIP_LEVEL:
-        return "CL_INVALID_MIP_LEVEL";
-    default:
-        return "UNKNOWN";
-    }
-}
-
 /*
  * Callback function for clBuildProgram notifications
  */
@@ -159,39 +60,95 @@ void pfn_notify(cl_program, void *user_data)
 }
 
 /*
- * CHECKSTATUS
- */
-
-#define CHECKSTATUS(stmt)                                        \
-    {                                                            \
-        int __status = stmt;                                     \
-        if (__status != CL_SUCCESS)                              \
-        {                                                        \
-            std::stringstream __s;                               \
-            __s << "==> " #stmt "\n";                            \
-            __s << "ERROR : " << getErrorDesc(__status) << "\n"; \
-            __s << "<== " #stmt "\n";                            \
-            LOG_ERROR(__s.str());                                \
-        }                                                        \
-    }
-
-/*
- * OpenCLKernel constructor
+ * OpenCLKernel constructors
  */
-OpenCLKernel::OpenCLKernel(int platformId, int deviceId, int nbWorkingItems, int draft)
-    : m_hContext(0)
+OpenCLKernel::OpenCLKernel()
+    : m_hPlatformId(0)
+    , m_hContext(0)
     , m_hQueue(0)
+    , m_hTransferQueue(0)
+    , m_hProgram(0)
+    , m_hMainKernel(0)
+    , m_hTiledKernel(0)
+    , m_hAverageKernel(0)
+    , m_hColorizeKernel(0)
+    , m_hAliveKernel(0)
+    , m_hPackedInitKernel(0)
+    , m_hPackedScatterKernel(0)
+    , m_hPackedKernel(0)
+    , m_hPackedTemporalKernel(0)
+    , m_hPackedColorizeKernel(0)
+    , m_hActiveTilesKernel(0)
+    , m_hPackedActiveKernel(0)
+    , m_hChunkKernel(0)
+    , m_hChunkWindowKernel(0)
+    , m_hStateInitKernel(0)
+    , m_hStateScatterKernel(0)
+    , m_hStateKernel(0)
+    , m_hStateColorizeKernel(0)
+    , m_hSatRowsKernel(0)
+    , m_hSatColumnsKernel(0)
+    , m_hLargerKernel(0)
     , m_hBitmap(0)
     , m_hBuffer(0)
+    , m_hAliveMask(0)
+    , m_hPackedBuffer(0)
+    , m_hScatterBuffer(0)
+    , m_hActiveFlags(0)
+    , m_hActiveTiles(0)
+    , m_hActiveCounts(0)
+    , m_hChunks(0)
+    , m_hChunkNeighbors(0)
+    , m_hChunkSummaries(0)
+    , m_hWindowSlots(0)
+    , m_hStateBuffer(0)
+    , m_hSumBuffer(0)
     , m_hVideo(0)
     , m_hDepth(0)
     , m_hTextures(0)
-    , m_textures(0)
-    , m_texturedTransfered(false)
     , m_offset(-1)
     , m_timer(0.f)
+    , m_storage(cs_float4)
+    , m_simulationKernel(sk_tiled)
+    , m_width(0)
+    , m_height(0)
+    , m_wordsPerRow(0)
+    , m_birth(gConwayBirth)
+    , m_survival(gConwaySurvival)
+    , m_ruleOptions(m_rule.getBuildOptions())
+    , m_limit(0.f)
+    , m_generationsPerLaunch(gTemporalMaxGenerations)
+    , m_activeTilesPerRow(0)
+    , m_activeTileRows(0)
+    , m_activeFlagsValid(false)
+    , m_chunkSlots(0)
+    , m_chunkCapacity(0)
+    , m_chunkTablesValid(false)
+    , m_frameFirst(0)
+    , m_framesInFlight(0)
+    , m_acquiredFrame(-1)
+    , m_hSnapshotBuffer(0)
+    , m_snapshotEvent(0)
+    , m_snapshotPending(false)
+    , m_textures(0)
+    , m_texturedTransfered(false)
 {
-    int status(0);
+    m_localWorkSize[0] = 0;
+    m_localWorkSize[1] = 0;
+    for (int i(0); i < gFramesInFlight; ++i)
+    {
+        m_hFrameBitmaps[i] = 0;
+        m_hPinnedFrames[i] = 0;
+        m_pinnedFrames[i] = 0;
+        m_colorizeEvents[i] = 0;
+        m_readEvents[i] = 0;
+    }
+}
+
+OpenCLKernel::OpenCLKernel(int platformId, int deviceId, int nbWorkingItems, int draft)
+    : OpenCLKernel()
+{
+    m_hPlatformId = platformId;
     cl_platform_id platforms[MAX_DEVICES];
     cl_uint ret_num_devices;
     cl_uint ret_num_platforms;
@@ -223,7 +180,7 @@ OpenCLKernel::OpenCLKernel(int platformId, int deviceId, int nbWorkingItems, int
         buffer[len] = 0;
         s << "  Extensions : " << buffer << "\n";
 
-        CHECKSTATUS(clGetDeviceIDs(platforms[p], CL_DEVICE_TYPE_ALL, 1, m_hDevices, &ret_num_devices));
+        CHECKSTATUS(clGetDeviceIDs(platforms[p], CL_DEVICE_TYPE_ALL, MAX_DEVICES, m_hDevices, &ret_num_devices));
 
         // Devices
         int d = deviceId;
@@ -289,8 +246,32 @@ OpenCLKernel::OpenCLKernel(int platformId, int deviceId, int nbWorkingItems, int
     std::cout << s.str() << std::endl;
     LOG_INFO(s.str());
 
-    m_hContext = clCreateContext(NULL, ret_num_devices, &m_hDevices[0], NULL, NULL, &status);
+    // The engine runs on the selected device only, kept first
+    if (deviceId > 0 && deviceId < static_cast<int>(ret_num_devices))
+        m_hDevices[0] = m_hDevices[deviceId];
+    createContext();
+}
+
+OpenCLKernel::OpenCLKernel(cl_device_id device)
+    : OpenCLKernel()
+{
+    m_hDevices[0] = device;
+    createContext();
+}
+
+/*
+ * createContext
+ */
+void OpenCLKernel::createContext()
+{
+    int status(0);
+    m_hContext = clCreateContext(NULL, 1, &m_hDevices[0], NULL, NULL, &status);
+    CHECKSTATUS(status);
     m_hQueue = clCreateCommandQueue(m_hContext, m_hDevices[0], CL_QUEUE_PROFILING_ENABLE, &status);
+    CHECKSTATUS(status);
+    // Frame read backs run on their own queue so that they overlap with the simulation
+    m_hTransferQueue = clCreateCommandQueue(m_hContext, m_hDevices[0], CL_QUEUE_PROFILING_ENABLE, &status);
+    CHECKSTATUS(status);
 }
 
 /*
@@ -298,52 +279,177 @@ OpenCLKernel::OpenCLKernel(int platformId, int deviceId, int nbWorkingItems, int
  */
 void OpenCLKernel::compileKernels(const KernelSourceType sourceType, const std::string &source,
                                   const std::string &ptxFileName, const std::string &options)
+{
+    const char *source_str(0);
+    size_t len(0);
+    switch (sourceType)
+    {
+    case kst_file:
+        if (source.length() != 0)
+        {
+            source_str = loadFromFile(source, len);
+        }
+        break;
+    case kst_string:
+    {
+        source_str = source.c_str();
+        len = source.length();
+    }
+    break;
+    }
+    m_kernelSource.assign(source_str ? source_str : "", len);
+    m_kernelOptions = options;
+    m_ptxFileName = ptxFileName;
+
+    if (sourceType == kst_file)
+    {
+        free((void *)source_str);
+        source_str = NULL;
+    }
+
+    // Programs of the previous source
+    for (std::map<std::string, cl_program>::iterator it(m_programs.begin()); it != m_programs.end(); ++it)
+        CHECKSTATUS(clReleaseProgram(it->second));
+    m_programs.clear();
+    m_hProgram = 0;
+
+    buildKernels();
+}
+
+/*
+ * buildKernels
+ */
+void OpenCLKernel::buildKernels()
 {
     try
     {
         int status(0);
         cl_program hProgram(0);
-        clUnloadCompiler();
-
-        const char *source_str;
         size_t len(0);
-        switch (sourceType)
+
+        // Tiles of the tiled, temporal and active kernels, chunks, row scan, and rule
+        m_builtRuleOptions.clear();
+        std::stringstream buildOptions;
+        buildOptions << m_kernelOptions << " -DTILE_WIDTH=" << gTileWidth << " -DTILE_HEIGHT=" << gTileHeight;
+        buildOptions << " -DTEMPORAL_WORDS=" << gTemporalWords << " -DTEMPORAL_ROWS=" << gTemporalRows
+                     << " -DTEMPORAL_GROUP_ROWS=" << gTemporalGroupRows
+                     << " -DTEMPORAL_MAX_GENERATIONS=" << gTemporalMaxGenerations;
+        buildOptions << " -DACTIVE_WORDS=" << gActiveWords << " -DACTIVE_ROWS=" << gActiveRows;
+        buildOptions << " -DCHUNK_SIZE=" << gChunkSize << " -DSAT_GROUP_SIZE=" << gSatGroupSize;
+        buildOptions << m_ruleOptions;
+
+        // Programs are kept by build options, and their binaries cached per device, source and options, so
+        // that the source is only built for a rule that was never seen
+        std::map<std::string, cl_program>::iterator program(m_programs.find(buildOptions.str()));
+        if (program != m_programs.end())
+            hProgram = program->second;
+        else
         {
-        case kst_file:
-            if (source.length() != 0)
+            clUnloadCompiler();
+            hProgram = m_programCache.load(m_hContext, m_hDevices[0], m_kernelSource, buildOptions.str());
+            if (hProgram == 0)
             {
-                source_str = loadFromFile(source, len);
+                const char *source_str(m_kernelSource.c_str());
+                len = m_kernelSource.length();
+                LOG_INFO("clCreateProgramWithSource\n");
+                hProgram = clCreateProgramWithSource(m_hContext, 1, (const char **)&source_str, (const size_t *)&len,
+                                                     &status);
+                CHECKSTATUS(status);
+
+                LOG_INFO("clBuildProgram\n");
+                status = clBuildProgram(hProgram, 0, NULL, buildOptions.str().c_str(), NULL, NULL);
+                CHECKSTATUS(status);
+                if (status == CL_SUCCESS)
+                    m_programCache.store(hProgram, m_hDevices[0], m_kernelSource, buildOptions.str());
             }
-            break;
-        case kst_string:
-        {
-            source_str = source.c_str();
-            len = source.length();
-        }
-        break;
+            clUnloadCompiler();
+            m_programs[buildOptions.str()] = hProgram;
         }
 
-        LOG_INFO("clCreateProgramWithSource\n");
-        hProgram = clCreateProgramWithSource(m_hContext, 1, (const char **)&source_str, (const size_t *)&len, &status);
+        releaseKernels();
+
+        LOG_INFO("clCreateKernel(main_kernel)\n");
+        m_hMainKernel = clCreateKernel(hProgram, "main_kernel", &status);
         CHECKSTATUS(status);
 
-        LOG_INFO("clCreateProgramWithSource\n");
-        hProgram = clCreateProgramWithSource(m_hContext, 1, (const char **)&source_str, (const size_t *)&len, &status);
+        LOG_INFO("clCreateKernel(tiled_kernel)\n");
+        m_hTiledKernel = clCreateKernel(hProgram, "tiled_kernel", &status);
         CHECKSTATUS(status);
 
-        LOG_INFO("clBuildProgram\n");
-        CHECKSTATUS(clBuildProgram(hProgram, 0, NULL, options.c_str(), NULL, NULL));
+        LOG_INFO("clCreateKernel(average_kernel)\n");
+        m_hAverageKernel = clCreateKernel(hProgram, "average_kernel", &status);
+        CHECKSTATUS(status);
 
-        if (sourceType == kst_file)
-        {
-            delete[] source_str;
-            source_str = NULL;
-        }
+        LOG_INFO("clCreateKernel(colorize_kernel)\n");
+        m_hColorizeKernel = clCreateKernel(hProgram, "colorize_kernel", &status);
+        CHECKSTATUS(status);
 
-        clUnloadCompiler();
+        LOG_INFO("clCreateKernel(alive_kernel)\n");
+        m_hAliveKernel = clCreateKernel(hProgram, "alive_kernel", &status);
+        CHECKSTATUS(status);
 
-        LOG_INFO("clCreateKernel(main_kernel)\n");
-        m_hMainKernel = clCreateKernel(hProgram, "main_kernel", &status);
+        LOG_INFO("clCreateKernel(packed_init_kernel)\n");
+        m_hPackedInitKernel = clCreateKernel(hProgram, "packed_init_kernel", &status);
+        CHECKSTATUS(status);
+
+        LOG_INFO("clCreateKernel(packed_scatter_kernel)\n");
+        m_hPackedScatterKernel = clCreateKernel(hProgram, "packed_scatter_kernel", &status);
+        CHECKSTATUS(status);
+
+        LOG_INFO("clCreateKernel(packed_kernel)\n");
+        m_hPackedKernel = clCreateKernel(hProgram, "packed_kernel", &status);
+        CHECKSTATUS(status);
+
+        LOG_INFO("clCreateKernel(packed_temporal_kernel)\n");
+        m_hPackedTemporalKernel = clCreateKernel(hProgram, "packed_temporal_kernel", &status);
+        CHECKSTATUS(status);
+
+        LOG_INFO("clCreateKernel(packed_colorize_kernel)\n");
+        m_hPackedColorizeKernel = clCreateKernel(hProgram, "packed_colorize_kernel", &status);
+        CHECKSTATUS(status);
+
+        LOG_INFO("clCreateKernel(active_tiles_kernel)\n");
+        m_hActiveTilesKernel = clCreateKernel(hProgram, "active_tiles_kernel", &status);
+        CHECKSTATUS(status);
+
+        LOG_INFO("clCreateKernel(packed_active_kernel)\n");
+        m_hPackedActiveKernel = clCreateKernel(hProgram, "packed_active_kernel", &status);
+        CHECKSTATUS(status);
+
+        LOG_INFO("clCreateKernel(chunk_kernel)\n");
+        m_hChunkKernel = clCreateKernel(hProgram, "chunk_kernel", &status);
+        CHECKSTATUS(status);
+
+        LOG_INFO("clCreateKernel(chunk_window_kernel)\n");
+        m_hChunkWindowKernel = clCreateKernel(hProgram, "chunk_window_kernel", &status);
+        CHECKSTATUS(status);
+
+        LOG_INFO("clCreateKernel(state_init_kernel)\n");
+        m_hStateInitKernel = clCreateKernel(hProgram, "state_init_kernel", &status);
+        CHECKSTATUS(status);
+
+        LOG_INFO("clCreateKernel(state_scatter_kernel)\n");
+        m_hStateScatterKernel = clCreateKernel(hProgram, "state_scatter_kernel", &status);
+        CHECKSTATUS(status);
+
+        LOG_INFO("clCreateKernel(state_kernel)\n");
+        m_hStateKernel = clCreateKernel(hProgram, "state_kernel", &status);
+        CHECKSTATUS(status);
+
+        LOG_INFO("clCreateKernel(state_colorize_kernel)\n");
+        m_hStateColorizeKernel = clCreateKernel(hProgram, "state_colorize_kernel", &status);
+        CHECKSTATUS(status);
+
+        LOG_INFO("clCreateKernel(sat_rows_kernel)\n");
+        m_hSatRowsKernel = clCreateKernel(hProgram, "sat_rows_kernel", &status);
+        CHECKSTATUS(status);
+
+        LOG_INFO("clCreateKernel(sat_columns_kernel)\n");
+        m_hSatColumnsKernel = clCreateKernel(hProgram, "sat_columns_kernel", &status);
+        CHECKSTATUS(status);
+
+        LOG_INFO("clCreateKernel(larger_kernel)\n");
+        m_hLargerKernel = clCreateKernel(hProgram, "larger_kernel", &status);
         CHECKSTATUS(status);
 
         // if( m_computeUnits == 0 )
@@ -370,52 +476,15 @@ void OpenCLKernel::compileKernels(const KernelSourceType sourceType, const std::
             LOG_INFO(s.str());
             std::cout << s.str() << std::endl;
         }
-#if 0
-		// Generate Binaries!!!
-		// Obtain the length of the binary data that will be queried, for each device
-		size_t ret_num_devices = 1;
-		size_t binaries_sizes[MAX_DEVICES];
-		CHECKSTATUS(clGetProgramInfo(
-			hProgram,
-			CL_PROGRAM_BINARY_SIZES,
-			ret_num_devices * sizeof(size_t),
-			binaries_sizes,
-			0));
-
-		char **binaries = new char*[MAX_DEVICES];
-		for (size_t i = 0; i < ret_num_devices; i++)
-			binaries[i] = new char[binaries_sizes[i] + 1];
-
-		CHECKSTATUS(clGetProgramInfo(
-			hProgram,
-			CL_PROGRAM_BINARIES,
-			MAX_DEVICES * sizeof(size_t),
-			binaries,
-			NULL));
-
-		for (size_t i = 0; i < ret_num_devices; i++) {
-			binaries[i][binaries_sizes[i]] = '\0';
-			char name[255];
-			sprintf_s(name, 255, "kernel%d.ptx", i);
-			FILE* fp = NULL;
-			fopen_s(&fp, name, "w");
-			fwrite(binaries[i], 1, binaries_sizes[i], fp);
-			fclose(fp);
-		}
-
-		for (size_t i = 0; i < ret_num_devices; i++)
-			delete[] binaries[i];
-		delete[] binaries;
-#endif // 0
-
-        if (ptxFileName.length() != 0)
+
+        if (m_ptxFileName.length() != 0)
         {
             // Open the ptx file and load it
             // into a char* buffer
             std::ifstream myReadFile;
             std::string str;
             std::string line;
-            std::ifstream myfile(ptxFileName.c_str());
+            std::ifstream myfile(m_ptxFileName.c_str());
             if (myfile.is_open())
             {
                 while (myfile.good())
@@ -428,24 +497,31 @@ void OpenCLKernel::compileKernels(const KernelSourceType sourceType, const std::
 
             size_t lSize = str.length();
             char *buffer = new char[lSize + 1];
-            strcpy_s(buffer, lSize, str.c_str());
+            memcpy(buffer, str.c_str(), lSize + 1);
 
-            // Build the rendering kernel
+            // Build the rendering kernel, which keeps its own reference to the program
             int errcode(0);
-            hProgram = clCreateProgramWithBinary(m_hContext, 1, &m_hDevices[0], &lSize, (const unsigned char **)&buffer,
-                                                 &status, &errcode);
+            cl_program hBinaryProgram = clCreateProgramWithBinary(m_hContext, 1, &m_hDevices[0], &lSize,
+                                                                  (const unsigned char **)&buffer, &status, &errcode);
             CHECKSTATUS(errcode);
 
-            CHECKSTATUS(clBuildProgram(hProgram, 0, NULL, "", NULL, NULL));
-            m_hMainKernel = clCreateKernel(hProgram, "main_kernel", &status);
+            CHECKSTATUS(clBuildProgram(hBinaryProgram, 0, NULL, "", NULL, NULL));
+            CHECKSTATUS(clReleaseKernel(m_hMainKernel));
+            m_hMainKernel = clCreateKernel(hBinaryProgram, "main_kernel", &status);
             CHECKSTATUS(status);
+            CHECKSTATUS(clReleaseProgram(hBinaryProgram));
 
             delete[] buffer;
         }
 
-        LOG_INFO("clReleaseProgram\n");
-        CHECKSTATUS(clReleaseProgram(hProgram));
-        hProgram = 0;
+        setKernelArguments();
+
+        // Kept for the kernels of other classes, such as BoardBatch
+        m_hProgram = hProgram;
+
+        // A main kernel of a ptx file runs whatever rule it was built for
+        if (m_ptxFileName.empty())
+            m_builtRuleOptions = m_ruleOptions;
     }
     catch (...)
     {
@@ -453,25 +529,108 @@ void OpenCLKernel::compileKernels(const KernelSourceType sourceType, const std::
     }
 }
 
-void OpenCLKernel::initializeDevice(int width, int height)
+void OpenCLKernel::initializeDevice(int width, int height, const CellStorage storage)
 {
     int status(0);
+    m_storage = storage;
+    m_width = width;
+    m_height = height;
+    m_wordsPerRow = packedWords(width);
 
     // Setup device memory
     LOG_INFO("Setup device memory\n");
     m_hBitmap = clCreateBuffer(m_hContext, CL_MEM_WRITE_ONLY, width * height * sizeof(BYTE) * gColorDepth, 0, NULL);
-    m_hBuffer = clCreateBuffer(m_hContext, CL_MEM_READ_WRITE, 2 * width * height * sizeof(cl_float4), 0, NULL);
-    m_hTextures = clCreateBuffer(m_hContext, CL_MEM_READ_ONLY,
-                                 gTextureWidth * gTextureHeight * gTextureDepth * sizeof(BYTE), 0, NULL);
+    switch (m_storage)
+    {
+    case cs_packed:
+        // Two generations of packed words
+        m_hPackedBuffer =
+            clCreateBuffer(m_hContext, CL_MEM_READ_WRITE, 2 * m_wordsPerRow * height * sizeof(cl_uint), 0, NULL);
+
+        // Changed flags of two generations, list of the active tiles and its length for two generations
+        m_activeTilesPerRow = (m_wordsPerRow + gActiveWords - 1) / gActiveWords;
+        m_activeTileRows = (height + gActiveRows - 1) / gActiveRows;
+        m_hActiveFlags = clCreateBuffer(m_hContext, CL_MEM_READ_WRITE,
+                                        2 * m_activeTilesPerRow * m_activeTileRows * sizeof(cl_int), 0, NULL);
+        m_hActiveTiles = clCreateBuffer(m_hContext, CL_MEM_READ_WRITE,
+                                        m_activeTilesPerRow * m_activeTileRows * sizeof(cl_int), 0, NULL);
+        m_hActiveCounts = clCreateBuffer(m_hContext, CL_MEM_READ_WRITE, 2 * sizeof(cl_int), 0, NULL);
+        m_activeFlagsValid = false;
+
+        // Copy of a generation, read back by snapshots while the board advances
+        m_hSnapshotBuffer =
+            clCreateBuffer(m_hContext, CL_MEM_READ_WRITE, m_wordsPerRow * height * sizeof(cl_uint), 0, NULL);
+
+        // Batch of alive words of a pattern
+        m_hScatterBuffer =
+            clCreateBuffer(m_hContext, CL_MEM_READ_ONLY, 2 * gPatternBatchWords * sizeof(cl_uint), 0, NULL);
+        break;
+    case cs_chunked:
+    {
+        // Packed cells of the board window, and chunks allocated as the pattern grows
+        m_hPackedBuffer =
+            clCreateBuffer(m_hContext, CL_MEM_READ_WRITE, m_wordsPerRow * height * sizeof(cl_uint), 0, NULL);
+        cl_int windowChunks = ((width + gChunkSize - 1) / gChunkSize) * ((height + gChunkSize - 1) / gChunkSize);
+        m_hWindowSlots = clCreateBuffer(m_hContext, CL_MEM_READ_ONLY, windowChunks * sizeof(cl_int), 0, NULL);
+        m_chunks.clear();
+        m_freeChunks.clear();
+        m_chunkSlots = 0;
+        m_chunkZeros.assign(gChunkWords * gChunkSize, 0);
+        growChunks(gChunkInitialCapacity);
+        break;
+    }
+    case cs_states:
+        // Two generations of cell states and ages
+        m_hStateBuffer = clCreateBuffer(m_hContext, CL_MEM_READ_WRITE, 2 * width * height * sizeof(cl_ushort), 0, NULL);
+
+        // Copy of a generation, read back by snapshots while the board advances
+        m_hSnapshotBuffer = clCreateBuffer(m_hContext, CL_MEM_READ_WRITE, width * height * sizeof(cl_ushort), 0, NULL);
+
+        // Batch of alive words of a pattern
+        m_hScatterBuffer =
+            clCreateBuffer(m_hContext, CL_MEM_READ_ONLY, 2 * gPatternBatchWords * sizeof(cl_uint), 0, NULL);
+        break;
+    default:
+        // Two generations of colors, the alive mask of the current one, and the summed-area table of Larger than
+        // Life rules
+        m_hBuffer = clCreateBuffer(m_hContext, CL_MEM_READ_WRITE, 2 * width * height * sizeof(cl_float4), 0, NULL);
+        m_hAliveMask = clCreateBuffer(m_hContext, CL_MEM_READ_WRITE, width * height * sizeof(cl_uchar), 0, NULL);
+        m_hSumBuffer =
+            clCreateBuffer(m_hContext, CL_MEM_READ_WRITE, (width + 1) * (height + 1) * sizeof(cl_uint), 0, NULL);
+        break;
+    }
+    // RGBA image sampled by the kernels in normalized coordinates, whatever the size of the board
+    cl_image_format textureFormat;
+    textureFormat.image_channel_order = CL_RGBA;
+    textureFormat.image_channel_data_type = CL_UNSIGNED_INT8;
+    cl_image_desc textureDesc;
+    memset(&textureDesc, 0, sizeof(textureDesc));
+    textureDesc.image_type = CL_MEM_OBJECT_IMAGE2D;
+    textureDesc.image_width = gTextureWidth;
+    textureDesc.image_height = gTextureHeight;
+    m_hTextures = clCreateImage(m_hContext, CL_MEM_READ_ONLY, &textureFormat, &textureDesc, 0, &status);
+    CHECKSTATUS(status);
     m_hVideo = clCreateBuffer(m_hContext, CL_MEM_READ_ONLY, gVideoWidth * gVideoHeight * gKinectColorVideo, 0, NULL);
     m_hDepth = clCreateBuffer(m_hContext, CL_MEM_READ_ONLY, gDepthWidth * gDepthHeight * gKinectColorDepth, 0, NULL);
 
     // Setup World
     m_textures = new BYTE[gTextureWidth * gTextureHeight * gColorDepth];
+
+    setKernelArguments();
 }
 
 void OpenCLKernel::releaseDevice()
 {
+    releaseFrames();
+    if (m_snapshotEvent)
+    {
+        CHECKSTATUS(clWaitForEvents(1, &m_snapshotEvent));
+        CHECKSTATUS(clReleaseEvent(m_snapshotEvent));
+    }
+    m_snapshotEvent = 0;
+    m_snapshotPending = false;
+    m_profiler.collect(true);
+
     LOG_INFO("Release device memory\n");
     if (m_hTextures)
         CHECKSTATUS(clReleaseMemObject(m_hTextures));
@@ -480,197 +639,1464 @@ void OpenCLKernel::releaseDevice()
         CHECKSTATUS(clReleaseMemObject(m_hBitmap));
     if (m_hBuffer)
         CHECKSTATUS(clReleaseMemObject(m_hBuffer));
+    if (m_hAliveMask)
+        CHECKSTATUS(clReleaseMemObject(m_hAliveMask));
+    if (m_hPackedBuffer)
+        CHECKSTATUS(clReleaseMemObject(m_hPackedBuffer));
+    if (m_hSnapshotBuffer)
+        CHECKSTATUS(clReleaseMemObject(m_hSnapshotBuffer));
+    if (m_hScatterBuffer)
+        CHECKSTATUS(clReleaseMemObject(m_hScatterBuffer));
+    if (m_hActiveFlags)
+        CHECKSTATUS(clReleaseMemObject(m_hActiveFlags));
+    if (m_hActiveTiles)
+        CHECKSTATUS(clReleaseMemObject(m_hActiveTiles));
+    if (m_hActiveCounts)
+        CHECKSTATUS(clReleaseMemObject(m_hActiveCounts));
+    if (m_hChunks)
+        CHECKSTATUS(clReleaseMemObject(m_hChunks));
+    if (m_hChunkNeighbors)
+        CHECKSTATUS(clReleaseMemObject(m_hChunkNeighbors));
+    if (m_hChunkSummaries)
+        CHECKSTATUS(clReleaseMemObject(m_hChunkSummaries));
+    if (m_hWindowSlots)
+        CHECKSTATUS(clReleaseMemObject(m_hWindowSlots));
+    if (m_hStateBuffer)
+        CHECKSTATUS(clReleaseMemObject(m_hStateBuffer));
+    if (m_hSumBuffer)
+        CHECKSTATUS(clReleaseMemObject(m_hSumBuffer));
     if (m_hVideo)
         CHECKSTATUS(clReleaseMemObject(m_hVideo));
     if (m_hDepth)
         CHECKSTATUS(clReleaseMemObject(m_hDepth));
 
-    if (m_hMainKernel)
-        CHECKSTATUS(clReleaseKernel(m_hMainKernel));
+    releaseKernels();
+    for (std::map<std::string, cl_program>::iterator it(m_programs.begin()); it != m_programs.end(); ++it)
+        CHECKSTATUS(clReleaseProgram(it->second));
+    m_programs.clear();
+    m_hProgram = 0;
+    m_builtRuleOptions.clear();
 
     if (m_hQueue)
         CHECKSTATUS(clReleaseCommandQueue(m_hQueue));
+    if (m_hTransferQueue)
+        CHECKSTATUS(clReleaseCommandQueue(m_hTransferQueue));
     if (m_hContext)
         CHECKSTATUS(clReleaseContext(m_hContext));
 
-    delete m_textures;
+    delete[] m_textures;
 }
 
 /*
- * runKernel
+ * releaseKernels
  */
-void OpenCLKernel::render(const unsigned width, const unsigned int height, BYTE *bitmap, const float value)
+void OpenCLKernel::releaseKernels()
 {
-    int status(0);
+    if (m_hMainKernel)
+        CHECKSTATUS(clReleaseKernel(m_hMainKernel));
+    if (m_hTiledKernel)
+        CHECKSTATUS(clReleaseKernel(m_hTiledKernel));
+    if (m_hAverageKernel)
+        CHECKSTATUS(clReleaseKernel(m_hAverageKernel));
+    if (m_hColorizeKernel)
+        CHECKSTATUS(clReleaseKernel(m_hColorizeKernel));
+    if (m_hAliveKernel)
+        CHECKSTATUS(clReleaseKernel(m_hAliveKernel));
+    if (m_hPackedInitKernel)
+        CHECKSTATUS(clReleaseKernel(m_hPackedInitKernel));
+    if (m_hPackedScatterKernel)
+        CHECKSTATUS(clReleaseKernel(m_hPackedScatterKernel));
+    if (m_hPackedKernel)
+        CHECKSTATUS(clReleaseKernel(m_hPackedKernel));
+    if (m_hPackedTemporalKernel)
+        CHECKSTATUS(clReleaseKernel(m_hPackedTemporalKernel));
+    if (m_hPackedColorizeKernel)
+        CHECKSTATUS(clReleaseKernel(m_hPackedColorizeKernel));
+    if (m_hActiveTilesKernel)
+        CHECKSTATUS(clReleaseKernel(m_hActiveTilesKernel));
+    if (m_hPackedActiveKernel)
+        CHECKSTATUS(clReleaseKernel(m_hPackedActiveKernel));
+    if (m_hChunkKernel)
+        CHECKSTATUS(clReleaseKernel(m_hChunkKernel));
+    if (m_hChunkWindowKernel)
+        CHECKSTATUS(clReleaseKernel(m_hChunkWindowKernel));
+    if (m_hStateInitKernel)
+        CHECKSTATUS(clReleaseKernel(m_hStateInitKernel));
+    if (m_hStateScatterKernel)
+        CHECKSTATUS(clReleaseKernel(m_hStateScatterKernel));
+    if (m_hStateKernel)
+        CHECKSTATUS(clReleaseKernel(m_hStateKernel));
+    if (m_hStateColorizeKernel)
+        CHECKSTATUS(clReleaseKernel(m_hStateColorizeKernel));
+    if (m_hSatRowsKernel)
+        CHECKSTATUS(clReleaseKernel(m_hSatRowsKernel));
+    if (m_hSatColumnsKernel)
+        CHECKSTATUS(clReleaseKernel(m_hSatColumnsKernel));
+    if (m_hLargerKernel)
+        CHECKSTATUS(clReleaseKernel(m_hLargerKernel));
+
+    m_hMainKernel = 0;
+    m_hTiledKernel = 0;
+    m_hAverageKernel = 0;
+    m_hColorizeKernel = 0;
+    m_hAliveKernel = 0;
+    m_hPackedInitKernel = 0;
+    m_hPackedScatterKernel = 0;
+    m_hPackedKernel = 0;
+    m_hPackedTemporalKernel = 0;
+    m_hPackedColorizeKernel = 0;
+    m_hActiveTilesKernel = 0;
+    m_hPackedActiveKernel = 0;
+    m_hChunkKernel = 0;
+    m_hChunkWindowKernel = 0;
+    m_hStateInitKernel = 0;
+    m_hStateScatterKernel = 0;
+    m_hStateKernel = 0;
+    m_hStateColorizeKernel = 0;
+    m_hSatRowsKernel = 0;
+    m_hSatColumnsKernel = 0;
+    m_hLargerKernel = 0;
+}
 
+/*
+ * transferTextures
+ */
+void OpenCLKernel::transferTextures()
+{
     BYTE *video(0);
     BYTE *depth(0);
 
     // Textures
+    cl_event event(0);
     if (!m_texturedTransfered)
     {
-        CHECKSTATUS(clEnqueueWriteBuffer(m_hQueue, m_hTextures, CL_TRUE, 0,
-                                         gTextureDepth * gTextureWidth * gTextureHeight, m_textures, 0, NULL, NULL));
+        size_t origin[3] = {0, 0, 0};
+        size_t region[3] = {gTextureWidth, gTextureHeight, 1};
+        CHECKSTATUS(clEnqueueWriteImage(m_hQueue, m_hTextures, CL_TRUE, origin, region, gTextureWidth * gColorDepth, 0,
+                                        m_textures, 0, NULL, m_profiler.event(event)));
+        m_profiler.track(ps_upload, event);
         m_texturedTransfered = true;
     }
 
     // Kinect stuff
     if (video)
+    {
         CHECKSTATUS(clEnqueueWriteBuffer(m_hQueue, m_hVideo, CL_TRUE, 0, gKinectColorVideo * gVideoWidth * gVideoHeight,
-                                         video, 0, NULL, NULL));
+                                         video, 0, NULL, m_profiler.event(event)));
+        m_profiler.track(ps_upload, event);
+    }
     if (depth)
+    {
         CHECKSTATUS(clEnqueueWriteBuffer(m_hQueue, m_hDepth, CL_TRUE, 0, gKinectColorDepth * gDepthWidth * gDepthHeight,
-                                         depth, 0, NULL, NULL));
-
-    // Setting kernel arguments
-    CHECKSTATUS(clSetKernelArg(m_hMainKernel, 0, sizeof(cl_int), (void *)&width));
-    CHECKSTATUS(clSetKernelArg(m_hMainKernel, 1, sizeof(cl_int), (void *)&height));
-    CHECKSTATUS(clSetKernelArg(m_hMainKernel, 2, sizeof(cl_mem), (void *)&m_hBitmap));
-    CHECKSTATUS(clSetKernelArg(m_hMainKernel, 3, sizeof(cl_mem), (void *)&m_hBuffer));
-    CHECKSTATUS(clSetKernelArg(m_hMainKernel, 4, sizeof(cl_mem), (void *)&m_hVideo));
-    CHECKSTATUS(clSetKernelArg(m_hMainKernel, 5, sizeof(cl_mem), (void *)&m_hDepth));
-    CHECKSTATUS(clSetKernelArg(m_hMainKernel, 6, sizeof(cl_mem), (void *)&m_hTextures));
-    CHECKSTATUS(clSetKernelArg(m_hMainKernel, 7, sizeof(cl_int), (void *)&m_offset));
-    CHECKSTATUS(clSetKernelArg(m_hMainKernel, 8, sizeof(cl_float), (void *)&value));
-    CHECKSTATUS(clSetKernelArg(m_hMainKernel, 9, sizeof(cl_float), (void *)&m_timer));
-
-    size_t globalWorkSize[] = {width, height};
-    // run initial kernel
-    CHECKSTATUS(clEnqueueNDRangeKernel(m_hQueue, m_hMainKernel, 2, NULL, globalWorkSize, 0, 0, 0, 0));
-
-    // ------------------------------------------------------------
-    // Read back the results
-    // ------------------------------------------------------------
-    // Bitmap
-    if (bitmap != 0)
+                                         depth, 0, NULL, m_profiler.event(event)));
+        m_profiler.track(ps_upload, event);
+    }
+}
+
+/*
+ * setKernelArguments
+ */
+void OpenCLKernel::setKernelArguments()
+{
+    // Arguments that do not change from one launch to the next. The offset, limit, timer, number of
+    // generations and target bitmap are set when enqueuing
+    if (m_hMainKernel == 0 || (m_hBuffer == 0 && m_hPackedBuffer == 0 && m_hStateBuffer == 0))
+        return;
+
+    cl_kernel kernels[] = {m_hMainKernel, m_hTiledKernel, m_hAverageKernel};
+    for (size_t i(0); i < sizeof(kernels) / sizeof(cl_kernel); ++i)
+    {
+        CHECKSTATUS(clSetKernelArg(kernels[i], 0, sizeof(cl_int), (void *)&m_width));
+        CHECKSTATUS(clSetKernelArg(kernels[i], 1, sizeof(cl_int), (void *)&m_height));
+        CHECKSTATUS(clSetKernelArg(kernels[i], 2, sizeof(cl_mem), (void *)&m_hBuffer));
+        CHECKSTATUS(clSetKernelArg(kernels[i], 3, sizeof(cl_mem), (void *)&m_hVideo));
+        CHECKSTATUS(clSetKernelArg(kernels[i], 4, sizeof(cl_mem), (void *)&m_hDepth));
+        CHECKSTATUS(clSetKernelArg(kernels[i], 5, sizeof(cl_mem), (void *)&m_hTextures));
+    }
+    CHECKSTATUS(clSetKernelArg(m_hMainKernel, 9, sizeof(cl_mem), (void *)&m_hAliveMask));
+    CHECKSTATUS(clSetKernelArg(m_hTiledKernel, 9, sizeof(cl_mem), (void *)&m_hAliveMask));
+
+    CHECKSTATUS(clSetKernelArg(m_hAliveKernel, 0, sizeof(cl_int), (void *)&m_width));
+    CHECKSTATUS(clSetKernelArg(m_hAliveKernel, 1, sizeof(cl_int), (void *)&m_height));
+    CHECKSTATUS(clSetKernelArg(m_hAliveKernel, 2, sizeof(cl_mem), (void *)&m_hBuffer));
+    CHECKSTATUS(clSetKernelArg(m_hAliveKernel, 3, sizeof(cl_mem), (void *)&m_hAliveMask));
+
+    CHECKSTATUS(clSetKernelArg(m_hColorizeKernel, 0, sizeof(cl_int), (void *)&m_width));
+    CHECKSTATUS(clSetKernelArg(m_hColorizeKernel, 1, sizeof(cl_int), (void *)&m_height));
+    CHECKSTATUS(clSetKernelArg(m_hColorizeKernel, 3, sizeof(cl_mem), (void *)&m_hBuffer));
+
+    CHECKSTATUS(clSetKernelArg(m_hPackedInitKernel, 0, sizeof(cl_int), (void *)&m_width));
+    CHECKSTATUS(clSetKernelArg(m_hPackedInitKernel, 1, sizeof(cl_int), (void *)&m_height));
+    CHECKSTATUS(clSetKernelArg(m_hPackedInitKernel, 2, sizeof(cl_int), (void *)&m_wordsPerRow));
+    CHECKSTATUS(clSetKernelArg(m_hPackedInitKernel, 3, sizeof(cl_mem), (void *)&m_hPackedBuffer));
+    CHECKSTATUS(clSetKernelArg(m_hPackedInitKernel, 4, sizeof(cl_mem), (void *)&m_hTextures));
+
+    CHECKSTATUS(clSetKernelArg(m_hPackedScatterKernel, 0, sizeof(cl_mem), (void *)&m_hPackedBuffer));
+    CHECKSTATUS(clSetKernelArg(m_hPackedScatterKernel, 1, sizeof(cl_mem), (void *)&m_hScatterBuffer));
+
+    cl_kernel packedKernels[] = {m_hPackedKernel, m_hPackedTemporalKernel, m_hPackedActiveKernel};
+    for (size_t i(0); i < sizeof(packedKernels) / sizeof(cl_kernel); ++i)
+    {
+        CHECKSTATUS(clSetKernelArg(packedKernels[i], 0, sizeof(cl_int), (void *)&m_width));
+        CHECKSTATUS(clSetKernelArg(packedKernels[i], 1, sizeof(cl_int), (void *)&m_height));
+        CHECKSTATUS(clSetKernelArg(packedKernels[i], 2, sizeof(cl_int), (void *)&m_wordsPerRow));
+        CHECKSTATUS(clSetKernelArg(packedKernels[i], 3, sizeof(cl_mem), (void *)&m_hPackedBuffer));
+        CHECKSTATUS(clSetKernelArg(packedKernels[i], 5, sizeof(cl_uint), (void *)&m_birth));
+        CHECKSTATUS(clSetKernelArg(packedKernels[i], 6, sizeof(cl_uint), (void *)&m_survival));
+    }
+
+    CHECKSTATUS(clSetKernelArg(m_hPackedColorizeKernel, 0, sizeof(cl_int), (void *)&m_width));
+    CHECKSTATUS(clSetKernelArg(m_hPackedColorizeKernel, 1, sizeof(cl_int), (void *)&m_height));
+    CHECKSTATUS(clSetKernelArg(m_hPackedColorizeKernel, 2, sizeof(cl_int), (void *)&m_wordsPerRow));
+    CHECKSTATUS(clSetKernelArg(m_hPackedColorizeKernel, 4, sizeof(cl_mem), (void *)&m_hPackedBuffer));
+    CHECKSTATUS(clSetKernelArg(m_hPackedColorizeKernel, 5, sizeof(cl_mem), (void *)&m_hTextures));
+
+    CHECKSTATUS(clSetKernelArg(m_hStateInitKernel, 0, sizeof(cl_int), (void *)&m_width));
+    CHECKSTATUS(clSetKernelArg(m_hStateInitKernel, 1, sizeof(cl_int), (void *)&m_height));
+    CHECKSTATUS(clSetKernelArg(m_hStateInitKernel, 2, sizeof(cl_mem), (void *)&m_hStateBuffer));
+    CHECKSTATUS(clSetKernelArg(m_hStateInitKernel, 3, sizeof(cl_mem), (void *)&m_hTextures));
+
+    CHECKSTATUS(clSetKernelArg(m_hStateScatterKernel, 0, sizeof(cl_int), (void *)&m_width));
+    CHECKSTATUS(clSetKernelArg(m_hStateScatterKernel, 1, sizeof(cl_int), (void *)&m_wordsPerRow));
+    CHECKSTATUS(clSetKernelArg(m_hStateScatterKernel, 2, sizeof(cl_mem), (void *)&m_hStateBuffer));
+    CHECKSTATUS(clSetKernelArg(m_hStateScatterKernel, 3, sizeof(cl_mem), (void *)&m_hScatterBuffer));
+
+    CHECKSTATUS(clSetKernelArg(m_hStateKernel, 0, sizeof(cl_int), (void *)&m_width));
+    CHECKSTATUS(clSetKernelArg(m_hStateKernel, 1, sizeof(cl_int), (void *)&m_height));
+    CHECKSTATUS(clSetKernelArg(m_hStateKernel, 2, sizeof(cl_mem), (void *)&m_hStateBuffer));
+    CHECKSTATUS(clSetKernelArg(m_hStateKernel, 4, sizeof(cl_uint), (void *)&m_birth));
+    CHECKSTATUS(clSetKernelArg(m_hStateKernel, 5, sizeof(cl_uint), (void *)&m_survival));
+
+    CHECKSTATUS(clSetKernelArg(m_hStateColorizeKernel, 0, sizeof(cl_int), (void *)&m_width));
+    CHECKSTATUS(clSetKernelArg(m_hStateColorizeKernel, 1, sizeof(cl_int), (void *)&m_height));
+    CHECKSTATUS(clSetKernelArg(m_hStateColorizeKernel, 3, sizeof(cl_mem), (void *)&m_hStateBuffer));
+    CHECKSTATUS(clSetKernelArg(m_hStateColorizeKernel, 4, sizeof(cl_mem), (void *)&m_hTextures));
+
+    CHECKSTATUS(clSetKernelArg(m_hSatRowsKernel, 0, sizeof(cl_int), (void *)&m_width));
+    CHECKSTATUS(clSetKernelArg(m_hSatRowsKernel, 1, sizeof(cl_int), (void *)&m_height));
+    CHECKSTATUS(clSetKernelArg(m_hSatRowsKernel, 2, sizeof(cl_mem), (void *)&m_hAliveMask));
+    CHECKSTATUS(clSetKernelArg(m_hSatRowsKernel, 3, sizeof(cl_mem), (void *)&m_hSumBuffer));
+
+    CHECKSTATUS(clSetKernelArg(m_hLargerKernel, 0, sizeof(cl_int), (void *)&m_width));
+    CHECKSTATUS(clSetKernelArg(m_hLargerKernel, 1, sizeof(cl_int), (void *)&m_height));
+    CHECKSTATUS(clSetKernelArg(m_hLargerKernel, 2, sizeof(cl_mem), (void *)&m_hBuffer));
+    CHECKSTATUS(clSetKernelArg(m_hLargerKernel, 3, sizeof(cl_mem), (void *)&m_hSumBuffer));
+    CHECKSTATUS(clSetKernelArg(m_hLargerKernel, 4, sizeof(cl_mem), (void *)&m_hAliveMask));
+
+    CHECKSTATUS(clSetKernelArg(m_hSatColumnsKernel, 0, sizeof(cl_int), (void *)&m_width));
+    CHECKSTATUS(clSetKernelArg(m_hSatColumnsKernel, 1, sizeof(cl_int), (void *)&m_height));
+    CHECKSTATUS(clSetKernelArg(m_hSatColumnsKernel, 2, sizeof(cl_mem), (void *)&m_hSumBuffer));
+
+    if (m_hChunks != 0)
     {
-        CHECKSTATUS(clEnqueueReadBuffer(m_hQueue, m_hBitmap, CL_FALSE, 0, width * height * sizeof(BYTE) * gColorDepth,
-                                        bitmap, 0, NULL, NULL));
+        // Births with 0 neighbors would fill the unbounded board
+        cl_uint birth = m_birth & ~1u;
+        CHECKSTATUS(clSetKernelArg(m_hChunkKernel, 0, sizeof(cl_mem), (void *)&m_hChunks));
+        CHECKSTATUS(clSetKernelArg(m_hChunkKernel, 1, sizeof(cl_mem), (void *)&m_hChunkNeighbors));
+        CHECKSTATUS(clSetKernelArg(m_hChunkKernel, 2, sizeof(cl_mem), (void *)&m_hChunkSummaries));
+        CHECKSTATUS(clSetKernelArg(m_hChunkKernel, 4, sizeof(cl_uint), (void *)&birth));
+        CHECKSTATUS(clSetKernelArg(m_hChunkKernel, 5, sizeof(cl_uint), (void *)&m_survival));
+
+        CHECKSTATUS(clSetKernelArg(m_hChunkWindowKernel, 0, sizeof(cl_int), (void *)&m_width));
+        CHECKSTATUS(clSetKernelArg(m_hChunkWindowKernel, 1, sizeof(cl_int), (void *)&m_height));
+        CHECKSTATUS(clSetKernelArg(m_hChunkWindowKernel, 2, sizeof(cl_int), (void *)&m_wordsPerRow));
+        CHECKSTATUS(clSetKernelArg(m_hChunkWindowKernel, 3, sizeof(cl_mem), (void *)&m_hPackedBuffer));
+        CHECKSTATUS(clSetKernelArg(m_hChunkWindowKernel, 4, sizeof(cl_mem), (void *)&m_hChunks));
+        CHECKSTATUS(clSetKernelArg(m_hChunkWindowKernel, 5, sizeof(cl_mem), (void *)&m_hWindowSlots));
     }
 
+    if (m_hActiveFlags == 0)
+        return;
+    CHECKSTATUS(clSetKernelArg(m_hActiveTilesKernel, 0, sizeof(cl_int), (void *)&m_activeTilesPerRow));
+    CHECKSTATUS(clSetKernelArg(m_hActiveTilesKernel, 1, sizeof(cl_int), (void *)&m_activeTileRows));
+    CHECKSTATUS(clSetKernelArg(m_hActiveTilesKernel, 2, sizeof(cl_mem), (void *)&m_hActiveFlags));
+    CHECKSTATUS(clSetKernelArg(m_hActiveTilesKernel, 3, sizeof(cl_mem), (void *)&m_hActiveTiles));
+    CHECKSTATUS(clSetKernelArg(m_hActiveTilesKernel, 4, sizeof(cl_mem), (void *)&m_hActiveCounts));
+
+    CHECKSTATUS(clSetKernelArg(m_hPackedActiveKernel, 7, sizeof(cl_int), (void *)&m_activeTilesPerRow));
+    CHECKSTATUS(clSetKernelArg(m_hPackedActiveKernel, 8, sizeof(cl_mem), (void *)&m_hActiveFlags));
+    CHECKSTATUS(clSetKernelArg(m_hPackedActiveKernel, 9, sizeof(cl_mem), (void *)&m_hActiveTiles));
+    CHECKSTATUS(clSetKernelArg(m_hPackedActiveKernel, 10, sizeof(cl_mem), (void *)&m_hActiveCounts));
+}
+
+/*
+ * runKernel
+ */
+void OpenCLKernel::render(const unsigned width, const unsigned int height, BYTE *bitmap, const float value)
+{
+    // The first call only seeds the board
+    m_limit = value;
+    step((m_offset == -1) ? 0 : 1);
+    if (bitmap != 0)
+        readback(bitmap);
+
+    m_timer += 0.1f;
+}
+
+/*
+ * step
+ */
+void OpenCLKernel::step(const unsigned int generations)
+{
+    enqueueGenerations(generations);
     CHECKSTATUS(clFlush(m_hQueue));
     CHECKSTATUS(clFinish(m_hQueue));
+    m_profiler.collect(false);
+}
 
-    if (m_offset == -1)
-        m_offset = 1;
-    m_offset = (m_offset == 0) ? 1 : 0;
+void OpenCLKernel::setGenerationsPerLaunch(const int generations)
+{
+    m_generationsPerLaunch = (generations < 1) ? 1 : generations;
+    m_generationsPerLaunch =
+        (m_generationsPerLaunch > gTemporalMaxGenerations) ? gTemporalMaxGenerations : m_generationsPerLaunch;
+}
 
-    m_timer += 0.1f;
+/*
+ * colorize
+ */
+void OpenCLKernel::colorize()
+{
+    enqueueColorization(m_hBitmap, NULL);
 }
 
 /*
- *
+ * readback
  */
-OpenCLKernel::~OpenCLKernel()
+void OpenCLKernel::readback(BYTE *bitmap)
 {
-    // Clean up
-    releaseDevice();
+    cl_event event(0);
+    colorize();
+    CHECKSTATUS(clEnqueueReadBuffer(m_hQueue, m_hBitmap, CL_TRUE, 0, m_width * m_height * sizeof(BYTE) * gColorDepth,
+                                    bitmap, 0, NULL, m_profiler.event(event)));
+    m_profiler.track(ps_readback, event);
+    m_profiler.collect(false);
 }
 
-// ---------- Textures ----------
-void OpenCLKernel::setTexture(int index, BYTE *texture)
+// ---------- Frame pipeline ----------
+/*
+ * initializeFrames
+ */
+void OpenCLKernel::initializeFrames()
 {
-    BYTE *idx = m_textures + index * gTextureWidth * gTextureHeight * gTextureDepth;
-    int j(0);
-    for (int i(0); i < gTextureWidth * gTextureHeight * gColorDepth; i += gColorDepth)
+    // Device bitmaps, and pinned host buffers that stay mapped for the lifetime of the pipeline
+    int status(0);
+    size_t size = m_width * m_height * sizeof(BYTE) * gColorDepth;
+    for (int i(0); i < gFramesInFlight; ++i)
     {
-        idx[j] = texture[i + 2];
-        idx[j + 1] = texture[i + 1];
-        idx[j + 2] = texture[i];
-        j += gTextureDepth;
+        m_hFrameBitmaps[i] = clCreateBuffer(m_hContext, CL_MEM_READ_WRITE, size, 0, &status);
+        CHECKSTATUS(status);
+        m_hPinnedFrames[i] = clCreateBuffer(m_hContext, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, size, 0, &status);
+        CHECKSTATUS(status);
+        m_pinnedFrames[i] = (BYTE *)clEnqueueMapBuffer(m_hTransferQueue, m_hPinnedFrames[i], CL_TRUE,
+                                                       CL_MAP_READ | CL_MAP_WRITE, 0, size, 0, NULL, NULL, &status);
+        CHECKSTATUS(status);
     }
 }
 
 /*
- *
+ * releaseFrames
  */
-char *OpenCLKernel::loadFromFile(const std::string &filename, size_t &length)
+void OpenCLKernel::releaseFrames()
 {
-    // Load the kernel source code into the array source_str
-    FILE *fp = 0;
-    char *source_str = 0;
-
-    fopen_s(&fp, filename.c_str(), "r");
-    if (fp == 0)
+    for (int i(0); i < gFramesInFlight; ++i)
     {
-        std::cout << "Failed to load kernel " << filename.c_str() << std::endl;
+        if (m_readEvents[i])
+            CHECKSTATUS(clWaitForEvents(1, &m_readEvents[i]));
+        if (m_colorizeEvents[i])
+            CHECKSTATUS(clReleaseEvent(m_colorizeEvents[i]));
+        if (m_readEvents[i])
+            CHECKSTATUS(clReleaseEvent(m_readEvents[i]));
+        if (m_pinnedFrames[i])
+            CHECKSTATUS(
+                clEnqueueUnmapMemObject(m_hTransferQueue, m_hPinnedFrames[i], m_pinnedFrames[i], 0, NULL, NULL));
+        m_colorizeEvents[i] = 0;
+        m_readEvents[i] = 0;
+        m_pinnedFrames[i] = 0;
     }
-    else
+    if (m_hTransferQueue)
+        CHECKSTATUS(clFinish(m_hTransferQueue));
+
+    for (int i(0); i < gFramesInFlight; ++i)
     {
-        source_str = (char *)malloc(MAX_SOURCE_SIZE);
-        length = fread(source_str, 1, MAX_SOURCE_SIZE, fp);
-        fclose(fp);
+        if (m_hPinnedFrames[i])
+            CHECKSTATUS(clReleaseMemObject(m_hPinnedFrames[i]));
+        if (m_hFrameBitmaps[i])
+            CHECKSTATUS(clReleaseMemObject(m_hFrameBitmaps[i]));
+        m_hPinnedFrames[i] = 0;
+        m_hFrameBitmaps[i] = 0;
     }
-    return source_str;
+    m_frameFirst = 0;
+    m_framesInFlight = 0;
+    m_acquiredFrame = -1;
 }
 
-// ---------- Kinect ----------
-long OpenCLKernel::addTexture(const std::string &filename)
+/*
+ * enqueueFrame
+ */
+bool OpenCLKernel::enqueueFrame(const unsigned int generations)
 {
-    FILE *filePtr(0);                  // our file pointer
-    BITMAPFILEHEADER bitmapFileHeader; // our bitmap file header
-    unsigned char *bitmapImage;        // store image data
-    BITMAPINFOHEADER bitmapInfoHeader;
-    DWORD imageIdx = 0;    // image index counter
-    unsigned char tempRGB; // our swap variable
+    // Every slot is either in flight or acquired
+    if (m_framesInFlight + ((m_acquiredFrame == -1) ? 0 : 1) >= gFramesInFlight)
+        return false;
 
-    // open filename in read binary mode
-    fopen_s(&filePtr, filename.c_str(), "rb");
-    if (filePtr == NULL)
-    {
-        return 1;
-    }
+    if (m_hFrameBitmaps[0] == 0)
+        initializeFrames();
 
-    // read the bitmap file header
-    fread(&bitmapFileHeader, sizeof(BITMAPFILEHEADER), 1, filePtr);
+    // The slot was released by acquireFrame(), its previous read back is complete
+    int slot = (m_frameFirst + m_framesInFlight) % gFramesInFlight;
+    enqueueGenerations(generations);
+    enqueueColorization(m_hFrameBitmaps[slot], &m_colorizeEvents[slot]);
+    CHECKSTATUS(clFlush(m_hQueue));
 
-    // verify that this is a bmp file by check bitmap id
-    if (bitmapFileHeader.bfType != 0x4D42)
+    CHECKSTATUS(clEnqueueReadBuffer(m_hTransferQueue, m_hFrameBitmaps[slot], CL_FALSE, 0,
+                                    m_width * m_height * sizeof(BYTE) * gColorDepth, m_pinnedFrames[slot], 1,
+                                    &m_colorizeEvents[slot], &m_readEvents[slot]));
+    CHECKSTATUS(clFlush(m_hTransferQueue));
+    if (m_profiler.isEnabled())
     {
-        fclose(filePtr);
-        return 1;
+        CHECKSTATUS(clRetainEvent(m_readEvents[slot]));
+        m_profiler.track(ps_readback, m_readEvents[slot]);
     }
 
-    // read the bitmap info header
-    fread(&bitmapInfoHeader, sizeof(BITMAPINFOHEADER), 1, filePtr);
+    ++m_framesInFlight;
+    return true;
+}
+
+/*
+ * acquireFrame
+ */
+const BYTE *OpenCLKernel::acquireFrame()
+{
+    releaseFrame();
+    if (m_framesInFlight == 0)
+        return 0;
+
+    // Oldest frame in flight
+    int slot = m_frameFirst;
+    CHECKSTATUS(clWaitForEvents(1, &m_readEvents[slot]));
+    CHECKSTATUS(clReleaseEvent(m_colorizeEvents[slot]));
+    CHECKSTATUS(clReleaseEvent(m_readEvents[slot]));
+    m_colorizeEvents[slot] = 0;
+    m_readEvents[slot] = 0;
+    m_profiler.collect(false);
+
+    m_acquiredFrame = slot;
+    m_frameFirst = (m_frameFirst + 1) % gFramesInFlight;
+    --m_framesInFlight;
+    return m_pinnedFrames[slot];
+}
 
-    // move file point to the begging of bitmap data
-    fseek(filePtr, bitmapFileHeader.bfOffBits, SEEK_SET);
+void OpenCLKernel::releaseFrame()
+{
+    m_acquiredFrame = -1;
+}
 
-    // allocate enough memory for the bitmap image data
-    bitmapImage = (unsigned char *)malloc(bitmapInfoHeader.biSizeImage);
+/*
+ * enqueueGenerations
+ */
+void OpenCLKernel::enqueueGenerations(const unsigned int generations)
+{
+    transferTextures();
 
-    // verify memory allocation
-    if (!bitmapImage)
+    if (m_storage == cs_chunked)
     {
-        free(bitmapImage);
-        fclose(filePtr);
-        return 1;
+        if (m_offset == -1)
+        {
+            // Seeded as the packed cells of the window, then split into chunks
+            std::vector<cl_uint> cells(m_wordsPerRow * m_height);
+            enqueuePackedInitialization();
+            CHECKSTATUS(clEnqueueReadBuffer(m_hQueue, m_hPackedBuffer, CL_TRUE, 0, cells.size() * sizeof(cl_uint),
+                                            &cells[0], 0, NULL, NULL));
+            loadChunks(cells);
+        }
+        enqueueChunkGenerations(generations);
+    }
+    else if (m_storage == cs_packed)
+    {
+        if (m_offset == -1)
+            enqueuePackedInitialization();
+        if (m_simulationKernel == sk_active)
+            enqueueActiveGenerations(generations);
+        else
+            enqueuePackedGenerations(generations);
+    }
+    else if (m_storage == cs_states)
+        enqueueStateGenerations(generations);
+    else
+    {
+        // Seeded by the kernel of the rule of range 1
+        if (m_offset == -1)
+            enqueueGeneration();
+        for (unsigned int i(0); i < generations; ++i)
+        {
+            if (m_rule.getRange() > 1)
+                enqueueLargerGeneration();
+            else
+                enqueueGeneration();
+        }
     }
+}
 
-    // read in the bitmap image data
-    fread(bitmapImage, bitmapInfoHeader.biSizeImage, 1, filePtr);
+/*
+ * enqueueColorization
+ */
+void OpenCLKernel::enqueueColorization(cl_mem bitmap, cl_event *event)
+{
+    // Chunks are first gathered into the packed cells of the window
+    bool packed = (m_storage == cs_packed || m_storage == cs_chunked);
+    cl_int offset = m_offset;
+    if (m_storage == cs_chunked)
+    {
+        enqueueChunkWindow();
+        offset = 0;
+    }
 
-    // make sure bitmap image data was read
-    if (bitmapImage == NULL)
+    cl_kernel kernel = packed ? m_hPackedColorizeKernel : m_hColorizeKernel;
+    cl_uint bitmapArgument = packed ? 3 : 2;
+    cl_uint offsetArgument = packed ? 6 : 4;
+    if (m_storage == cs_states)
     {
-        fclose(filePtr);
-        return NULL;
+        kernel = m_hStateColorizeKernel;
+        offsetArgument = 5;
+    }
+    size_t cellWorkSize[] = {static_cast<size_t>(m_width), static_cast<size_t>(m_height)};
+    cl_event profilingEvent(0);
+    CHECKSTATUS(clSetKernelArg(kernel, bitmapArgument, sizeof(cl_mem), (void *)&bitmap));
+    CHECKSTATUS(clSetKernelArg(kernel, offsetArgument, sizeof(cl_int), (void *)&offset));
+    CHECKSTATUS(clEnqueueNDRangeKernel(m_hQueue, kernel, 2, NULL, cellWorkSize, 0, 0, 0,
+                                       event ? event : m_profiler.event(profilingEvent)));
+
+    // The caller keeps its own reference to the event
+    if (event && *event && m_profiler.isEnabled())
+    {
+        CHECKSTATUS(clRetainEvent(*event));
+        profilingEvent = *event;
     }
+    m_profiler.track(ps_colorize, profilingEvent);
+}
+
+void OpenCLKernel::setLocalWorkSize(const int x, const int y)
+{
+    m_localWorkSize[0] = (x > 0 && y > 0) ? x : 0;
+    m_localWorkSize[1] = (x > 0 && y > 0) ? y : 0;
+}
+
+/*
+ * getLocalWorkSize
+ */
+size_t *OpenCLKernel::getLocalWorkSize(size_t *globalWorkSize)
+{
+    // Rounds the global work size up to whole work-groups, kernels ignoring the extra work-items
+    if (m_localWorkSize[0] == 0)
+        return NULL;
+    for (int i(0); i < 2; ++i)
+        globalWorkSize[i] = (globalWorkSize[i] + m_localWorkSize[i] - 1) / m_localWorkSize[i] * m_localWorkSize[i];
+    return m_localWorkSize;
+}
 
-    // swap the r and b values to get RGB (bitmap is BGR)
-    for (imageIdx = 0; imageIdx < bitmapInfoHeader.biSizeImage; imageIdx += 3)
+/*
+ * enqueueGeneration
+ */
+void OpenCLKernel::enqueueGeneration()
+{
+    // The tiled kernel runs one work-group per tile, the board being rounded up to whole tiles
+    cl_kernel kernel = (m_simulationKernel == sk_average) ? m_hAverageKernel : m_hMainKernel;
+    size_t globalWorkSize[] = {static_cast<size_t>(m_width), static_cast<size_t>(m_height)};
+    size_t tileWorkSize[] = {gTileWidth, gTileHeight};
+    size_t *localWorkSize = getLocalWorkSize(globalWorkSize);
+    if (m_simulationKernel == sk_tiled)
     {
-        tempRGB = bitmapImage[imageIdx];
-        bitmapImage[imageIdx] = bitmapImage[imageIdx + 2];
-        bitmapImage[imageIdx + 2] = tempRGB;
+        kernel = m_hTiledKernel;
+        globalWorkSize[0] = (m_width + gTileWidth - 1) / gTileWidth * gTileWidth;
+        globalWorkSize[1] = (m_height + gTileHeight - 1) / gTileHeight * gTileHeight;
+        localWorkSize = tileWorkSize;
     }
 
-    // close file and return bitmap image data
-    fclose(filePtr);
+    // The neighbors are read from the alive mask, averaging does not need it
+    if (m_offset != -1 && m_simulationKernel != sk_average)
+        enqueueAliveMask();
 
-    memcpy(m_textures, bitmapImage, bitmapInfoHeader.biSizeImage);
+    CHECKSTATUS(clSetKernelArg(kernel, 6, sizeof(cl_int), (void *)&m_offset));
+    CHECKSTATUS(clSetKernelArg(kernel, 7, sizeof(cl_float), (void *)&m_limit));
+    CHECKSTATUS(clSetKernelArg(kernel, 8, sizeof(cl_float), (void *)&m_timer));
+    cl_event event(0);
+    CHECKSTATUS(clEnqueueNDRangeKernel(m_hQueue, kernel, 2, NULL, globalWorkSize, localWorkSize, 0, 0,
+                                       m_profiler.event(event)));
+    m_profiler.track(ps_simulation, event);
+
+    if (m_offset == -1)
+        m_offset = 1;
+    m_offset = (m_offset == 0) ? 1 : 0;
+}
 
-    free(bitmapImage);
+/*
+ * enqueueAliveMask
+ */
+void OpenCLKernel::enqueueAliveMask()
+{
+    // Thresholds the current generation once, with the limit of this generation
+    size_t cellWorkSize[] = {static_cast<size_t>(m_width), static_cast<size_t>(m_height)};
+    cl_event event(0);
+    CHECKSTATUS(clSetKernelArg(m_hAliveKernel, 4, sizeof(cl_int), (void *)&m_offset));
+    CHECKSTATUS(clSetKernelArg(m_hAliveKernel, 5, sizeof(cl_float), (void *)&m_limit));
+    CHECKSTATUS(
+        clEnqueueNDRangeKernel(m_hQueue, m_hAliveKernel, 2, NULL, cellWorkSize, 0, 0, 0, m_profiler.event(event)));
+    m_profiler.track(ps_simulation, event);
+}
+
+/*
+ * enqueuePackedInitialization
+ */
+void OpenCLKernel::enqueuePackedInitialization()
+{
+    // Seed the first generation from the texture
+    size_t wordWorkSize[] = {static_cast<size_t>(m_wordsPerRow), static_cast<size_t>(m_height)};
+    cl_event event(0);
+    CHECKSTATUS(clSetKernelArg(m_hPackedInitKernel, 5, sizeof(cl_float), (void *)&m_limit));
+    CHECKSTATUS(
+        clEnqueueNDRangeKernel(m_hQueue, m_hPackedInitKernel, 2, NULL, wordWorkSize, 0, 0, 0, m_profiler.event(event)));
+    m_profiler.track(ps_simulation, event);
+    m_offset = 0;
+    m_activeFlagsValid = false;
+}
+
+/*
+ * enqueuePackedGenerations
+ */
+void OpenCLKernel::enqueuePackedGenerations(const unsigned int generations)
+{
+    // The changed flags of the active tiles are not maintained
+    if (generations > 0)
+        m_activeFlagsValid = false;
+
+    unsigned int remaining(generations);
+    while (remaining > 0)
+    {
+        cl_event event(0);
+        cl_int launchGenerations =
+            (remaining < static_cast<unsigned int>(m_generationsPerLaunch)) ? remaining : m_generationsPerLaunch;
+        if (launchGenerations == 1)
+        {
+            size_t wordWorkSize[] = {static_cast<size_t>(m_wordsPerRow), static_cast<size_t>(m_height)};
+            size_t *localWorkSize = getLocalWorkSize(wordWorkSize);
+            CHECKSTATUS(clSetKernelArg(m_hPackedKernel, 4, sizeof(cl_int), (void *)&m_offset));
+            CHECKSTATUS(clEnqueueNDRangeKernel(m_hQueue, m_hPackedKernel, 2, NULL, wordWorkSize, localWorkSize, 0, 0,
+                                               m_profiler.event(event)));
+        }
+        else
+        {
+            // One work-group per tile, looping over the rows of its tile and halo
+            size_t globalWorkSize[] = {
+                static_cast<size_t>((m_wordsPerRow + gTemporalWords - 1) / gTemporalWords * gTemporalWords),
+                static_cast<size_t>((m_height + gTemporalRows - 1) / gTemporalRows * gTemporalGroupRows)};
+            size_t localWorkSize[] = {gTemporalWords, gTemporalGroupRows};
+            CHECKSTATUS(clSetKernelArg(m_hPackedTemporalKernel, 4, sizeof(cl_int), (void *)&m_offset));
+            CHECKSTATUS(clSetKernelArg(m_hPackedTemporalKernel, 7, sizeof(cl_int), (void *)&launchGenerations));
+            CHECKSTATUS(clEnqueueNDRangeKernel(m_hQueue, m_hPackedTemporalKernel, 2, NULL, globalWorkSize,
+                                               localWorkSize, 0, 0, m_profiler.event(event)));
+        }
+        m_profiler.track(ps_simulation, event);
+        m_offset = (m_offset == 0) ? 1 : 0;
+        remaining -= launchGenerations;
+    }
+}
+
+/*
+ * enqueueActiveGenerations
+ */
+void OpenCLKernel::enqueueActiveGenerations(const unsigned int generations)
+{
+    cl_int tileCount = m_activeTilesPerRow * m_activeTileRows;
+    if (!m_activeFlagsValid)
+    {
+        // Every tile is active after seeding, loading or other kernels, the other generation being unknown
+        std::vector<cl_int> flags(2 * tileCount, 1);
+        cl_int counts[] = {0, 0};
+        CHECKSTATUS(clEnqueueWriteBuffer(m_hQueue, m_hActiveFlags, CL_TRUE, 0, flags.size() * sizeof(cl_int),
+                                         &flags[0], 0, NULL, NULL));
+        CHECKSTATUS(clEnqueueWriteBuffer(m_hQueue, m_hActiveCounts, CL_TRUE, 0, sizeof(counts), counts, 0, NULL,
+                                         NULL));
+        m_activeFlagsValid = true;
+    }
+
+    // One work-item per tile builds the list, then one work-group per tile of the list
+    size_t tileWorkSize[] = {static_cast<size_t>(tileCount)};
+    size_t globalWorkSize[] = {static_cast<size_t>(tileCount * gActiveWords), gActiveRows};
+    size_t localWorkSize[] = {gActiveWords, gActiveRows};
+    for (unsigned int i(0); i < generations; ++i)
+    {
+        cl_event event(0);
+        CHECKSTATUS(clSetKernelArg(m_hActiveTilesKernel, 5, sizeof(cl_int), (void *)&m_offset));
+        CHECKSTATUS(clEnqueueNDRangeKernel(m_hQueue, m_hActiveTilesKernel, 1, NULL, tileWorkSize, 0, 0, 0,
+                                           m_profiler.event(event)));
+        m_profiler.track(ps_simulation, event);
+
+        event = 0;
+        CHECKSTATUS(clSetKernelArg(m_hPackedActiveKernel, 4, sizeof(cl_int), (void *)&m_offset));
+        CHECKSTATUS(clEnqueueNDRangeKernel(m_hQueue, m_hPackedActiveKernel, 2, NULL, globalWorkSize, localWorkSize,
+                                           0, 0, m_profiler.event(event)));
+        m_profiler.track(ps_simulation, event);
+        m_offset = (m_offset == 0) ? 1 : 0;
+    }
+}
+
+/*
+ * enqueueStateGenerations
+ */
+void OpenCLKernel::enqueueStateGenerations(const unsigned int generations)
+{
+    // Seeded from the texture, then one launch per generation
+    size_t cellWorkSize[] = {static_cast<size_t>(m_width), static_cast<size_t>(m_height)};
+    if (m_offset == -1)
+    {
+        cl_event event(0);
+        CHECKSTATUS(clSetKernelArg(m_hStateInitKernel, 4, sizeof(cl_float), (void *)&m_limit));
+        CHECKSTATUS(clEnqueueNDRangeKernel(m_hQueue, m_hStateInitKernel, 2, NULL, cellWorkSize, 0, 0, 0,
+                                           m_profiler.event(event)));
+        m_profiler.track(ps_simulation, event);
+        m_offset = 0;
+    }
+
+    for (unsigned int i(0); i < generations; ++i)
+    {
+        size_t globalWorkSize[] = {cellWorkSize[0], cellWorkSize[1]};
+        size_t *localWorkSize = getLocalWorkSize(globalWorkSize);
+        cl_event event(0);
+        CHECKSTATUS(clSetKernelArg(m_hStateKernel, 3, sizeof(cl_int), (void *)&m_offset));
+        CHECKSTATUS(clEnqueueNDRangeKernel(m_hQueue, m_hStateKernel, 2, NULL, globalWorkSize, localWorkSize, 0, 0,
+                                           m_profiler.event(event)));
+        m_profiler.track(ps_simulation, event);
+        m_offset = (m_offset == 0) ? 1 : 0;
+    }
+}
+
+/*
+ * enqueueLargerGeneration
+ */
+void OpenCLKernel::enqueueLargerGeneration()
+{
+    // Summed-area table of the alive mask: one work-group scanning each row, then one work-item scanning each
+    // column, and one work-item per cell counting its square from the table
+    size_t rowWorkSize[] = {gSatGroupSize, static_cast<size_t>(m_height)};
+    size_t rowGroupSize[] = {gSatGroupSize, 1};
+    size_t columnWorkSize[] = {static_cast<size_t>(m_width)};
+    size_t cellWorkSize[] = {static_cast<size_t>(m_width), static_cast<size_t>(m_height)};
+    size_t *localWorkSize = getLocalWorkSize(cellWorkSize);
+
+    enqueueAliveMask();
+    cl_event event(0);
+    CHECKSTATUS(clEnqueueNDRangeKernel(m_hQueue, m_hSatRowsKernel, 2, NULL, rowWorkSize, rowGroupSize, 0, 0,
+                                       m_profiler.event(event)));
+    m_profiler.track(ps_simulation, event);
+
+    event = 0;
+    CHECKSTATUS(clEnqueueNDRangeKernel(m_hQueue, m_hSatColumnsKernel, 1, NULL, columnWorkSize, 0, 0, 0,
+                                       m_profiler.event(event)));
+    m_profiler.track(ps_simulation, event);
+
+    event = 0;
+    CHECKSTATUS(clSetKernelArg(m_hLargerKernel, 5, sizeof(cl_int), (void *)&m_offset));
+    CHECKSTATUS(clEnqueueNDRangeKernel(m_hQueue, m_hLargerKernel, 2, NULL, cellWorkSize, localWorkSize, 0, 0,
+                                       m_profiler.event(event)));
+    m_profiler.track(ps_simulation, event);
+    m_offset = (m_offset == 0) ? 1 : 0;
+}
+
+int OpenCLKernel::getActiveTiles()
+{
+    if (!m_activeFlagsValid || m_hActiveCounts == 0)
+        return -1;
+
+    // The list of the last generation, the other one being reset for the next generation
+    cl_int count(0);
+    CHECKSTATUS(clEnqueueReadBuffer(m_hQueue, m_hActiveCounts, CL_TRUE, (1 - m_offset) * sizeof(cl_int),
+                                    sizeof(cl_int), &count, 0, NULL, NULL));
+    return count;
+}
+
+// ---------- Chunks ----------
+/*
+ * Chunk coordinates, as keys of the chunk map
+ */
+static long long chunkKey(const cl_int x, const cl_int y)
+{
+    return (static_cast<long long>(y) << 32) | static_cast<unsigned int>(x);
+}
+
+static cl_int chunkX(const long long key)
+{
+    return static_cast<cl_int>(key & 0xFFFFFFFFLL);
+}
+
+static cl_int chunkY(const long long key)
+{
+    return static_cast<cl_int>(key >> 32);
+}
+
+/*
+ * chunkSummary
+ */
+static cl_uint chunkSummary(const cl_uint *words)
+{
+    // Same bits as chunk_kernel: neighbors touched by alive cells, row by row, bit 4 for the chunk itself
+    cl_uint summary(0);
+    for (int y(0); y < gChunkSize; ++y)
+        for (int x(0); x < gChunkWords; ++x)
+        {
+            cl_uint word = words[y * gChunkWords + x];
+            if (word == 0)
+                continue;
+            bool north = (y == 0);
+            bool south = (y == gChunkSize - 1);
+            bool west = (x == 0 && (word & 1u) != 0);
+            bool east = (x == gChunkWords - 1 && (word >> 31) != 0);
+            summary |= 1u << 4;
+            summary |= (north ? 1u << 1 : 0) | (south ? 1u << 7 : 0) | (west ? 1u << 3 : 0) | (east ? 1u << 5 : 0);
+            summary |= (north && west ? 1u << 0 : 0) | (north && east ? 1u << 2 : 0);
+            summary |= (south && west ? 1u << 6 : 0) | (south && east ? 1u << 8 : 0);
+        }
+    return summary;
+}
+
+/*
+ * growChunks
+ */
+void OpenCLKernel::growChunks(const cl_int capacity)
+{
+    // Slots of two generations, the slots in use being copied to the new buffer
+    int status(0);
+    size_t slotBytes = 2 * gChunkWords * gChunkSize * sizeof(cl_uint);
+    cl_mem chunks = clCreateBuffer(m_hContext, CL_MEM_READ_WRITE, capacity * slotBytes, 0, &status);
+    CHECKSTATUS(status);
+    if (m_hChunks)
+    {
+        if (m_chunkSlots > 0)
+            CHECKSTATUS(
+                clEnqueueCopyBuffer(m_hQueue, m_hChunks, chunks, 0, 0, m_chunkSlots * slotBytes, 0, NULL, NULL));
+        CHECKSTATUS(clReleaseMemObject(m_hChunks));
+    }
+    if (m_hChunkNeighbors)
+        CHECKSTATUS(clReleaseMemObject(m_hChunkNeighbors));
+    if (m_hChunkSummaries)
+        CHECKSTATUS(clReleaseMemObject(m_hChunkSummaries));
+
+    m_hChunks = chunks;
+    m_hChunkNeighbors = clCreateBuffer(m_hContext, CL_MEM_READ_ONLY, capacity * 9 * sizeof(cl_int), 0, &status);
+    CHECKSTATUS(status);
+    m_hChunkSummaries = clCreateBuffer(m_hContext, CL_MEM_WRITE_ONLY, capacity * sizeof(cl_uint), 0, &status);
+    CHECKSTATUS(status);
+    m_chunkCapacity = capacity;
+    m_chunkTablesValid = false;
+    setKernelArguments();
+}
+
+/*
+ * allocateChunk
+ */
+cl_int OpenCLKernel::allocateChunk(const long long key)
+{
+    cl_int slot(0);
+    if (!m_freeChunks.empty())
+    {
+        slot = m_freeChunks.back();
+        m_freeChunks.pop_back();
+    }
+    else
+    {
+        if (m_chunkSlots == m_chunkCapacity)
+            growChunks(2 * m_chunkCapacity);
+        slot = m_chunkSlots++;
+    }
+    m_chunks[key] = slot;
+    m_chunkTablesValid = false;
+    return slot;
+}
+
+/*
+ * updateChunks
+ */
+void OpenCLKernel::updateChunks(const std::vector<long long> &keys, const std::vector<cl_uint> &summaries)
+{
+    // Empty chunks are freed
+    for (size_t i(0); i < keys.size(); ++i)
+    {
+        if (summaries[i] != 0)
+            continue;
+        std::unordered_map<long long, cl_int>::iterator it = m_chunks.find(keys[i]);
+        m_freeChunks.push_back(it->second);
+        m_chunks.erase(it);
+        m_chunkTablesValid = false;
+    }
+
+    // Chunks touched by alive cells are created empty, in the current generation
+    size_t chunkBytes = gChunkWords * gChunkSize * sizeof(cl_uint);
+    for (size_t i(0); i < keys.size(); ++i)
+        for (int n(0); n < 9; ++n)
+        {
+            if (n == 4 || ((summaries[i] >> n) & 1) == 0)
+                continue;
+            long long key = chunkKey(chunkX(keys[i]) + n % 3 - 1, chunkY(keys[i]) + n / 3 - 1);
+            if (m_chunks.find(key) != m_chunks.end())
+                continue;
+            cl_int slot = allocateChunk(key);
+            CHECKSTATUS(clEnqueueWriteBuffer(m_hQueue, m_hChunks, CL_FALSE, (slot * 2 + m_offset) * chunkBytes,
+                                             chunkBytes, &m_chunkZeros[0], 0, NULL, NULL));
+        }
+}
+
+/*
+ * uploadChunkTables
+ */
+void OpenCLKernel::uploadChunkTables()
+{
+    if (m_chunkTablesValid)
+        return;
+
+    // Batch of every chunk, with the slots of its 3x3 neighborhood, missing chunks being -1
+    std::vector<cl_int> neighbors;
+    m_chunkBatch.clear();
+    for (std::unordered_map<long long, cl_int>::const_iterator it = m_chunks.begin(); it != m_chunks.end(); ++it)
+    {
+        m_chunkBatch.push_back(it->first);
+        for (int n(0); n < 9; ++n)
+        {
+            std::unordered_map<long long, cl_int>::const_iterator neighbor =
+                m_chunks.find(chunkKey(chunkX(it->first) + n % 3 - 1, chunkY(it->first) + n / 3 - 1));
+            neighbors.push_back((neighbor == m_chunks.end()) ? -1 : neighbor->second);
+        }
+    }
+
+    // Slots of the chunks of the window
+    int chunksPerRow = (m_width + gChunkSize - 1) / gChunkSize;
+    int chunkRows = (m_height + gChunkSize - 1) / gChunkSize;
+    std::vector<cl_int> windowSlots(chunksPerRow * chunkRows, -1);
+    for (int y(0); y < chunkRows; ++y)
+        for (int x(0); x < chunksPerRow; ++x)
+        {
+            std::unordered_map<long long, cl_int>::const_iterator it = m_chunks.find(chunkKey(x, y));
+            if (it != m_chunks.end())
+                windowSlots[y * chunksPerRow + x] = it->second;
+        }
+
+    if (!neighbors.empty())
+        CHECKSTATUS(clEnqueueWriteBuffer(m_hQueue, m_hChunkNeighbors, CL_TRUE, 0, neighbors.size() * sizeof(cl_int),
+                                         &neighbors[0], 0, NULL, NULL));
+    CHECKSTATUS(clEnqueueWriteBuffer(m_hQueue, m_hWindowSlots, CL_TRUE, 0, windowSlots.size() * sizeof(cl_int),
+                                     &windowSlots[0], 0, NULL, NULL));
+    m_chunkTablesValid = true;
+}
+
+/*
+ * loadChunks
+ */
+void OpenCLKernel::loadChunks(const std::vector<cl_uint> &cells)
+{
+    // Chunks of the window having alive cells, in the first generation of their slots
+    m_offset = 0;
+    m_chunks.clear();
+    m_freeChunks.clear();
+    m_chunkSlots = 0;
+    m_chunkTablesValid = false;
+
+    std::vector<long long> keys;
+    std::vector<cl_uint> summaries;
+    std::vector<cl_uint> words(gChunkWords * gChunkSize);
+    size_t chunkBytes = words.size() * sizeof(cl_uint);
+    for (int cy(0); cy * gChunkSize < m_height; ++cy)
+        for (int cx(0); cx * gChunkWords < m_wordsPerRow; ++cx)
+        {
+            for (int y(0); y < gChunkSize; ++y)
+                for (int x(0); x < gChunkWords; ++x)
+                {
+                    int column = cx * gChunkWords + x;
+                    int row = cy * gChunkSize + y;
+                    words[y * gChunkWords + x] =
+                        (column < m_wordsPerRow && row < m_height) ? cells[row * m_wordsPerRow + column] : 0;
+                }
+            cl_uint summary = chunkSummary(&words[0]);
+            if (summary == 0)
+                continue;
+            cl_int slot = allocateChunk(chunkKey(cx, cy));
+            CHECKSTATUS(clEnqueueWriteBuffer(m_hQueue, m_hChunks, CL_TRUE, slot * 2 * chunkBytes, chunkBytes,
+                                             &words[0], 0, NULL, NULL));
+            keys.push_back(chunkKey(cx, cy));
+            summaries.push_back(summary);
+        }
+
+    // Neighbors touched by the alive cells
+    updateChunks(keys, summaries);
+}
+
+/*
+ * enqueueChunkGenerations
+ */
+void OpenCLKernel::enqueueChunkGenerations(const unsigned int generations)
+{
+    // One work-group per chunk of the batch. The summaries are read back after every generation, so that the
+    // next batch only holds the chunks the pattern reaches
+    std::vector<cl_uint> summaries;
+    for (unsigned int i(0); i < generations; ++i)
+    {
+        // An empty board stays empty
+        if (m_chunks.empty())
+            break;
+
+        uploadChunkTables();
+        size_t globalWorkSize[] = {gChunkWords, gChunkSize, m_chunkBatch.size()};
+        size_t localWorkSize[] = {gChunkWords, gChunkSize, 1};
+        cl_event event(0);
+        CHECKSTATUS(clSetKernelArg(m_hChunkKernel, 3, sizeof(cl_int), (void *)&m_offset));
+        CHECKSTATUS(clEnqueueNDRangeKernel(m_hQueue, m_hChunkKernel, 3, NULL, globalWorkSize, localWorkSize, 0, 0,
+                                           m_profiler.event(event)));
+        m_profiler.track(ps_simulation, event);
+
+        event = 0;
+        summaries.resize(m_chunkBatch.size());
+        CHECKSTATUS(clEnqueueReadBuffer(m_hQueue, m_hChunkSummaries, CL_TRUE, 0, summaries.size() * sizeof(cl_uint),
+                                        &summaries[0], 0, NULL, m_profiler.event(event)));
+        m_profiler.track(ps_simulation, event);
+
+        m_offset = (m_offset == 0) ? 1 : 0;
+        updateChunks(m_chunkBatch, summaries);
+    }
+}
+
+/*
+ * enqueueChunkWindow
+ */
+void OpenCLKernel::enqueueChunkWindow()
+{
+    // Packed cells of the window, in the first generation of the packed buffer
+    uploadChunkTables();
+    size_t wordWorkSize[] = {static_cast<size_t>(m_wordsPerRow), static_cast<size_t>(m_height)};
+    cl_int offset = (m_offset == -1) ? 0 : m_offset;
+    cl_event event(0);
+    CHECKSTATUS(clSetKernelArg(m_hChunkWindowKernel, 6, sizeof(cl_int), (void *)&offset));
+    CHECKSTATUS(clEnqueueNDRangeKernel(m_hQueue, m_hChunkWindowKernel, 2, NULL, wordWorkSize, 0, 0, 0,
+                                       m_profiler.event(event)));
+    m_profiler.track(ps_colorize, event);
+}
+
+// ---------- Rules ----------
+bool OpenCLKernel::setRule(const cl_uint birth, const cl_uint survival)
+{
+    return setRule(Rule(birth, survival));
+}
+
+bool OpenCLKernel::setRule(const Rule &rule)
+{
+    bool packed = (m_storage == cs_packed || m_storage == cs_chunked);
+    if ((packed && !rule.isLifeLike()) || (m_storage == cs_float4 && rule.getStates() > 2) ||
+        (m_storage != cs_float4 && rule.getRange() > 1))
+    {
+        LOG_ERROR("Rule " << rule.getName() << " is not supported by the cell storage\n");
+        return false;
+    }
+
+    // Kernel arguments of a totalistic rule, for kernels built without it
+    m_rule = rule;
+    m_ruleOptions = rule.getBuildOptions();
+    m_birth = rule.getBirth();
+    m_survival = rule.getSurvival();
+    if (!m_kernelSource.empty())
+        buildKernels();
+    return true;
+}
+
+// ---------- State ----------
+void OpenCLKernel::loadState(const std::vector<cl_uint> &cells)
+{
+    if (cells.size() != static_cast<size_t>(m_wordsPerRow * m_height))
+    {
+        LOG_ERROR("Invalid state size\n");
+        return;
+    }
+
+    // The state becomes the current generation, in the first half of the cells
+    transferTextures();
+    if (m_storage == cs_chunked)
+        loadChunks(cells);
+    else if (m_storage == cs_packed)
+    {
+        CHECKSTATUS(clEnqueueWriteBuffer(m_hQueue, m_hPackedBuffer, CL_TRUE, 0, cells.size() * sizeof(cl_uint),
+                                         &cells[0], 0, NULL, NULL));
+        m_activeFlagsValid = false;
+    }
+    else if (m_storage == cs_states)
+    {
+        // Dead cells were never alive
+        std::vector<cl_ushort> states(m_width * m_height);
+        for (int y(0); y < m_height; ++y)
+            for (int x(0); x < m_width; ++x)
+            {
+                bool alive(((cells[y * m_wordsPerRow + x / gPackedWordBits] >> (x % gPackedWordBits)) & 1) != 0);
+                states[y * m_width + x] = alive ? 1 : gStateMaxAge << 8;
+            }
+        CHECKSTATUS(clEnqueueWriteBuffer(m_hQueue, m_hStateBuffer, CL_TRUE, 0, states.size() * sizeof(cl_ushort),
+                                         &states[0], 0, NULL, NULL));
+    }
+    else
+    {
+        cl_float4 alive = {{0.f, 0.f, 0.f, 0.f}};
+        cl_float4 dead = {{1.f, 1.f, 1.f, 1.f}};
+        std::vector<cl_float4> colors(m_width * m_height);
+        for (int y(0); y < m_height; ++y)
+            for (int x(0); x < m_width; ++x)
+                colors[y * m_width + x] =
+                    ((cells[y * m_wordsPerRow + x / gPackedWordBits] >> (x % gPackedWordBits)) & 1) ? alive : dead;
+        // Into both generations, as border cells are never updated
+        for (int generation(0); generation < 2; ++generation)
+            CHECKSTATUS(clEnqueueWriteBuffer(m_hQueue, m_hBuffer, CL_TRUE,
+                                             generation * colors.size() * sizeof(cl_float4),
+                                             colors.size() * sizeof(cl_float4), &colors[0], 0, NULL, NULL));
+    }
+    m_offset = 0;
+}
+
+void OpenCLKernel::saveState(std::vector<cl_uint> &cells)
+{
+    // Seeds the board when no generation was computed yet
+    if (m_offset == -1)
+        step(0);
+
+    cells.assign(m_wordsPerRow * m_height, 0);
+    if (m_storage == cs_chunked)
+    {
+        enqueueChunkWindow();
+        CHECKSTATUS(clEnqueueReadBuffer(m_hQueue, m_hPackedBuffer, CL_TRUE, 0, cells.size() * sizeof(cl_uint),
+                                        &cells[0], 0, NULL, NULL));
+    }
+    else if (m_storage == cs_packed)
+    {
+        CHECKSTATUS(clEnqueueReadBuffer(m_hQueue, m_hPackedBuffer, CL_TRUE,
+                                        m_offset * cells.size() * sizeof(cl_uint), cells.size() * sizeof(cl_uint),
+                                        &cells[0], 0, NULL, NULL));
+    }
+    else if (m_storage == cs_states)
+    {
+        // Dying cells are not alive
+        std::vector<cl_ushort> states(m_width * m_height);
+        CHECKSTATUS(clEnqueueReadBuffer(m_hQueue, m_hStateBuffer, CL_TRUE,
+                                        m_offset * states.size() * sizeof(cl_ushort), states.size() * sizeof(cl_ushort),
+                                        &states[0], 0, NULL, NULL));
+        for (int y(0); y < m_height; ++y)
+            for (int x(0); x < m_width; ++x)
+                if ((states[y * m_width + x] & 0xFF) == 1)
+                    cells[y * m_wordsPerRow + x / gPackedWordBits] |= 1u << (x % gPackedWordBits);
+    }
+    else
+    {
+        std::vector<cl_float4> colors(m_width * m_height);
+        CHECKSTATUS(clEnqueueReadBuffer(m_hQueue, m_hBuffer, CL_TRUE, m_offset * colors.size() * sizeof(cl_float4),
+                                        colors.size() * sizeof(cl_float4), &colors[0], 0, NULL, NULL));
+        for (int y(0); y < m_height; ++y)
+            for (int x(0); x < m_width; ++x)
+            {
+                const cl_float4 &color = colors[y * m_width + x];
+                if ((color.s[0] + color.s[1] + color.s[2]) / 3.f <= m_limit)
+                    cells[y * m_wordsPerRow + x / gPackedWordBits] |= 1u << (x % gPackedWordBits);
+            }
+    }
+}
+
+// ---------- Snapshots ----------
+bool OpenCLKernel::enqueueSnapshot()
+{
+    if (m_snapshotPending)
+        return false;
+
+    // The snapshot records the rule as birth and survival masks, and alive cells only
+    if (!m_rule.isLifeLike() || !isRuleBuilt())
+    {
+        LOG_ERROR("Rule " << m_rule.getName() << " cannot be recorded by a snapshot\n");
+        return false;
+    }
+
+    if (m_storage != cs_packed && m_storage != cs_states)
+        saveState(m_snapshotCells);
+    else
+    {
+        // Seeds the board when no generation was computed yet
+        if (m_offset == -1)
+            step(0);
+
+        // The copy follows the generations enqueued so far, the read back waits for it on the transfer queue
+        size_t size(0);
+        cl_mem source(0);
+        void *destination(0);
+        if (m_storage == cs_packed)
+        {
+            size = m_wordsPerRow * m_height * sizeof(cl_uint);
+            source = m_hPackedBuffer;
+            m_snapshotCells.resize(m_wordsPerRow * m_height);
+            destination = &m_snapshotCells[0];
+        }
+        else
+        {
+            size = m_width * m_height * sizeof(cl_ushort);
+            source = m_hStateBuffer;
+            m_snapshotStates.resize(m_width * m_height);
+            destination = &m_snapshotStates[0];
+        }
+        cl_event copyEvent(0);
+        CHECKSTATUS(
+            clEnqueueCopyBuffer(m_hQueue, source, m_hSnapshotBuffer, m_offset * size, 0, size, 0, NULL, &copyEvent));
+        CHECKSTATUS(clFlush(m_hQueue));
+        CHECKSTATUS(clEnqueueReadBuffer(m_hTransferQueue, m_hSnapshotBuffer, CL_FALSE, 0, size, destination, 1,
+                                        &copyEvent, &m_snapshotEvent));
+        CHECKSTATUS(clFlush(m_hTransferQueue));
+        CHECKSTATUS(clReleaseEvent(copyEvent));
+        if (m_profiler.isEnabled())
+        {
+            CHECKSTATUS(clRetainEvent(m_snapshotEvent));
+            m_profiler.track(ps_readback, m_snapshotEvent);
+        }
+    }
+    m_snapshotPending = true;
+    return true;
+}
+
+/*
+ * isRuleBuilt
+ */
+bool OpenCLKernel::isRuleBuilt()
+{
+    // Kernels built from the rule, and not from a ptx file or before the rule was set
+    return !m_builtRuleOptions.empty() && m_builtRuleOptions == m_rule.getBuildOptions();
+}
+
+void OpenCLKernel::acquireSnapshot(std::vector<cl_uint> &cells)
+{
+    if (!m_snapshotPending)
+    {
+        cells.clear();
+        return;
+    }
+    if (m_snapshotEvent)
+    {
+        CHECKSTATUS(clWaitForEvents(1, &m_snapshotEvent));
+        CHECKSTATUS(clReleaseEvent(m_snapshotEvent));
+        m_snapshotEvent = 0;
+    }
+    if (!m_snapshotStates.empty())
+    {
+        // Alive cells of the states read back, the rule having no dying state
+        m_snapshotCells.assign(m_wordsPerRow * m_height, 0);
+        for (int y(0); y < m_height; ++y)
+            for (int x(0); x < m_width; ++x)
+                if ((m_snapshotStates[y * m_width + x] & 0xFF) == 1)
+                    m_snapshotCells[y * m_wordsPerRow + x / gPackedWordBits] |= 1u << (x % gPackedWordBits);
+        m_snapshotStates.clear();
+    }
+    cells.swap(m_snapshotCells);
+    m_snapshotCells.clear();
+    m_snapshotPending = false;
+}
+
+bool OpenCLKernel::loadSnapshot(const Snapshot &snapshot)
+{
+    const SnapshotInfo &info = snapshot.getInfo();
+    if (info.width != m_width || info.height != m_height)
+    {
+        LOG_ERROR("The snapshot of " << info.width << "x" << info.height << " cells does not fit the board\n");
+        return false;
+    }
+
+    // The board goes on with the rule of the snapshot
+    if (!m_rule.isLifeLike() || m_rule.getBirth() != info.birth || m_rule.getSurvival() != info.survival ||
+        !isRuleBuilt())
+    {
+        if (!setRule(Rule(info.birth, info.survival)))
+            return false;
+    }
+    if (!isRuleBuilt())
+    {
+        LOG_ERROR("The kernels do not run rule " << m_rule.getName() << " of the snapshot\n");
+        return false;
+    }
+    if (m_storage != cs_packed)
+    {
+        std::vector<cl_uint> cells;
+        if (!snapshot.load(cells))
+            return false;
+        loadState(cells);
+        return true;
+    }
+
+    // Tiles into the first half of the cells, decoded ones through a staging tile
+    transferTextures();
+    size_t rowPitch = m_wordsPerRow * sizeof(cl_uint);
+    std::vector<cl_uint> staging(gSnapshotTileWords * gSnapshotTileRows);
+    for (size_t i(0); i < snapshot.getTileCount(); ++i)
+    {
+        int word(0);
+        int row(0);
+        int words(0);
+        int rows(0);
+        snapshot.getTileBounds(i, word, row, words, rows);
+        const cl_uint *tile = snapshot.getPackedTile(i);
+        if (!tile)
+        {
+            staging.resize(words * rows);
+            if (!snapshot.decodeTile(i, &staging[0], words))
+            {
+                LOG_ERROR("Tile " << i << " of the snapshot is corrupted\n");
+                return false;
+            }
+            tile = &staging[0];
+        }
+        size_t bufferOrigin[3] = {word * sizeof(cl_uint), static_cast<size_t>(row), 0};
+        size_t hostOrigin[3] = {0, 0, 0};
+        size_t region[3] = {words * sizeof(cl_uint), static_cast<size_t>(rows), 1};
+        CHECKSTATUS(clEnqueueWriteBufferRect(m_hQueue, m_hPackedBuffer, CL_FALSE, bufferOrigin, hostOrigin, region,
+                                             rowPitch, 0, words * sizeof(cl_uint), 0, tile, 0, NULL, NULL));
+
+        // The staging tile is reused by the next decoded tile
+        if (tile == &staging[0])
+            CHECKSTATUS(clFinish(m_hQueue));
+    }
+    CHECKSTATUS(clFinish(m_hQueue));
+    m_activeFlagsValid = false;
+    m_offset = 0;
+    return true;
+}
+
+// ---------- Patterns ----------
+bool OpenCLKernel::loadPattern(const Pattern &pattern)
+{
+    if (m_storage != cs_packed && m_storage != cs_states)
+    {
+        std::vector<cl_uint> cells;
+        if (!pattern.load(m_width, m_height, cells))
+            return false;
+        loadState(cells);
+        return true;
+    }
+
+    // Dead cells in the first half of the cells, then the alive words of the pattern
+    transferTextures();
+    if (m_storage == cs_packed)
+    {
+        cl_uint dead(0);
+        CHECKSTATUS(clEnqueueFillBuffer(m_hQueue, m_hPackedBuffer, &dead, sizeof(dead), 0,
+                                        m_wordsPerRow * m_height * sizeof(cl_uint), 0, NULL, NULL));
+    }
+    else
+    {
+        // Dead cells were never alive
+        cl_ushort dead(gStateMaxAge << 8);
+        CHECKSTATUS(clEnqueueFillBuffer(m_hQueue, m_hStateBuffer, &dead, sizeof(dead), 0,
+                                        m_width * m_height * sizeof(cl_ushort), 0, NULL, NULL));
+    }
+    bool loaded = pattern.scan(m_width, m_height, [this](const std::vector<cl_uint> &words) { enqueueScatter(words); });
+    CHECKSTATUS(clFinish(m_hQueue));
+    m_activeFlagsValid = false;
+    m_offset = 0;
+    return loaded;
+}
+
+/*
+ * enqueueScatter
+ */
+void OpenCLKernel::enqueueScatter(const std::vector<cl_uint> &words)
+{
+    // The write waits for the previous scatter, and the batch can be refilled once it returns
+    cl_int count = static_cast<cl_int>(words.size() / 2);
+    size_t wordWorkSize[] = {static_cast<size_t>(count)};
+    cl_event event(0);
+    CHECKSTATUS(clEnqueueWriteBuffer(m_hQueue, m_hScatterBuffer, CL_TRUE, 0, words.size() * sizeof(cl_uint), &words[0],
+                                     0, NULL, m_profiler.event(event)));
+    m_profiler.track(ps_upload, event);
+    cl_kernel kernel = (m_storage == cs_packed) ? m_hPackedScatterKernel : m_hStateScatterKernel;
+    cl_uint countIndex = (m_storage == cs_packed) ? 2 : 4;
+    CHECKSTATUS(clSetKernelArg(kernel, countIndex, sizeof(cl_int), (void *)&count));
+    CHECKSTATUS(clEnqueueNDRangeKernel(m_hQueue, kernel, 1, NULL, wordWorkSize, 0, 0, 0, m_profiler.event(event)));
+    m_profiler.track(ps_simulation, event);
+    CHECKSTATUS(clFlush(m_hQueue));
+}
+
+/*
+ *
+ */
+OpenCLKernel::~OpenCLKernel()
+{
+    // Clean up
+    releaseDevice();
+}
+
+// ---------- Textures ----------
+void OpenCLKernel::setTexture(int index, BYTE *texture)
+{
+    // BGRA into opaque RGBA texels
+    BYTE *idx = m_textures + index * gTextureWidth * gTextureHeight * gColorDepth;
+    for (int i(0); i < gTextureWidth * gTextureHeight * gColorDepth; i += gColorDepth)
+    {
+        idx[i] = texture[i + 2];
+        idx[i + 1] = texture[i + 1];
+        idx[i + 2] = texture[i];
+        idx[i + 3] = 255;
+    }
+}
+
+/*
+ *
+ */
+char *OpenCLKernel::loadFromFile(const std::string &filename, size_t &length)
+{
+    // Load the kernel source code into the array source_str
+    FILE *fp = 0;
+    char *source_str = 0;
+
+    fp = fopen(filename.c_str(), "r");
+    if (fp == 0)
+    {
+        std::cout << "Failed to load kernel " << filename.c_str() << std::endl;
+    }
+    else
+    {
+        source_str = (char *)malloc(MAX_SOURCE_SIZE);
+        length = fread(source_str, 1, MAX_SOURCE_SIZE, fp);
+        fclose(fp);
+    }
+    return source_str;
+}
+
+// ---------- Kinect ----------
+// Little-endian field of a file
+static cl_uint readLittleEndian(const BYTE *data, const int bytes)
+{
+    cl_uint value(0);
+    for (int i(bytes - 1); i >= 0; --i)
+        value = (value << 8) | data[i];
+    return value;
+}
+
+long OpenCLKernel::addTexture(const std::string &filename)
+{
+    // Bitmap file and info headers, read field by field whatever the platform
+    MappedFile file;
+    if (!file.open(filename))
+        return 1;
+    const BYTE *data = file.getData();
+    if (file.getSize() < 54 || readLittleEndian(data, 2) != 0x4D42)
+        return 1;
+    size_t offset = readLittleEndian(data + 10, 4);
+    size_t imageSize = readLittleEndian(data + 34, 4);
+    if (offset > file.getSize())
+        return 1;
+    if (imageSize == 0 || imageSize > file.getSize() - offset)
+        imageSize = file.getSize() - offset;
+
+    // BGR pixels into opaque RGBA texels
+    const BYTE *pixel = data + offset;
+    size_t texels = std::min(imageSize / 3, static_cast<size_t>(gTextureWidth * gTextureHeight));
+    for (size_t i(0); i < texels; ++i, pixel += 3)
+    {
+        BYTE *texel = m_textures + i * gColorDepth;
+        texel[0] = pixel[2];
+        texel[1] = pixel[1];
+        texel[2] = pixel[0];
+        texel[3] = 255;
+    }
     return 1;
 }
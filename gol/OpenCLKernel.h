@@ -24,14 +24,54 @@
 #include <CL/opencl.h>
 
 #include "DLL_API.h"
+#include "OpenCLProfiler.h"
+#include "Pattern.h"
+#include "ProgramCache.h"
+#include "Rule.h"
+#include "SimulationEngine.h"
+#include "Snapshot.h"
+#include <map>
 #include <stdio.h>
 #include <string>
-#include <windows.h>
+#include <unordered_map>
+#include <vector>
 
-const int gTextureWidth = 1920;
-const int gTextureHeight = 1200;
-const int gTextureDepth = 3;
-const int gColorDepth = 4;
+// Work-group tile of the tiled kernel
+const int gTileWidth = 16;
+const int gTileHeight = 8;
+
+// Temporal blocking of packed cells: tile of words advanced by several generations per launch
+const int gTemporalWords = 8;
+const int gTemporalRows = 32;
+const int gTemporalGroupRows = 16;
+const int gTemporalMaxGenerations = 8;
+
+// Active tiles of packed cells: tile of words skipped while it and its neighbors do not change
+const int gActiveWords = 8;
+const int gActiveRows = 32;
+
+// Chunks of the unbounded board: side in cells, a multiple of gPackedWordBits, and slots allocated at first
+const int gChunkSize = 64;
+const int gChunkWords = gChunkSize / gPackedWordBits;
+const int gChunkInitialCapacity = 256;
+
+// Cells of the cs_states storage: state in the low byte, generations since the cell was last alive in the high
+// byte, up to gStateMaxAge
+const int gStateMaxAge = 255;
+
+// Work-group of the row scan of the summed-area table of Larger than Life rules
+const int gSatGroupSize = 128;
+
+// Frames being computed, read back or displayed at the same time
+const int gFramesInFlight = 3;
+
+enum SimulationKernel
+{
+    sk_gameOfLife, // One work-item per cell, neighbors read from global memory
+    sk_tiled,      // Work-group tile and its halo staged in local memory
+    sk_average,    // Average color of the neighbors
+    sk_active      // Packed cells: only the tiles that changed, or whose neighbors changed, are advanced
+};
 
 enum KernelSourceType
 {
@@ -96,15 +136,17 @@ struct Lamp
     cl_float4 color;
 };
 
-class GOL_API OpenCLKernel
+class GOL_API OpenCLKernel : public SimulationEngine
 {
 public:
     OpenCLKernel(int platformId, int device, int nbWorkingItems, int draft);
-    ~OpenCLKernel();
+    // Engine of a device, or sub-device, that the caller keeps alive
+    OpenCLKernel(cl_device_id device);
+    virtual ~OpenCLKernel();
 
 public:
     // ---------- Devices ----------
-    void initializeDevice(int width, int height);
+    virtual void initializeDevice(int width, int height, const CellStorage storage = cs_float4);
     void releaseDevice();
 
     void compileKernels(const KernelSourceType sourceType, const std::string &source, const std::string &ptxFileName,
@@ -112,11 +154,87 @@ public:
 
 public:
     // ---------- Rendering ----------
+    // Advances one generation and reads the resulting frame back, the first call only seeding the board
     void render(const unsigned int width, const unsigned int height, BYTE *bitmap, const float value);
 
+    // Advances the board by the given number of generations, the cells staying on the device. Packed cells
+    // are advanced by up to getGenerationsPerLaunch() generations per kernel launch
+    virtual void step(const unsigned int generations);
+
+    // Produces a frame of the current generation on the device
+    void colorize();
+    // Produces a frame of the current generation and reads it back into bitmap (width*height*gColorDepth)
+    virtual void readback(BYTE *bitmap);
+
+    // ---------- Frame pipeline ----------
+    // Asynchronously advances the board and reads the resulting frame back into a pinned host buffer.
+    // Returns false when all gFramesInFlight frames are in flight or acquired
+    bool enqueueFrame(const unsigned int generations);
+    // Waits for the oldest frame in flight and returns it. The frame stays valid until releaseFrame()
+    // or the next acquireFrame(). Returns 0 when no frame is in flight
+    const BYTE *acquireFrame();
+    void releaseFrame();
+    int getFramesInFlight() { return m_framesInFlight; };
+
+    // Threshold under which a texture color gives an alive cell
+    virtual void setLimit(const float limit) { m_limit = limit; };
+
+    void setGenerationsPerLaunch(const int generations);
+    int getGenerationsPerLaunch() { return m_generationsPerLaunch; };
+
+    // Tiles advanced by the last generation of the sk_active kernel, -1 when unknown
+    int getActiveTiles();
+
+    // Chunks of the cs_chunked storage, alive or bordering alive cells
+    size_t getChunkCount() { return m_chunks.size(); };
+
+public:
+    // ---------- Kernels ----------
+    void setSimulationKernel(const SimulationKernel kernel) { m_simulationKernel = kernel; };
+
+    // Work-group size of the untiled kernels, 0 letting the runtime choose
+    void setLocalWorkSize(const int x, const int y);
+
+    // Seeds the board again on the next generation
+    virtual void reset() { m_offset = -1; };
+
+    // ---------- State ----------
+    // The float4 storage loads alive cells as black and dead cells as white
+    virtual void loadState(const std::vector<cl_uint> &cells);
+    virtual void saveState(std::vector<cl_uint> &cells);
+
+    // ---------- Snapshots ----------
+    // Copies the current generation of the packed and states storages aside on the device and reads it back on the
+    // transfer queue, so that the board keeps advancing meanwhile. The other storages are read back at once through
+    // saveState(). A snapshot only keeps alive cells and the birth and survival masks, so that it is refused for
+    // rules that are not Life-like, such as Generations rules and their dying cells, and for kernels that were not
+    // built from the rule. Returns false as well while the previous snapshot was not acquired
+    bool enqueueSnapshot();
+    // Waits for the snapshot read back and hands its packed rows over
+    void acquireSnapshot(std::vector<cl_uint> &cells);
+    // Makes the board of the snapshot the current generation, under the rule of the snapshot. The packed storage
+    // uploads the tiles one by one, tiles stored without compression straight from the mapping of the file
+    bool loadSnapshot(const Snapshot &snapshot);
+
+    // ---------- Patterns ----------
+    // Makes the pattern, centered on the board, the current generation. The packed and states storages scatter the
+    // alive words of each batch on the device while the next batch is parsed, the other ones load the whole board
+    bool loadPattern(const Pattern &pattern);
+
+public:
+    // ---------- Rules ----------
+    // Life-like rule of the birth and survival masks: bit n is set when n neighbors
+    // give birth to, or keep alive, a cell
+    virtual bool setRule(const cl_uint birth, const cl_uint survival);
+    // Kernels specialized for the rule, each rule being built once, B3/S23 until a rule is set. Rules that are
+    // not life-like need the cs_states storage, or the cs_float4 one when they have two states. Larger than Life
+    // rules of two states run on the cs_float4 storage
+    bool setRule(const Rule &rule);
+    const Rule &getRule() { return m_rule; };
+
 public:
     // ---------- Textures ----------
-    void setTexture(int index, BYTE *texture);
+    virtual void setTexture(int index, BYTE *texture);
 
     long addTexture(const std::string &filename);
 
@@ -124,30 +242,165 @@ public:
     int getCLPlatformId() { return m_hPlatformId; };
     cl_context getCLContext() { return m_hContext; };
     cl_command_queue getCLQueue() { return m_hQueue; };
+    cl_command_queue getCLTransferQueue() { return m_hTransferQueue; };
+    cl_device_id getCLDevice() { return m_hDevices[0]; };
+    // Program of the last compileKernels()
+    cl_program getCLProgram() { return m_hProgram; };
+    ProgramCache &getProgramCache() { return m_programCache; };
+
+public:
+    // ---------- Profiling ----------
+    // Queue latency and execution time percentiles of the commands enqueued so far, by stage
+    virtual ProfilingStatistics getStatistics() { return m_profiler.getStatistics(); };
+    OpenCLProfiler &getProfiler() { return m_profiler; };
 
 private:
+    OpenCLKernel();
+    void createContext();
+
     char *loadFromFile(const std::string &, size_t &);
 
+    void buildKernels();
+    void releaseKernels();
+    void setKernelArguments();
+    void initializeFrames();
+    void releaseFrames();
+    void enqueueGenerations(const unsigned int generations);
+    void enqueueColorization(cl_mem bitmap, cl_event *event);
+    void transferTextures();
+    size_t *getLocalWorkSize(size_t *globalWorkSize);
+    void enqueueGeneration();
+    void enqueueAliveMask();
+    void enqueuePackedInitialization();
+    void enqueuePackedGenerations(const unsigned int generations);
+    void enqueueActiveGenerations(const unsigned int generations);
+    void enqueueStateGenerations(const unsigned int generations);
+    void enqueueLargerGeneration();
+    void enqueueScatter(const std::vector<cl_uint> &words);
+    bool isRuleBuilt();
+
+    // Chunks
+    void growChunks(const cl_int capacity);
+    cl_int allocateChunk(const long long key);
+    void updateChunks(const std::vector<long long> &keys, const std::vector<cl_uint> &summaries);
+    void uploadChunkTables();
+    void loadChunks(const std::vector<cl_uint> &cells);
+    void enqueueChunkGenerations(const unsigned int generations);
+    void enqueueChunkWindow();
+
 private:
     // OpenCL Objects
     cl_device_id m_hDevices[100];
     int m_hPlatformId;
     cl_context m_hContext;
     cl_command_queue m_hQueue;
+    cl_command_queue m_hTransferQueue;
+    cl_program m_hProgram;
     cl_kernel m_hMainKernel;
+    cl_kernel m_hTiledKernel;
+    cl_kernel m_hAverageKernel;
+    cl_kernel m_hColorizeKernel;
+    cl_kernel m_hAliveKernel;
+    cl_kernel m_hPackedInitKernel;
+    cl_kernel m_hPackedScatterKernel;
+    cl_kernel m_hPackedKernel;
+    cl_kernel m_hPackedTemporalKernel;
+    cl_kernel m_hPackedColorizeKernel;
+    cl_kernel m_hActiveTilesKernel;
+    cl_kernel m_hPackedActiveKernel;
+    cl_kernel m_hChunkKernel;
+    cl_kernel m_hChunkWindowKernel;
+    cl_kernel m_hStateInitKernel;
+    cl_kernel m_hStateScatterKernel;
+    cl_kernel m_hStateKernel;
+    cl_kernel m_hStateColorizeKernel;
+    cl_kernel m_hSatRowsKernel;
+    cl_kernel m_hSatColumnsKernel;
+    cl_kernel m_hLargerKernel;
     cl_uint m_computeUnits;
     cl_uint m_preferredWorkGroupSize;
+    ProgramCache m_programCache;
+    OpenCLProfiler m_profiler;
+
+private:
+    // Source of the kernels, and programs built from it by build options, one per rule
+    std::string m_kernelSource;
+    std::string m_kernelOptions;
+    std::string m_ptxFileName;
+    std::map<std::string, cl_program> m_programs;
 
 private:
     // Host
     cl_mem m_hBitmap;
     cl_mem m_hBuffer;
+    cl_mem m_hAliveMask;
+    cl_mem m_hPackedBuffer;
+    cl_mem m_hScatterBuffer;
+    cl_mem m_hActiveFlags;
+    cl_mem m_hActiveTiles;
+    cl_mem m_hActiveCounts;
+    cl_mem m_hChunks;
+    cl_mem m_hChunkNeighbors;
+    cl_mem m_hChunkSummaries;
+    cl_mem m_hWindowSlots;
+    cl_mem m_hStateBuffer;
+    cl_mem m_hSumBuffer;
     cl_mem m_hVideo;
     cl_mem m_hDepth;
     cl_mem m_hTextures;
     cl_int m_offset;
     cl_float m_timer;
 
+private:
+    // Cells
+    CellStorage m_storage;
+    SimulationKernel m_simulationKernel;
+    cl_int m_width;
+    cl_int m_height;
+    cl_int m_wordsPerRow;
+    cl_uint m_birth;
+    cl_uint m_survival;
+    Rule m_rule;
+    std::string m_ruleOptions;
+    // Rule options of the kernels, empty until they are built or when the main kernel comes from a ptx file
+    std::string m_builtRuleOptions;
+    cl_float m_limit;
+    cl_int m_generationsPerLaunch;
+    size_t m_localWorkSize[2];
+    cl_int m_activeTilesPerRow;
+    cl_int m_activeTileRows;
+    bool m_activeFlagsValid;
+
+private:
+    // Chunks of the unbounded board, by coordinates, and their slots of two generations on the device. The
+    // batch lists the chunks in the order of the neighbor table and of the summaries
+    std::unordered_map<long long, cl_int> m_chunks;
+    std::vector<cl_int> m_freeChunks;
+    std::vector<long long> m_chunkBatch;
+    std::vector<cl_uint> m_chunkZeros;
+    cl_int m_chunkSlots;
+    cl_int m_chunkCapacity;
+    bool m_chunkTablesValid;
+
+private:
+    // Frame pipeline
+    cl_mem m_hFrameBitmaps[gFramesInFlight];
+    cl_mem m_hPinnedFrames[gFramesInFlight];
+    BYTE *m_pinnedFrames[gFramesInFlight];
+    cl_event m_colorizeEvents[gFramesInFlight];
+    cl_event m_readEvents[gFramesInFlight];
+    int m_frameFirst;
+    int m_framesInFlight;
+    int m_acquiredFrame;
+
+private:
+    // Snapshot read back
+    cl_mem m_hSnapshotBuffer;
+    cl_event m_snapshotEvent;
+    std::vector<cl_uint> m_snapshotCells;
+    std::vector<cl_ushort> m_snapshotStates;
+    bool m_snapshotPending;
+
 private:
     BYTE *m_textures;
     bool m_texturedTransfered;
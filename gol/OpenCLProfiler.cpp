@@ -0,0 +1,128 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "OpenCLProfiler.h"
+#include "OpenCLStatus.h"
+
+/*
+ * OpenCLProfiler destructor
+ */
+OpenCLProfiler::~OpenCLProfiler()
+{
+    for (size_t i(0); i < m_pending.size(); ++i)
+        clReleaseEvent(m_pending[i].event);
+}
+
+cl_event *OpenCLProfiler::event(cl_event &event)
+{
+    event = 0;
+    return m_enabled ? &event : NULL;
+}
+
+/*
+ * track
+ */
+void OpenCLProfiler::track(const ProfilingStage stage, cl_event event)
+{
+    if (event == 0)
+        return;
+
+    PendingEvent pending = {stage, event};
+    m_pending.push_back(pending);
+
+    // Commands of a long run of generations are only collected once they are all enqueued, keep the
+    // number of live events bounded by waiting for the oldest one
+    if (m_pending.size() > gProfilingMaxPending)
+    {
+        clWaitForEvents(1, &m_pending[0].event);
+        collect(false);
+    }
+}
+
+/*
+ * trackOrRelease
+ */
+void OpenCLProfiler::trackOrRelease(const ProfilingStage stage, cl_event event)
+{
+    if (m_enabled)
+        track(stage, event);
+    else
+        CHECKSTATUS(clReleaseEvent(event));
+}
+
+/*
+ * collect
+ */
+void OpenCLProfiler::collect(const bool wait)
+{
+    size_t remaining(0);
+    for (size_t i(0); i < m_pending.size(); ++i)
+    {
+        cl_int status(CL_COMPLETE);
+        if (wait)
+            clWaitForEvents(1, &m_pending[i].event);
+        else
+            clGetEventInfo(m_pending[i].event, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(cl_int), &status, NULL);
+
+        // Failed commands have a negative status and no profiling information
+        if (status > CL_COMPLETE)
+            m_pending[remaining++] = m_pending[i];
+        else
+        {
+            if (status == CL_COMPLETE)
+                recordEvent(m_pending[i]);
+            clReleaseEvent(m_pending[i].event);
+        }
+    }
+    m_pending.resize(remaining);
+}
+
+/*
+ * recordEvent
+ */
+void OpenCLProfiler::recordEvent(const PendingEvent &pending)
+{
+    cl_ulong queued(0);
+    cl_ulong submit(0);
+    cl_ulong start(0);
+    cl_ulong end(0);
+    if (clGetEventProfilingInfo(pending.event, CL_PROFILING_COMMAND_QUEUED, sizeof(cl_ulong), &queued, NULL) !=
+            CL_SUCCESS ||
+        clGetEventProfilingInfo(pending.event, CL_PROFILING_COMMAND_SUBMIT, sizeof(cl_ulong), &submit, NULL) !=
+            CL_SUCCESS ||
+        clGetEventProfilingInfo(pending.event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &start, NULL) !=
+            CL_SUCCESS ||
+        clGetEventProfilingInfo(pending.event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &end, NULL) != CL_SUCCESS)
+        return;
+
+    // Timestamps are in nanoseconds, some runtimes do not keep them monotonic across queues
+    record(pending.stage, (submit > queued) ? (submit - queued) * 1e-3f : 0.f,
+           (start > queued) ? (start - queued) * 1e-3f : 0.f, (end > start) ? (end - start) * 1e-3f : 0.f);
+}
+
+/*
+ * getStatistics
+ */
+ProfilingStatistics OpenCLProfiler::getStatistics()
+{
+    collect(false);
+    return Profiler::getStatistics();
+}
@@ -0,0 +1,66 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <CL/opencl.h>
+
+#include "Profiler.h"
+
+// Events waiting for their profiling information before the oldest one is waited for
+const size_t gProfilingMaxPending = 256;
+
+/*
+ * Collects the profiling information of the commands enqueued by the kernel. Events are owned by the
+ * profiler until their command completes, at which point their timestamps are recorded and they are released.
+ */
+class GOL_API OpenCLProfiler : public Profiler
+{
+public:
+    OpenCLProfiler() {}
+    virtual ~OpenCLProfiler();
+
+public:
+    // Event to pass to an enqueue call, NULL when profiling is disabled
+    cl_event *event(cl_event &event);
+
+    // Takes ownership of the event of a command of the given stage
+    void track(const ProfilingStage stage, cl_event event);
+    // Same, the event being released at once when profiling is disabled
+    void trackOrRelease(const ProfilingStage stage, cl_event event);
+
+    // Records the completed commands, waiting for all of them when wait is set
+    void collect(const bool wait);
+
+    virtual ProfilingStatistics getStatistics();
+
+private:
+    struct PendingEvent
+    {
+        ProfilingStage stage;
+        cl_event event;
+    };
+
+    void recordEvent(const PendingEvent &pending);
+
+private:
+    std::vector<PendingEvent> m_pending;
+};
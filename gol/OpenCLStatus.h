@@ -0,0 +1,51 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <CL/opencl.h>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// Name of an OpenCL error code
+std::string getErrorDesc(int err);
+
+#ifndef LOG_ERROR
+#define LOG_ERROR(msg) std::cerr << msg << std::endl;
+#endif // LOG_ERROR
+
+/*
+ * CHECKSTATUS: logs the failing OpenCL call and its error
+ */
+#define CHECKSTATUS(stmt)                                        \
+    {                                                            \
+        int __status = stmt;                                     \
+        if (__status != CL_SUCCESS)                              \
+        {                                                        \
+            std::stringstream __s;                               \
+            __s << "==> " #stmt "\n";                            \
+            __s << "ERROR : " << getErrorDesc(__status) << "\n"; \
+            __s << "<== " #stmt "\n";                            \
+            LOG_ERROR(__s.str());                                \
+        }                                                        \
+    }
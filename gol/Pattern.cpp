@@ -0,0 +1,440 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "Pattern.h"
+
+// Counts of an RLE pattern are clamped, cells that far being out of any board
+const int64_t gPatternMaxCount = 1LL << 40;
+
+static bool isBlank(const char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static size_t lineEnd(const char *data, const size_t size, size_t position)
+{
+    while (position < size && data[position] != '\n')
+        ++position;
+    return position;
+}
+
+// Unsigned number of a line after blanks, the mapping not ending with a terminator
+static bool readNumber(const char *data, const size_t end, size_t &position, uint64_t &value)
+{
+    while (position < end && isBlank(data[position]))
+        ++position;
+    if (position == end || data[position] < '0' || data[position] > '9')
+        return false;
+    value = 0;
+    while (position < end && data[position] >= '0' && data[position] <= '9')
+        value = std::min(value * 10 + (data[position++] - '0'), static_cast<uint64_t>(0xFFFFFFFF));
+    return true;
+}
+
+static std::string trim(const std::string &value)
+{
+    size_t first(0);
+    size_t last(value.size());
+    while (first < last && isBlank(value[first]))
+        ++first;
+    while (last > first && isBlank(value[last - 1]))
+        --last;
+    return value.substr(first, last - first);
+}
+
+/*
+ * Alive words of a board, coalesced while consecutive cells fall into the same word, and handed over by batches
+ */
+class PatternWords
+{
+public:
+    PatternWords(const int width, const int height, const std::function<void(const std::vector<uint32_t> &)> &sink)
+        : m_width(width)
+        , m_height(height)
+        , m_wordsPerRow(packedWords(width))
+        , m_sink(sink)
+        , m_index(0)
+        , m_bits(0)
+    {
+        m_words.reserve(2 * gPatternBatchWords);
+    }
+
+    int getWidth() const { return m_width; };
+    int getHeight() const { return m_height; };
+
+    // Alive cells [x, x+length) of row y, cells out of the board being dropped
+    void addRun(const int64_t x, const int64_t y, const int64_t length)
+    {
+        if (y < 0 || y >= m_height)
+            return;
+        int64_t last = std::min(x + length, static_cast<int64_t>(m_width));
+        for (int64_t column(std::max(x, static_cast<int64_t>(0))); column < last;)
+        {
+            int64_t word = column / gPackedWordBits;
+            int64_t end = std::min(last, (word + 1) * gPackedWordBits);
+            int count = static_cast<int>(end - column);
+            uint32_t bits = (count == gPackedWordBits) ? 0xFFFFFFFF : ((1u << count) - 1) << (column % gPackedWordBits);
+            add(static_cast<uint32_t>(y * m_wordsPerRow + word), bits);
+            column = end;
+        }
+    }
+
+    void flush()
+    {
+        if (m_bits)
+        {
+            m_words.push_back(m_index);
+            m_words.push_back(m_bits);
+            m_bits = 0;
+        }
+        if (!m_words.empty())
+            m_sink(m_words);
+        m_words.clear();
+    }
+
+private:
+    void add(const uint32_t index, const uint32_t bits)
+    {
+        if (m_bits && index == m_index)
+        {
+            m_bits |= bits;
+            return;
+        }
+        if (m_bits)
+        {
+            m_words.push_back(m_index);
+            m_words.push_back(m_bits);
+            if (m_words.size() >= 2 * gPatternBatchWords)
+            {
+                m_sink(m_words);
+                m_words.clear();
+            }
+        }
+        m_index = index;
+        m_bits = bits;
+    }
+
+private:
+    int m_width;
+    int m_height;
+    int64_t m_wordsPerRow;
+    const std::function<void(const std::vector<uint32_t> &)> &m_sink;
+    std::vector<uint32_t> m_words;
+    uint32_t m_index;
+    uint32_t m_bits;
+};
+
+/*
+ * Pattern constructor
+ */
+Pattern::Pattern()
+    : m_format(pf_rle)
+    , m_width(0)
+    , m_height(0)
+    , m_body(0)
+{
+}
+
+bool Pattern::open(const std::string &fileName)
+{
+    close();
+    if (!m_file.open(fileName))
+        return false;
+
+    const char *data = reinterpret_cast<const char *>(m_file.getData());
+    size_t size = m_file.getSize();
+    size_t position(0);
+    while (position < size && isBlank(data[position]))
+        ++position;
+    m_format = (size - position >= 4 && memcmp(data + position, "[M2]", 4) == 0) ? pf_macrocell : pf_rle;
+    m_body = position;
+    if ((m_format == pf_rle) ? readRLEHeader() : readMacrocellNodes())
+        return true;
+
+    std::cerr << fileName << " is not a valid " << ((m_format == pf_rle) ? "RLE" : "macrocell") << " pattern"
+              << std::endl;
+    close();
+    return false;
+}
+
+void Pattern::close()
+{
+    m_file.close();
+    m_rule.clear();
+    m_width = 0;
+    m_height = 0;
+    m_body = 0;
+    m_nodes.clear();
+}
+
+/*
+ * readRLEHeader: comments, then "x = <width>, y = <height>, rule = <rule>"
+ */
+bool Pattern::readRLEHeader()
+{
+    const char *data = reinterpret_cast<const char *>(m_file.getData());
+    size_t size = m_file.getSize();
+    for (size_t position(0); position < size;)
+    {
+        size_t end = lineEnd(data, size, position);
+        std::string line = trim(std::string(data + position, end - position));
+        position = std::min(end + 1, size);
+        if (line.empty() || line[0] == '#')
+        {
+            // Rule of older patterns
+            if (line.size() > 2 && line[1] == 'r')
+                m_rule = trim(line.substr(2));
+            continue;
+        }
+        if (line[0] != 'x')
+            return false;
+
+        for (size_t first(0); first < line.size();)
+        {
+            size_t last = std::min(line.find(',', first), line.size());
+            std::string item = line.substr(first, last - first);
+            size_t equal = item.find('=');
+            if (equal != std::string::npos)
+            {
+                std::string key = trim(item.substr(0, equal));
+                std::string value = trim(item.substr(equal + 1));
+                if (key == "x")
+                    m_width = strtoll(value.c_str(), NULL, 10);
+                else if (key == "y")
+                    m_height = strtoll(value.c_str(), NULL, 10);
+                else if (key == "rule")
+                    m_rule = value;
+            }
+            first = last + 1;
+        }
+        m_body = position;
+        return m_width >= 0 && m_height >= 0;
+    }
+    return false;
+}
+
+/*
+ * readMacrocellNodes: leaves of 8x8 cells such as ".*$..*$***$", and nodes "<level> <nw> <ne> <sw> <se>" of the
+ * nodes given before, 1 being the first one
+ */
+bool Pattern::readMacrocellNodes()
+{
+    const char *data = reinterpret_cast<const char *>(m_file.getData());
+    size_t size = m_file.getSize();
+    PatternNode empty;
+    memset(&empty, 0, sizeof(empty));
+    m_nodes.assign(1, empty);
+
+    // Lines after the "[M2]" one
+    for (size_t position(lineEnd(data, size, m_body) + 1); position < size;)
+    {
+        size_t end = lineEnd(data, size, position);
+        size_t first(position);
+        position = end + 1;
+        while (first < end && isBlank(data[first]))
+            ++first;
+        if (first == end)
+            continue;
+        if (data[first] == '#')
+        {
+            if (first + 1 < end && data[first + 1] == 'R')
+                m_rule = trim(std::string(data + first + 2, end - first - 2));
+            continue;
+        }
+
+        PatternNode node(empty);
+        if (data[first] == '.' || data[first] == '*' || data[first] == '$')
+        {
+            node.level = 3;
+            int row(0);
+            int column(0);
+            for (size_t i(first); i < end && !isBlank(data[i]); ++i)
+            {
+                if (data[i] == '$')
+                {
+                    ++row;
+                    column = 0;
+                    continue;
+                }
+                if ((data[i] != '.' && data[i] != '*') || row >= 8 || column >= 8)
+                    return false;
+                if (data[i] == '*')
+                    node.leaf |= 1ULL << (row * 8 + column);
+                ++column;
+            }
+        }
+        else
+        {
+            uint64_t values[5];
+            size_t next(first);
+            for (int i(0); i < 5; ++i)
+                if (!readNumber(data, end, next, values[i]))
+                    return false;
+            if (values[0] < 1 || values[0] > 1000)
+                return false;
+            node.level = static_cast<int>(values[0]);
+            for (int i(0); i < 4; ++i)
+            {
+                // Children of level 1 nodes are cell states
+                uint64_t child = values[i + 1];
+                if (node.level > 1 && child != 0 && (child >= m_nodes.size() || m_nodes[child].level != node.level - 1))
+                    return false;
+                node.children[i] = static_cast<uint32_t>(std::min(child, static_cast<uint64_t>(0xFFFFFFFF)));
+            }
+        }
+        m_nodes.push_back(node);
+    }
+
+    // Central part of a root larger than any board, made of the inner grandchildren
+    while (m_nodes.size() > 1 && m_nodes.back().level > gPatternMaxLevel)
+    {
+        PatternNode root = m_nodes.back();
+        PatternNode center(empty);
+        center.level = root.level - 1;
+        for (int i(0); i < 4; ++i)
+            center.children[i] = root.children[i] ? m_nodes[root.children[i]].children[3 - i] : 0;
+        m_nodes.push_back(center);
+    }
+    m_width = (m_nodes.size() > 1) ? (1LL << m_nodes.back().level) : 0;
+    m_height = m_width;
+    return true;
+}
+
+bool Pattern::scan(const int width, const int height,
+                   const std::function<void(const std::vector<uint32_t> &)> &sink) const
+{
+    PatternWords words(width, height, sink);
+    bool scanned(true);
+    if (m_format == pf_rle)
+        scanned = scanRLE(words);
+    else if (m_nodes.size() > 1)
+        scanNode(words, static_cast<uint32_t>(m_nodes.size() - 1), (width - m_width) / 2, (height - m_height) / 2);
+    words.flush();
+    return scanned;
+}
+
+bool Pattern::scanRLE(PatternWords &words) const
+{
+    const char *data = reinterpret_cast<const char *>(m_file.getData());
+    size_t size = m_file.getSize();
+    int64_t originX = (words.getWidth() - m_width) / 2;
+    int64_t originY = (words.getHeight() - m_height) / 2;
+    int64_t x(0);
+    int64_t y(0);
+    int64_t count(0);
+    for (size_t position(m_body); position < size; ++position)
+    {
+        char tag = data[position];
+        if (tag >= '0' && tag <= '9')
+        {
+            count = std::min(count * 10 + (tag - '0'), gPatternMaxCount);
+            continue;
+        }
+        if (isBlank(tag))
+            continue;
+        int64_t length = count ? count : 1;
+        count = 0;
+
+        // States of more than two are two letters, "pA" to "yO"
+        if (tag >= 'p' && tag <= 'y')
+        {
+            if (++position == size || data[position] < 'A' || data[position] > 'X')
+                return false;
+            tag = 'A';
+        }
+        switch (tag)
+        {
+        case 'b':
+        case '.':
+            x += length;
+            break;
+        case '$':
+            x = 0;
+            y += length;
+            // Rows below the board
+            if (originY + y >= words.getHeight())
+                return true;
+            break;
+        case '!':
+            return true;
+        case '#':
+            position = lineEnd(data, size, position);
+            break;
+        default:
+            if (tag != 'o' && (tag < 'A' || tag > 'X'))
+                return false;
+            words.addRun(originX + x, originY + y, length);
+            x += length;
+            break;
+        }
+    }
+    return true;
+}
+
+void Pattern::scanNode(PatternWords &words, const uint32_t node, const int64_t x, const int64_t y) const
+{
+    const PatternNode &current = m_nodes[node];
+    int64_t side = 1LL << current.level;
+    if (node == 0 || x >= words.getWidth() || y >= words.getHeight() || x + side <= 0 || y + side <= 0)
+        return;
+
+    if (current.level == 1)
+    {
+        for (int i(0); i < 4; ++i)
+            if (current.children[i])
+                words.addRun(x + (i & 1), y + (i >> 1), 1);
+        return;
+    }
+
+    // Runs of alive cells of each row of a leaf
+    for (int row(0); row < 8 && current.leaf; ++row)
+    {
+        int cells = static_cast<int>((current.leaf >> (row * 8)) & 0xFF);
+        for (int column(0); column < 8;)
+        {
+            int end(column);
+            while (end < 8 && ((cells >> end) & 1))
+                ++end;
+            if (end > column)
+                words.addRun(x + column, y + row, end - column);
+            column = end + 1;
+        }
+    }
+
+    side /= 2;
+    for (int i(0); i < 4; ++i)
+        if (current.children[i])
+            scanNode(words, current.children[i], x + (i & 1) * side, y + (i >> 1) * side);
+}
+
+bool Pattern::load(const int width, const int height, std::vector<uint32_t> &cells) const
+{
+    cells.assign(static_cast<size_t>(packedWords(width)) * height, 0);
+    return scan(width, height, [&cells](const std::vector<uint32_t> &words) {
+        for (size_t i(0); i < words.size(); i += 2)
+            cells[words[i]] |= words[i + 1];
+    });
+}
@@ -0,0 +1,96 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include "MappedFile.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+// Alive words handed over at once while a pattern is scanned
+const size_t gPatternBatchWords = 1 << 20;
+// Level of the largest macrocell node scanned, the central part of larger roots being kept only
+const int gPatternMaxLevel = 40;
+
+enum PatternFormat
+{
+    pf_rle,      // Run length encoded cells: "x = 3, y = 3, rule = B3/S23" then "bo$2bo$3o!"
+    pf_macrocell // Quadtree of Golly: "[M2]", then 8x8 leaves and nodes of their four children
+};
+
+// Node of a macrocell pattern, node 0 being empty whatever its level
+struct PatternNode
+{
+    int level;
+    uint32_t children[4]; // North-west, north-east, south-west and south-east
+    uint64_t leaf;        // Cells of a level 3 leaf, row after row, a byte per row
+};
+
+class PatternWords;
+
+/*
+ * Pattern of the RLE or macrocell formats, read through a mapping of its file. Scanning the pattern hands its
+ * alive packed words over by batches, so that a board is seeded without a dense copy of its cells (see
+ * OpenCLKernel::loadPattern()). Cells of any other state than 0 are alive.
+ */
+class GOL_API Pattern
+{
+public:
+    Pattern();
+
+public:
+    // Maps the file and reads its header, and the nodes of a macrocell pattern. Returns false when the file is
+    // neither an RLE nor a macrocell pattern
+    bool open(const std::string &fileName);
+    void close();
+
+    PatternFormat getFormat() const { return m_format; };
+    // Rule of the header, empty when the pattern does not give one
+    const std::string &getRule() const { return m_rule; };
+    // Size of the RLE header, or side of the root node of a macrocell pattern
+    int64_t getWidth() const { return m_width; };
+    int64_t getHeight() const { return m_height; };
+
+    // Parses the pattern centered on a board of width x height cells, cells out of the board being dropped, and
+    // hands batches of pairs of word index in the packed rows and alive bits over to sink. Parts of a macrocell
+    // pattern sharing a word give several pairs of that word. Returns false when the pattern is corrupted
+    bool scan(const int width, const int height, const std::function<void(const std::vector<uint32_t> &)> &sink) const;
+    // Alive cells of the pattern into the packed rows of a board
+    bool load(const int width, const int height, std::vector<uint32_t> &cells) const;
+
+private:
+    bool readRLEHeader();
+    bool readMacrocellNodes();
+    bool scanRLE(PatternWords &words) const;
+    void scanNode(PatternWords &words, const uint32_t node, const int64_t x, const int64_t y) const;
+
+private:
+    MappedFile m_file;
+    PatternFormat m_format;
+    std::string m_rule;
+    int64_t m_width;
+    int64_t m_height;
+    // Start of the cells of an RLE pattern, or of the "[M2]" line of a macrocell pattern
+    size_t m_body;
+    // Nodes of a macrocell pattern, the root being the last one
+    std::vector<PatternNode> m_nodes;
+};
@@ -0,0 +1,100 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <algorithm>
+
+#include "Profiler.h"
+
+static ProfilingPercentiles percentiles(std::vector<float> values)
+{
+    ProfilingPercentiles result = {0.0, 0.0};
+    if (values.empty())
+        return result;
+
+    size_t p50 = (values.size() - 1) / 2;
+    size_t p99 = (values.size() - 1) * 99 / 100;
+    std::nth_element(values.begin(), values.begin() + p50, values.end());
+    result.p50 = values[p50];
+    std::nth_element(values.begin(), values.begin() + p99, values.end());
+    result.p99 = values[p99];
+    return result;
+}
+
+/*
+ * Profiler constructor
+ */
+Profiler::Profiler()
+    : m_enabled(true)
+{
+    reset();
+}
+
+void Profiler::record(const ProfilingStage stage, const double duration)
+{
+    record(stage, 0.f, 0.f, static_cast<float>(duration));
+}
+
+void Profiler::record(const ProfilingStage stage, const float submission, const float latency, const float duration)
+{
+    Samples &samples = m_samples[stage];
+    size_t slot = samples.count % gProfilingWindow;
+    if (samples.duration.size() < gProfilingWindow)
+    {
+        samples.submission.push_back(0.f);
+        samples.latency.push_back(0.f);
+        samples.duration.push_back(0.f);
+    }
+    samples.submission[slot] = submission;
+    samples.latency[slot] = latency;
+    samples.duration[slot] = duration;
+    samples.totalDuration += duration;
+    ++samples.count;
+}
+
+/*
+ * getStatistics
+ */
+ProfilingStatistics Profiler::getStatistics()
+{
+    ProfilingStatistics statistics;
+    for (int i(0); i < ps_count; ++i)
+    {
+        const Samples &samples = m_samples[i];
+        statistics.stages[i].count = samples.count;
+        statistics.stages[i].totalDuration = samples.totalDuration;
+        statistics.stages[i].submission = percentiles(samples.submission);
+        statistics.stages[i].latency = percentiles(samples.latency);
+        statistics.stages[i].duration = percentiles(samples.duration);
+    }
+    return statistics;
+}
+
+void Profiler::reset()
+{
+    for (int i(0); i < ps_count; ++i)
+    {
+        m_samples[i].submission.clear();
+        m_samples[i].latency.clear();
+        m_samples[i].duration.clear();
+        m_samples[i].count = 0;
+        m_samples[i].totalDuration = 0.0;
+    }
+}
@@ -0,0 +1,107 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include "DLL_API.h"
+#include <chrono>
+#include <stddef.h>
+#include <vector>
+
+// Samples per stage kept by the rolling histograms
+const size_t gProfilingWindow = 1024;
+
+enum ProfilingStage
+{
+    ps_upload,     // Texture, video and strip writes
+    ps_simulation, // Generation kernels
+    ps_colorize,   // Colorization kernels
+    ps_readback,   // Bitmap and strip reads
+    ps_exchange,   // Halo rows exchanged between devices
+    ps_count
+};
+
+struct ProfilingPercentiles
+{
+    double p50;
+    double p99;
+};
+
+// Times in microseconds, percentiles over the last gProfilingWindow commands of the stage
+struct StageStatistics
+{
+    unsigned long long count;        // Commands recorded since the last reset
+    double totalDuration;            // Sum of the execution times since the last reset
+    ProfilingPercentiles submission; // CL_PROFILING_COMMAND_SUBMIT - CL_PROFILING_COMMAND_QUEUED
+    ProfilingPercentiles latency;    // CL_PROFILING_COMMAND_START - CL_PROFILING_COMMAND_QUEUED
+    ProfilingPercentiles duration;   // CL_PROFILING_COMMAND_END - CL_PROFILING_COMMAND_START
+};
+
+struct ProfilingStatistics
+{
+    StageStatistics stages[ps_count];
+};
+
+// Time elapsed since start, in microseconds, of a command timed on the host
+inline double elapsedMicroseconds(const std::chrono::high_resolution_clock::time_point &start)
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+/*
+ * Collects the execution times of the commands of an engine, timed on the host. OpenCLProfiler adds the commands
+ * timed by the OpenCL runtime.
+ */
+class GOL_API Profiler
+{
+public:
+    Profiler();
+    virtual ~Profiler() {}
+
+public:
+    void setEnabled(const bool enabled) { m_enabled = enabled; };
+    bool isEnabled() { return m_enabled; };
+
+    // Records a command timed on the host, in microseconds
+    void record(const ProfilingStage stage, const double duration);
+
+    virtual ProfilingStatistics getStatistics();
+    void reset();
+
+protected:
+    void record(const ProfilingStage stage, const float submission, const float latency, const float duration);
+
+protected:
+    bool m_enabled;
+
+private:
+    struct Samples
+    {
+        std::vector<float> submission;
+        std::vector<float> latency;
+        std::vector<float> duration;
+        unsigned long long count;
+        double totalDuration;
+    };
+
+private:
+    Samples m_samples[ps_count];
+};
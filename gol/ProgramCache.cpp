@@ -0,0 +1,330 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <sys/stat.h>
+#ifdef WIN32
+#include <direct.h>
+#include <windows.h>
+#endif
+
+#include "ProgramCache.h"
+
+const char gProgramCacheMagic[] = {'G', 'O', 'L', 'P'};
+const unsigned int gProgramCacheVersion = 1;
+const char *gProgramCacheIndex = "index.txt";
+
+/*
+ * 64-bit FNV-1a hash
+ */
+static unsigned long long hashBytes(const unsigned char *bytes, size_t length)
+{
+    unsigned long long hash = 14695981039346656037ULL;
+    for (size_t i(0); i < length; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/*
+ * Replaces a file by a complete temporary one, so that concurrent readers never see a partial file
+ */
+static bool replaceFile(const std::string &temporary, const std::string &fileName)
+{
+#ifdef WIN32
+    bool replaced = MoveFileExA(temporary.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    bool replaced = std::rename(temporary.c_str(), fileName.c_str()) == 0;
+#endif
+    if (!replaced)
+        std::remove(temporary.c_str());
+    return replaced;
+}
+
+static std::string hashString(const std::string &value)
+{
+    std::stringstream s;
+    s << std::hex << hashBytes((const unsigned char *)value.c_str(), value.length());
+    return s.str();
+}
+
+static std::string deviceInfo(cl_device_id device, cl_device_info info)
+{
+    char buffer[1024] = {0};
+    clGetDeviceInfo(device, info, sizeof(buffer) - 1, buffer, NULL);
+    return buffer;
+}
+
+static std::string platformInfo(cl_platform_id platform, cl_platform_info info)
+{
+    char buffer[1024] = {0};
+    clGetPlatformInfo(platform, info, sizeof(buffer) - 1, buffer, NULL);
+    return buffer;
+}
+
+/*
+ * ProgramCache constructor
+ */
+ProgramCache::ProgramCache()
+{
+    const char *directory = getenv("GOL_KERNEL_CACHE");
+    m_directory = (directory != 0) ? directory : ".golcache";
+}
+
+std::string ProgramCache::getKey(cl_device_id device, const std::string &source, const std::string &options)
+{
+    cl_platform_id platform(0);
+    clGetDeviceInfo(device, CL_DEVICE_PLATFORM, sizeof(platform), &platform, NULL);
+
+    std::stringstream key;
+    key << platformInfo(platform, CL_PLATFORM_NAME) << "|" << platformInfo(platform, CL_PLATFORM_VERSION) << "|"
+        << deviceInfo(device, CL_DEVICE_NAME) << "|" << deviceInfo(device, CL_DEVICE_VERSION) << "|"
+        << deviceInfo(device, CL_DRIVER_VERSION) << "|" << options << "|" << hashString(source);
+    return key.str();
+}
+
+std::string ProgramCache::getEntryName(const std::string &key)
+{
+    return hashString(key) + ".bin";
+}
+
+std::string ProgramCache::getPath(const std::string &name)
+{
+    return m_directory + "/" + name;
+}
+
+/*
+ * load
+ */
+cl_program ProgramCache::load(cl_context context, cl_device_id device, const std::string &source,
+                              const std::string &options)
+{
+    if (m_directory.empty())
+        return 0;
+
+    std::string key = getKey(device, source, options);
+    std::string name = getEntryName(key);
+    std::vector<unsigned char> binary;
+    if (!readEntry(name, key, binary))
+        return 0;
+
+    int status(0);
+    int binaryStatus(0);
+    size_t length = binary.size();
+    const unsigned char *bytes = &binary[0];
+    cl_program program = clCreateProgramWithBinary(context, 1, &device, &length, &bytes, &binaryStatus, &status);
+    if (status == CL_SUCCESS && binaryStatus == CL_SUCCESS)
+        status = clBuildProgram(program, 1, &device, options.c_str(), NULL, NULL);
+    else if (status == CL_SUCCESS)
+        status = binaryStatus;
+
+    if (status != CL_SUCCESS)
+    {
+        // Rejected by the driver
+        std::cout << "Discarding cached program " << name << std::endl;
+        if (program)
+            clReleaseProgram(program);
+        evict(name);
+        return 0;
+    }
+
+    std::cout << "Loaded cached program " << name << std::endl;
+    touch(name);
+    return program;
+}
+
+/*
+ * store
+ */
+void ProgramCache::store(cl_program program, cl_device_id device, const std::string &source,
+                         const std::string &options)
+{
+    if (m_directory.empty())
+        return;
+
+    size_t length(0);
+    if (clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, sizeof(size_t), &length, NULL) != CL_SUCCESS ||
+        length == 0)
+        return;
+
+    std::vector<unsigned char> binary(length);
+    unsigned char *bytes = &binary[0];
+    if (clGetProgramInfo(program, CL_PROGRAM_BINARIES, sizeof(unsigned char *), &bytes, NULL) != CL_SUCCESS)
+        return;
+
+#ifdef WIN32
+    _mkdir(m_directory.c_str());
+#else
+    mkdir(m_directory.c_str(), 0755);
+#endif
+
+    std::string key = getKey(device, source, options);
+    std::string name = getEntryName(key);
+    std::string temporary = getPath(name) + ".tmp";
+    std::ofstream file(temporary.c_str(), std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+        return;
+
+    unsigned int keyLength = static_cast<unsigned int>(key.length());
+    unsigned long long binaryLength = length;
+    unsigned long long binaryHash = hashBytes(bytes, length);
+    file.write(gProgramCacheMagic, sizeof(gProgramCacheMagic));
+    file.write((const char *)&gProgramCacheVersion, sizeof(gProgramCacheVersion));
+    file.write((const char *)&keyLength, sizeof(keyLength));
+    file.write(key.c_str(), keyLength);
+    file.write((const char *)&binaryLength, sizeof(binaryLength));
+    file.write((const char *)&binaryHash, sizeof(binaryHash));
+    file.write((const char *)bytes, length);
+    file.close();
+    if (!file.good() || !replaceFile(temporary, getPath(name)))
+    {
+        std::remove(temporary.c_str());
+        return;
+    }
+
+    touch(name);
+}
+
+/*
+ * readEntry
+ */
+bool ProgramCache::readEntry(const std::string &name, const std::string &key, std::vector<unsigned char> &binary)
+{
+    std::ifstream file(getPath(name).c_str(), std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    char magic[sizeof(gProgramCacheMagic)];
+    unsigned int version(0);
+    unsigned int keyLength(0);
+    file.read(magic, sizeof(magic));
+    file.read((char *)&version, sizeof(version));
+    file.read((char *)&keyLength, sizeof(keyLength));
+    if (!file.good() || !std::equal(magic, magic + sizeof(magic), gProgramCacheMagic) ||
+        version != gProgramCacheVersion || keyLength != key.length())
+    {
+        file.close();
+        evict(name);
+        return false;
+    }
+
+    // Hash collisions are ruled out by comparing the full key
+    std::string entryKey(keyLength, ' ');
+    unsigned long long binaryLength(0);
+    unsigned long long binaryHash(0);
+    file.read(&entryKey[0], keyLength);
+    file.read((char *)&binaryLength, sizeof(binaryLength));
+    file.read((char *)&binaryHash, sizeof(binaryHash));
+    if (!file.good() || entryKey != key || binaryLength == 0)
+    {
+        file.close();
+        evict(name);
+        return false;
+    }
+
+    // The length must match the bytes left, a corrupted one asking for any amount of memory
+    std::streamoff position = file.tellg();
+    file.seekg(0, std::ios::end);
+    std::streamoff end = file.tellg();
+    file.seekg(position);
+    if (position < 0 || end < position || binaryLength != static_cast<unsigned long long>(end - position))
+    {
+        file.close();
+        evict(name);
+        return false;
+    }
+
+    binary.resize(static_cast<size_t>(binaryLength));
+    file.read((char *)&binary[0], binary.size());
+    bool valid = file.good() && hashBytes(&binary[0], binary.size()) == binaryHash;
+    file.close();
+    if (!valid)
+    {
+        // Truncated or corrupted
+        evict(name);
+        return false;
+    }
+    return true;
+}
+
+/*
+ * touch
+ */
+void ProgramCache::touch(const std::string &name)
+{
+    // The index lists entries from the least to the most recently used
+    std::vector<std::string> entries;
+    readIndex(entries);
+    entries.erase(std::remove(entries.begin(), entries.end(), name), entries.end());
+    entries.push_back(name);
+
+    while (entries.size() > gProgramCacheMaxEntries)
+    {
+        std::remove(getPath(entries.front()).c_str());
+        entries.erase(entries.begin());
+    }
+    writeIndex(entries);
+}
+
+/*
+ * evict
+ */
+void ProgramCache::evict(const std::string &name)
+{
+    std::remove(getPath(name).c_str());
+
+    std::vector<std::string> entries;
+    readIndex(entries);
+    entries.erase(std::remove(entries.begin(), entries.end(), name), entries.end());
+    writeIndex(entries);
+}
+
+void ProgramCache::readIndex(std::vector<std::string> &entries)
+{
+    std::ifstream file(getPath(gProgramCacheIndex).c_str());
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (!line.empty())
+            entries.push_back(line);
+    }
+}
+
+void ProgramCache::writeIndex(const std::vector<std::string> &entries)
+{
+    // Written aside then renamed, as another process may be reading or writing the index
+    std::string temporary = getPath(gProgramCacheIndex) + ".tmp";
+    std::ofstream file(temporary.c_str(), std::ios::trunc);
+    for (size_t i(0); i < entries.size(); ++i)
+        file << entries[i] << std::endl;
+    file.close();
+    if (file.good())
+        replaceFile(temporary, getPath(gProgramCacheIndex));
+    else
+        std::remove(temporary.c_str());
+}
@@ -0,0 +1,68 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <CL/opencl.h>
+
+#include "DLL_API.h"
+#include <string>
+#include <vector>
+
+// Programs kept in the cache before the least recently used ones are evicted
+const size_t gProgramCacheMaxEntries = 32;
+
+/*
+ * On-disk cache of OpenCL program binaries. Entries are keyed by platform, device, driver version,
+ * source and build options, so that a new driver or a modified kernel never picks up a stale binary.
+ */
+class GOL_API ProgramCache
+{
+public:
+    ProgramCache();
+
+public:
+    // An empty directory disables the cache
+    void setDirectory(const std::string &directory) { m_directory = directory; };
+    const std::string &getDirectory() { return m_directory; };
+
+    // Returns the program built from the cached binary, or 0 when there is no entry or when the binary
+    // cannot be built anymore, in which case the entry is evicted
+    cl_program load(cl_context context, cl_device_id device, const std::string &source, const std::string &options);
+
+    // Stores the binary of a program built from source
+    void store(cl_program program, cl_device_id device, const std::string &source, const std::string &options);
+
+private:
+    std::string getKey(cl_device_id device, const std::string &source, const std::string &options);
+    std::string getEntryName(const std::string &key);
+    std::string getPath(const std::string &name);
+
+    bool readEntry(const std::string &name, const std::string &key, std::vector<unsigned char> &binary);
+    void touch(const std::string &name);
+    void evict(const std::string &name);
+
+    void readIndex(std::vector<std::string> &entries);
+    void writeIndex(const std::vector<std::string> &entries);
+
+private:
+    std::string m_directory;
+};
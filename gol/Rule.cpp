@@ -0,0 +1,360 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+#include "Rule.h"
+#include "SimulationEngine.h"
+
+const int gRuleCenter = 0x010;
+const int gRuleNeighbors = 0x1EF;
+
+// Letters of the isotropic configurations of 1 to 4 neighbors in Hensel notation, and a neighborhood of each
+// of them. The configurations of 5 to 7 neighbors are the complements of those of 3 to 1 neighbors
+const char *gHenselLetters[] = {"", "ce", "ceaikn", "ceaiknjqry", "ceaiknjqrtwyz"};
+const int gHenselNeighborhoods[][13] = {{0},
+                                        {1, 2},
+                                        {5, 10, 3, 40, 33, 68},
+                                        {69, 42, 11, 7, 98, 13, 14, 70, 41, 97},
+                                        {325, 170, 15, 45, 99, 71, 106, 102, 43, 101, 105, 78, 108}};
+
+static int neighborCount(const int neighborhood)
+{
+    int count(0);
+    for (int bit(0); bit < 9; ++bit)
+        count += (neighborhood & gRuleNeighbors) >> bit & 1;
+    return count;
+}
+
+/*
+ * Smallest of the rotations and reflections of a neighborhood
+ */
+static int canonicalNeighborhood(const int neighborhood)
+{
+    int smallest(neighborhood);
+    for (int symmetry(1); symmetry < 8; ++symmetry)
+    {
+        int transformed(0);
+        for (int bit(0); bit < 9; ++bit)
+            if ((neighborhood >> bit) & 1)
+            {
+                int x(bit % 3 - 1);
+                int y(bit / 3 - 1);
+                for (int turn(0); turn < (symmetry & 3); ++turn)
+                {
+                    int previous(x);
+                    x = -y;
+                    y = previous;
+                }
+                if (symmetry & 4)
+                    x = -x;
+                transformed |= 1 << ((y + 1) * 3 + x + 1);
+            }
+        smallest = (transformed < smallest) ? transformed : smallest;
+    }
+    return smallest;
+}
+
+/*
+ * Hensel letter of the configuration of the neighbors, 0 for 0 and 8 neighbors
+ */
+static char henselLetter(const int neighborhood)
+{
+    int count(neighborCount(neighborhood));
+    int letters(count <= 4 ? count : 8 - count);
+    int canonical(canonicalNeighborhood((count <= 4 ? neighborhood : ~neighborhood) & gRuleNeighbors));
+    for (int i(0); gHenselLetters[letters][i] != 0; ++i)
+        if (canonicalNeighborhood(gHenselNeighborhoods[letters][i]) == canonical)
+            return gHenselLetters[letters][i];
+    return 0;
+}
+
+/*
+ * Non-negative number, or interval of numbers as "first..last"
+ */
+static bool parseInterval(const std::string &value, int &first, int &last)
+{
+    size_t separator(value.find(".."));
+    std::string firstValue(value.substr(0, separator));
+    std::string lastValue((separator == std::string::npos) ? firstValue : value.substr(separator + 2));
+    if (firstValue.empty() || lastValue.empty() || firstValue.find_first_not_of("0123456789") != std::string::npos ||
+        lastValue.find_first_not_of("0123456789") != std::string::npos || firstValue.length() > 9 ||
+        lastValue.length() > 9)
+        return false;
+    first = atoi(firstValue.c_str());
+    last = atoi(lastValue.c_str());
+    return first <= last;
+}
+
+Rule::Rule()
+{
+    setTotalistic(gConwayBirth, gConwaySurvival);
+}
+
+Rule::Rule(const cl_uint birth, const cl_uint survival)
+{
+    setTotalistic(birth, survival);
+}
+
+void Rule::setTotalistic(const cl_uint birth, const cl_uint survival)
+{
+    std::stringstream name;
+    name << "B";
+    for (int count(0); count < 9; ++count)
+        if ((birth >> count) & 1)
+            name << count;
+    name << "/S";
+    for (int count(0); count < 9; ++count)
+        if ((survival >> count) & 1)
+            name << count;
+    m_name = name.str();
+
+    memset(m_table, 0, sizeof(m_table));
+    for (int neighborhood(0); neighborhood < 512; ++neighborhood)
+        if ((((neighborhood & gRuleCenter) ? survival : birth) >> neighborCount(neighborhood)) & 1)
+            m_table[neighborhood >> 5] |= 1u << (neighborhood & 31);
+    m_states = 2;
+    m_range = 1;
+    m_middle = false;
+    m_birthMin = m_birthMax = m_survivalMin = m_survivalMax = 0;
+    updateMasks();
+}
+
+/*
+ * parse
+ */
+bool Rule::parse(const std::string &rule)
+{
+    if (!rule.empty() && toupper(rule[0]) == 'R')
+        return parseLargerThanLife(rule);
+
+    std::vector<std::string> fields;
+    std::stringstream s(rule);
+    std::string field;
+    while (std::getline(s, field, '/'))
+        fields.push_back(field);
+    if (!rule.empty() && rule[rule.length() - 1] == '/')
+        fields.push_back("");
+    if (fields.size() < 2 || fields.size() > 3)
+        return false;
+
+    // Fields are B, S and C prefixed, or survival, birth and states in this order
+    std::string birth;
+    std::string survival;
+    std::string states("2");
+    for (size_t i(0); i < fields.size(); ++i)
+    {
+        char prefix = fields[i].empty() ? 0 : static_cast<char>(toupper(fields[i][0]));
+        if (prefix == 'B')
+            birth = fields[i].substr(1);
+        else if (prefix == 'S')
+            survival = fields[i].substr(1);
+        else if (prefix == 'C')
+            states = fields[i].substr(1);
+        else if (i == 0)
+            survival = fields[i];
+        else if (i == 1)
+            birth = fields[i];
+        else if (!fields[i].empty())
+            states = fields[i];
+    }
+
+    int stateCount(atoi(states.c_str()));
+    if (states.empty() || states.find_first_not_of("0123456789") != std::string::npos || stateCount < 2 ||
+        stateCount > gRuleMaxStates)
+        return false;
+
+    cl_uint table[gRuleTableWords];
+    memset(table, 0, sizeof(table));
+    if (!parseConditions(birth, 0, table) || !parseConditions(survival, gRuleCenter, table))
+        return false;
+
+    std::stringstream name;
+    name << "B" << birth << "/S" << survival;
+    if (stateCount > 2)
+        name << "/C" << stateCount;
+    m_name = name.str();
+    memcpy(m_table, table, sizeof(m_table));
+    m_states = stateCount;
+    m_range = 1;
+    updateMasks();
+    return true;
+}
+
+/*
+ * parseLargerThanLife
+ */
+bool Rule::parseLargerThanLife(const std::string &rule)
+{
+    // Range, states, middle, survival and birth intervals and neighborhood, each a letter and its value. Only
+    // the Moore neighborhood is supported
+    int range(0), states(-1), middle(-1), survivalMin(-1), survivalMax(-1), birthMin(-1), birthMax(-1);
+    std::stringstream s(rule);
+    std::string field;
+    while (std::getline(s, field, ','))
+    {
+        char prefix = field.empty() ? 0 : static_cast<char>(toupper(field[0]));
+        std::string value(field.empty() ? field : field.substr(1));
+        int first(0);
+        int last(0);
+        if (prefix == 'N')
+        {
+            if (value != "M" && value != "m")
+                return false;
+        }
+        else if (!parseInterval(value, first, last))
+            return false;
+        else if (prefix == 'S' || prefix == 'B')
+        {
+            (prefix == 'S' ? survivalMin : birthMin) = first;
+            (prefix == 'S' ? survivalMax : birthMax) = last;
+        }
+        else if (first != last)
+            return false;
+        else if (prefix == 'R')
+            range = first;
+        else if (prefix == 'C')
+            states = first;
+        else if (prefix == 'M')
+            middle = first;
+        else
+            return false;
+    }
+
+    // C0 and C1 both stand for two states
+    int cells((2 * range + 1) * (2 * range + 1));
+    if (range < 1 || range > gRuleMaxRange || states < 0 || states > gRuleMaxStates || middle < 0 || middle > 1 ||
+        survivalMin < 0 || survivalMax >= cells || birthMin < 0 || birthMax >= cells)
+        return false;
+
+    std::stringstream name;
+    name << "R" << range << ",C" << states << ",M" << middle << ",S" << survivalMin << ".." << survivalMax << ",B"
+         << birthMin << ".." << birthMax << ",NM";
+    m_name = name.str();
+    m_states = (states < 2) ? 2 : states;
+    m_range = range;
+    m_middle = (middle == 1);
+    m_survivalMin = survivalMin;
+    m_survivalMax = survivalMax;
+    m_birthMin = birthMin;
+    m_birthMax = birthMax;
+
+    // A range of 1 is an outer totalistic rule of the 3x3 neighborhood
+    memset(m_table, 0, sizeof(m_table));
+    for (int neighborhood(0); range == 1 && neighborhood < 512; ++neighborhood)
+    {
+        bool alive((neighborhood & gRuleCenter) != 0);
+        int count(neighborCount(neighborhood) + ((alive && m_middle) ? 1 : 0));
+        if (alive ? (count >= survivalMin && count <= survivalMax) : (count >= birthMin && count <= birthMax))
+            m_table[neighborhood >> 5] |= 1u << (neighborhood & 31);
+    }
+    updateMasks();
+    return true;
+}
+
+/*
+ * parseConditions
+ */
+bool Rule::parseConditions(const std::string &conditions, const int center, cl_uint *table)
+{
+    // Counts of neighbors, each followed by the letters of its configurations, all of them by default, or by
+    // a minus sign and the letters of the configurations it excludes
+    size_t i(0);
+    while (i < conditions.length())
+    {
+        if (conditions[i] < '0' || conditions[i] > '8')
+            return false;
+        int count(conditions[i++] - '0');
+        bool excluded(i < conditions.length() && conditions[i] == '-');
+        if (excluded)
+            ++i;
+        std::string letters;
+        while (i < conditions.length() && islower(conditions[i]))
+        {
+            if (!strchr(gHenselLetters[count <= 4 ? count : 8 - count], conditions[i]))
+                return false;
+            letters += conditions[i++];
+        }
+        if (excluded && letters.empty())
+            return false;
+
+        for (int neighborhood(0); neighborhood < 512; ++neighborhood)
+            if ((neighborhood & gRuleCenter) == center && neighborCount(neighborhood) == count &&
+                (letters.empty() || (letters.find(henselLetter(neighborhood)) != std::string::npos) != excluded))
+                table[neighborhood >> 5] |= 1u << (neighborhood & 31);
+    }
+    return true;
+}
+
+/*
+ * updateMasks
+ */
+void Rule::updateMasks()
+{
+    // Counts of neighbors giving birth or survival in any configuration, the rule being totalistic when they
+    // do in every configuration
+    m_birth = 0;
+    m_survival = 0;
+    for (int neighborhood(0); neighborhood < 512; ++neighborhood)
+        if (isAlive(neighborhood))
+            ((neighborhood & gRuleCenter) ? m_survival : m_birth) |= 1u << neighborCount(neighborhood);
+
+    m_totalistic = true;
+    for (int neighborhood(0); neighborhood < 512; ++neighborhood)
+    {
+        cl_uint mask((neighborhood & gRuleCenter) ? m_survival : m_birth);
+        if (((mask >> neighborCount(neighborhood)) & 1) != (isAlive(neighborhood) ? 1u : 0u))
+            m_totalistic = false;
+    }
+}
+
+/*
+ * getBuildOptions
+ */
+std::string Rule::getBuildOptions() const
+{
+    // Masks of a totalistic rule, the transition table of the others
+    std::stringstream options;
+    options << " -DRULE_STATES=" << m_states;
+    if (m_range > 1)
+    {
+        // Intervals of a Larger than Life rule
+        options << " -DRULE_RANGE=" << m_range << " -DRULE_MIDDLE=" << (m_middle ? 1 : 0)
+                << " -DRULE_BIRTH_MIN=" << m_birthMin << " -DRULE_BIRTH_MAX=" << m_birthMax
+                << " -DRULE_SURVIVAL_MIN=" << m_survivalMin << " -DRULE_SURVIVAL_MAX=" << m_survivalMax;
+        return options.str();
+    }
+
+    options << std::hex;
+    if (m_totalistic)
+        options << " -DRULE_BIRTH=0x" << m_birth << " -DRULE_SURVIVAL=0x" << m_survival;
+    else
+    {
+        options << " -DRULE_TABLE=";
+        for (int i(0); i < gRuleTableWords; ++i)
+            options << ((i == 0) ? "0x" : ",0x") << m_table[i];
+    }
+    return options.str();
+}
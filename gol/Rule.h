@@ -0,0 +1,105 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <CL/opencl.h>
+
+#include "DLL_API.h"
+#include <string>
+
+// Words of the transition table: one bit per 3x3 neighborhood
+const int gRuleTableWords = 512 / 32;
+// Cell states of a Generations rule, stored in a byte
+const int gRuleMaxStates = 256;
+// Range of the neighborhood of a Larger than Life rule
+const int gRuleMaxRange = 500;
+
+/*
+ * Cellular automaton rule of the outer totalistic or isotropic non-totalistic family, with any number of
+ * states. The rule is a transition table indexed by the 3x3 neighborhood of a cell, bit 4 being the cell
+ * itself and bits 0 to 8 the cells in row order. Alive cells that do not survive start dying: with more
+ * than two states, they go through the states 2 to getStates()-1 before being dead, and do not count as
+ * neighbors meanwhile.
+ *
+ * Larger than Life rules count the alive cells of the (2*range+1)^2 square around the cell instead, and have no
+ * transition table beyond a range of 1.
+ *
+ * The rule specializes the OpenCL kernels at compile time through getBuildOptions().
+ */
+class GOL_API Rule
+{
+public:
+    // Conway's Game of Life, B3/S23
+    Rule();
+    // Life-like rule: bit n of the masks is set when n neighbors give birth to, or keep alive, a cell
+    Rule(const cl_uint birth, const cl_uint survival);
+
+public:
+    // Parses a rule, leaving it unchanged and returning false when the string is not valid:
+    // - Life-like rules: "B3/S23", or "23/3" in survival/birth order
+    // - Generations rules: "B2/S/C3", or "/2/3" in survival/birth/states order
+    // - Isotropic non-totalistic rules in Hensel notation: "B2-a/S12", "B2n3/S23-q"
+    // - Larger than Life rules of the Moore neighborhood: "R5,C0,M1,S34..58,B34..45,NM"
+    bool parse(const std::string &rule);
+
+    const std::string &getName() const { return m_name; };
+    int getStates() const { return m_states; };
+
+    // Whether the next state only depends on the number of alive neighbors
+    bool isTotalistic() const { return m_totalistic; };
+    bool isLifeLike() const { return m_totalistic && m_states == 2 && m_range == 1; };
+
+    // Range of the neighborhood, larger than 1 for Larger than Life rules
+    int getRange() const { return m_range; };
+
+    // Birth and survival masks of a totalistic rule
+    cl_uint getBirth() const { return m_birth; };
+    cl_uint getSurvival() const { return m_survival; };
+
+    // Whether a cell is alive on the next generation, bit 4 of the neighborhood being the cell itself
+    bool isAlive(const int neighborhood) const { return ((m_table[neighborhood >> 5] >> (neighborhood & 31)) & 1); };
+
+    // OpenCL build options of the kernels specialized for the rule
+    std::string getBuildOptions() const;
+
+private:
+    void setTotalistic(const cl_uint birth, const cl_uint survival);
+    bool parseConditions(const std::string &conditions, const int center, cl_uint *table);
+    bool parseLargerThanLife(const std::string &rule);
+    void updateMasks();
+
+private:
+    std::string m_name;
+    cl_uint m_table[gRuleTableWords];
+    int m_states;
+    bool m_totalistic;
+    cl_uint m_birth;
+    cl_uint m_survival;
+
+    // Larger than Life: counts of alive cells giving birth or survival, the cell itself included when middle
+    int m_range;
+    bool m_middle;
+    int m_birthMin;
+    int m_birthMax;
+    int m_survivalMin;
+    int m_survivalMax;
+};
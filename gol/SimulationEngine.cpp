@@ -0,0 +1,78 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <algorithm>
+
+#include "SimulationEngine.h"
+
+/*
+ * storeTexture
+ */
+void storeTexture(const BYTE *bitmap, BYTE *texture)
+{
+    int j(0);
+    for (int i(0); i < gTextureWidth * gTextureHeight * gColorDepth; i += gColorDepth)
+    {
+        texture[j] = bitmap[i + 2];
+        texture[j + 1] = bitmap[i + 1];
+        texture[j + 2] = bitmap[i];
+        j += gTextureDepth;
+    }
+}
+
+/*
+ * seedPackedRow
+ */
+void seedPackedRow(const BYTE *texture, const int width, const int height, const int x, const int y,
+                   const int count, const float limit, uint32_t *words)
+{
+    std::fill(words, words + packedWords(count), 0u);
+    const BYTE *row = texture + stretchedTexel(y, height, gTextureHeight) * gTextureWidth * gTextureDepth;
+    for (int i(0); i < count; ++i)
+    {
+        const BYTE *color = row + stretchedTexel(x + i, width, gTextureWidth) * gTextureDepth;
+        float power = (color[0] / 256.f + color[1] / 256.f + color[2] / 256.f) / 3.f;
+        if (power <= limit)
+            words[i / gPackedWordBits] |= 1u << (i % gPackedWordBits);
+    }
+}
+
+/*
+ * colorizePackedRow
+ */
+void colorizePackedRow(const BYTE *texture, const int width, const int height, const int y, const uint32_t *words,
+                       BYTE *pixels)
+{
+    const BYTE *row = texture + stretchedTexel(y, height, gTextureHeight) * gTextureWidth * gTextureDepth;
+    for (int x(0); x < width; ++x, pixels += gColorDepth)
+    {
+        if ((words[x / gPackedWordBits] >> (x % gPackedWordBits)) & 1)
+        {
+            const BYTE *color = row + stretchedTexel(x, width, gTextureWidth) * gTextureDepth;
+            pixels[0] = color[0];
+            pixels[1] = color[1];
+            pixels[2] = color[2];
+            pixels[3] = 255;
+        }
+        else
+            pixels[0] = pixels[1] = pixels[2] = pixels[3] = 0;
+    }
+}
@@ -0,0 +1,120 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include "DLL_API.h"
+#include "Profiler.h"
+#include <stdint.h>
+#include <vector>
+#ifdef WIN32
+#include <windows.h>
+#else
+typedef unsigned char BYTE;
+#endif
+
+const int gTextureWidth = 1920;
+const int gTextureHeight = 1200;
+const int gTextureDepth = 3;
+const int gColorDepth = 4;
+
+// Texel of the cell at column (or row) x of a board size cells wide, the texture being stretched over the board as
+// the kernels sample it
+inline int stretchedTexel(const int x, const int size, const int textureSize)
+{
+    return static_cast<int>(static_cast<long long>(x) * textureSize / size);
+}
+
+// Copies a bitmap of gTextureWidth x gTextureHeight BGRA pixels into texture, stored as the kernels read it:
+// gTextureDepth bytes per texel, red first
+GOL_API void storeTexture(const BYTE *bitmap, BYTE *texture);
+
+// Packed words of the count cells of row y starting at column x, on a board of width x height cells seeded from
+// texture: a cell is alive when its texel is no brighter than limit, as pixelPower() in the kernels
+GOL_API void seedPackedRow(const BYTE *texture, const int width, const int height, const int x, const int y,
+                           const int count, const float limit, uint32_t *words);
+
+// Pixels of row y of a board of width x height cells from its packed words: alive cells take the color of texture,
+// as packed_colorize_kernel, dead cells are black
+GOL_API void colorizePackedRow(const BYTE *texture, const int width, const int height, const int y,
+                               const uint32_t *words, BYTE *pixels);
+
+// Packed cells: one bit per cell, 32 cells per word
+const int gPackedWordBits = 32;
+
+// Words of a packed row of width cells
+inline int packedWords(const int width)
+{
+    return (width + gPackedWordBits - 1) / gPackedWordBits;
+}
+
+const uint32_t gConwayBirth = 0x008;    // B3
+const uint32_t gConwaySurvival = 0x00C; // S23
+
+enum CellStorage
+{
+    cs_float4,  // RGBA color per cell
+    cs_packed,  // One bit per cell
+    cs_chunked, // One bit per cell, in sparse chunks of an unbounded board
+    cs_states   // Two bytes per cell: dead, alive or dying state of a Generations rule, and age
+};
+
+/*
+ * Simulation backend. A board is seeded from the texture on its first generation, unless a state is loaded.
+ *
+ * States are exchanged as packed rows of (width+gPackedWordBits-1)/gPackedWordBits words, bit i of
+ * word w being the cell w*gPackedWordBits+i of the row.
+ */
+class GOL_API SimulationEngine
+{
+public:
+    virtual ~SimulationEngine() {}
+
+public:
+    // ---------- Board ----------
+    virtual void initializeDevice(int width, int height, const CellStorage storage = cs_float4) = 0;
+
+    // Advances the board by the given number of generations
+    virtual void step(const unsigned int generations) = 0;
+
+    // Produces a frame of the current generation into bitmap (width*height*gColorDepth)
+    virtual void readback(BYTE *bitmap) = 0;
+
+    // Seeds the board again on the next generation
+    virtual void reset() = 0;
+
+    // ---------- State ----------
+    virtual void loadState(const std::vector<uint32_t> &cells) = 0;
+    virtual void saveState(std::vector<uint32_t> &cells) = 0;
+
+    // ---------- Seeding and rules ----------
+    virtual void setTexture(int index, BYTE *texture) = 0;
+
+    // Threshold under which a texture color gives an alive cell
+    virtual void setLimit(const float limit) = 0;
+
+    // Birth and survival masks: bit n is set when n neighbors give birth to, or keep alive, a cell. Returns false,
+    // the previous rule being kept, when the engine does not run the rule
+    virtual bool setRule(const uint32_t birth, const uint32_t survival) = 0;
+
+    // ---------- Statistics ----------
+    virtual ProfilingStatistics getStatistics() = 0;
+};
@@ -0,0 +1,321 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include "Snapshot.h"
+
+const char gSnapshotMagic[] = {'G', 'O', 'L', 'S'};
+const uint32_t gSnapshotRun = 0x80000000;
+
+/*
+ * encodeRuns: tokens of the words of a tile, as se_runs
+ */
+static void encodeRuns(const std::vector<uint32_t> &words, std::vector<uint32_t> &tokens)
+{
+    tokens.clear();
+    for (size_t i(0); i < words.size();)
+    {
+        size_t j(i);
+        if (words[i] == 0)
+        {
+            while (j < words.size() && words[j] == 0)
+                ++j;
+            tokens.push_back(static_cast<uint32_t>(j - i) | gSnapshotRun);
+        }
+        else
+        {
+            while (j < words.size() && words[j] != 0)
+                ++j;
+            tokens.push_back(static_cast<uint32_t>(j - i));
+            tokens.insert(tokens.end(), words.begin() + i, words.begin() + j);
+        }
+        i = j;
+    }
+}
+
+/*
+ * Snapshot constructor
+ */
+Snapshot::Snapshot()
+    : m_wordsPerRow(0)
+    , m_tileWords(0)
+    , m_tileRows(0)
+    , m_tileColumns(0)
+    , m_tileCount(0)
+{
+    memset(&m_info, 0, sizeof(m_info));
+}
+
+bool Snapshot::open(const std::string &fileName)
+{
+    if (!m_file.open(fileName))
+        return false;
+
+    const SnapshotHeader *header = reinterpret_cast<const SnapshotHeader *>(m_file.getData());
+    if (m_file.getSize() < sizeof(SnapshotHeader) || memcmp(header->magic, gSnapshotMagic, 4) != 0 ||
+        header->version != gSnapshotVersion || header->width <= 0 || header->height <= 0 || header->tileWords == 0 ||
+        header->tileRows == 0)
+    {
+        std::cerr << fileName << " is not a snapshot of version " << gSnapshotVersion << std::endl;
+        m_file.close();
+        return false;
+    }
+    m_info.width = header->width;
+    m_info.height = header->height;
+    m_info.generation = header->generation;
+    m_info.birth = header->birth;
+    m_info.survival = header->survival;
+    m_wordsPerRow = packedWords(header->width);
+    m_tileWords = static_cast<int>(std::min(header->tileWords, static_cast<uint32_t>(m_wordsPerRow)));
+    m_tileRows = static_cast<int>(std::min(header->tileRows, static_cast<uint32_t>(header->height)));
+    m_tileColumns = (m_wordsPerRow + m_tileWords - 1) / m_tileWords;
+    m_tileCount = header->tileCount;
+
+    // Every payload lies within the file, packed tiles being aligned words of the size of the tile
+    size_t tileRowCount = (header->height + m_tileRows - 1) / m_tileRows;
+    bool valid = (m_tileCount == static_cast<size_t>(m_tileColumns) * tileRowCount &&
+                  m_file.getSize() >= sizeof(SnapshotHeader) + m_tileCount * sizeof(SnapshotTile));
+    for (size_t i(0); valid && i < m_tileCount; ++i)
+    {
+        const SnapshotTile &tile = getTile(i);
+        int word(0);
+        int row(0);
+        int words(0);
+        int rows(0);
+        getTileBounds(i, word, row, words, rows);
+        valid = (tile.offset <= m_file.getSize() && tile.bytes <= m_file.getSize() - tile.offset &&
+                 tile.offset % sizeof(uint32_t) == 0 && tile.bytes % sizeof(uint32_t) == 0 &&
+                 (tile.encoding == se_empty || tile.encoding == se_runs ||
+                  (tile.encoding == se_packed && tile.bytes == words * rows * sizeof(uint32_t))));
+    }
+    if (!valid)
+    {
+        std::cerr << "The tiles of snapshot " << fileName << " are corrupted" << std::endl;
+        m_file.close();
+        return false;
+    }
+    return true;
+}
+
+const SnapshotTile &Snapshot::getTile(const size_t index) const
+{
+    return reinterpret_cast<const SnapshotTile *>(m_file.getData() + sizeof(SnapshotHeader))[index];
+}
+
+void Snapshot::getTileBounds(const size_t index, int &word, int &row, int &words, int &rows) const
+{
+    word = static_cast<int>(index % m_tileColumns) * m_tileWords;
+    row = static_cast<int>(index / m_tileColumns) * m_tileRows;
+    words = std::min(m_tileWords, m_wordsPerRow - word);
+    rows = std::min(m_tileRows, m_info.height - row);
+}
+
+const uint32_t *Snapshot::getPackedTile(const size_t index) const
+{
+    const SnapshotTile &tile = getTile(index);
+    if (tile.encoding != se_packed)
+        return NULL;
+    return reinterpret_cast<const uint32_t *>(m_file.getData() + tile.offset);
+}
+
+bool Snapshot::decodeTile(const size_t index, uint32_t *cells, const int wordsPerRow) const
+{
+    const SnapshotTile &tile = getTile(index);
+    const uint32_t *payload = reinterpret_cast<const uint32_t *>(m_file.getData() + tile.offset);
+    size_t payloadWords = tile.bytes / sizeof(uint32_t);
+    int word(0);
+    int row(0);
+    int words(0);
+    int rows(0);
+    getTileBounds(index, word, row, words, rows);
+
+    // Words of the tile in row order, whatever the encoding
+    size_t count = static_cast<size_t>(words) * rows;
+    size_t position(0);
+    size_t token(0);
+    for (size_t i(0); i < count;)
+    {
+        size_t length(count);
+        bool literal(tile.encoding == se_packed);
+        if (tile.encoding == se_runs)
+        {
+            if (token >= payloadWords)
+                return false;
+            literal = (payload[token] & gSnapshotRun) == 0;
+            length = payload[token] & ~gSnapshotRun;
+            position = ++token;
+            if (literal)
+                token += length;
+            if (length == 0 || i + length > count || (literal && token > payloadWords))
+                return false;
+        }
+        for (size_t j(0); j < length; ++j, ++i)
+            cells[(i / words) * static_cast<size_t>(wordsPerRow) + i % words] =
+                (literal && tile.encoding != se_empty) ? payload[position + j] : 0;
+    }
+    return true;
+}
+
+bool Snapshot::load(std::vector<uint32_t> &cells) const
+{
+    cells.assign(static_cast<size_t>(m_wordsPerRow) * m_info.height, 0);
+    for (size_t i(0); i < m_tileCount; ++i)
+    {
+        int word(0);
+        int row(0);
+        int words(0);
+        int rows(0);
+        getTileBounds(i, word, row, words, rows);
+        if (!decodeTile(i, &cells[static_cast<size_t>(row) * m_wordsPerRow + word], m_wordsPerRow))
+        {
+            std::cerr << "Tile " << i << " of the snapshot is corrupted" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Snapshot::save(const std::string &fileName, const SnapshotInfo &info, const std::vector<uint32_t> &cells)
+{
+    int wordsPerRow = packedWords(info.width);
+    int tileColumns = (wordsPerRow + gSnapshotTileWords - 1) / gSnapshotTileWords;
+    size_t tileCount = static_cast<size_t>(tileColumns) * ((info.height + gSnapshotTileRows - 1) / gSnapshotTileRows);
+    if (cells.size() != static_cast<size_t>(wordsPerRow) * info.height)
+    {
+        std::cerr << "Invalid state size" << std::endl;
+        return false;
+    }
+
+    // Written under another name, so that an interrupted write never replaces the previous snapshot
+    std::string temporary = fileName + ".tmp";
+    FILE *file = fopen(temporary.c_str(), "wb");
+    if (file == NULL)
+    {
+        std::cerr << "Cannot write snapshot " << temporary << std::endl;
+        return false;
+    }
+
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, gSnapshotMagic, 4);
+    header.version = gSnapshotVersion;
+    header.width = info.width;
+    header.height = info.height;
+    header.generation = info.generation;
+    header.birth = info.birth;
+    header.survival = info.survival;
+    header.tileWords = gSnapshotTileWords;
+    header.tileRows = gSnapshotTileRows;
+    header.tileCount = static_cast<uint32_t>(tileCount);
+
+    // Header and index, the index being written again once the payloads are known
+    std::vector<SnapshotTile> index(tileCount);
+    bool success = (fwrite(&header, sizeof(header), 1, file) == 1 &&
+                    fwrite(&index[0], sizeof(SnapshotTile), tileCount, file) == tileCount);
+    uint64_t offset = sizeof(header) + tileCount * sizeof(SnapshotTile);
+    std::vector<uint32_t> words;
+    std::vector<uint32_t> tokens;
+    for (size_t i(0); success && i < tileCount; ++i)
+    {
+        int word = static_cast<int>(i % tileColumns) * gSnapshotTileWords;
+        int row = static_cast<int>(i / tileColumns) * gSnapshotTileRows;
+        int tileWords = std::min(gSnapshotTileWords, wordsPerRow - word);
+        int tileRows = std::min(gSnapshotTileRows, info.height - row);
+        words.clear();
+        for (int y(row); y < row + tileRows; ++y)
+            words.insert(words.end(), cells.begin() + static_cast<size_t>(y) * wordsPerRow + word,
+                         cells.begin() + static_cast<size_t>(y) * wordsPerRow + word + tileWords);
+
+        // The smallest encoding of the tile
+        const std::vector<uint32_t> *payload = &words;
+        index[i].encoding = se_packed;
+        encodeRuns(words, tokens);
+        if (tokens.size() == 1 && (tokens[0] & gSnapshotRun) != 0)
+        {
+            index[i].encoding = se_empty;
+            tokens.clear();
+            payload = &tokens;
+        }
+        else if (tokens.size() < words.size())
+        {
+            index[i].encoding = se_runs;
+            payload = &tokens;
+        }
+        index[i].offset = offset;
+        index[i].bytes = static_cast<uint32_t>(payload->size() * sizeof(uint32_t));
+        offset += index[i].bytes;
+        success =
+            payload->empty() || fwrite(&(*payload)[0], sizeof(uint32_t), payload->size(), file) == payload->size();
+    }
+    success = success && fseek(file, sizeof(header), SEEK_SET) == 0 &&
+              fwrite(&index[0], sizeof(SnapshotTile), tileCount, file) == tileCount;
+    success = (fclose(file) == 0) && success;
+
+#ifdef WIN32
+    success = success && MoveFileExA(temporary.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING);
+#else
+    success = success && rename(temporary.c_str(), fileName.c_str()) == 0;
+#endif
+    if (!success)
+    {
+        std::cerr << "Cannot write snapshot " << fileName << std::endl;
+        remove(temporary.c_str());
+    }
+    return success;
+}
+
+/*
+ * SnapshotWriter constructor
+ */
+SnapshotWriter::SnapshotWriter()
+    : m_success(true)
+{
+    memset(&m_info, 0, sizeof(m_info));
+}
+
+SnapshotWriter::~SnapshotWriter()
+{
+    wait();
+}
+
+void SnapshotWriter::write(const std::string &fileName, const SnapshotInfo &info, std::vector<uint32_t> &cells)
+{
+    wait();
+    m_fileName = fileName;
+    m_info = info;
+    m_cells.swap(cells);
+    cells.clear();
+    m_thread = std::thread([this]() { m_success = Snapshot::save(m_fileName, m_info, m_cells); });
+}
+
+bool SnapshotWriter::wait()
+{
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+        std::vector<uint32_t>().swap(m_cells);
+    }
+    return m_success;
+}
@@ -0,0 +1,138 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include "MappedFile.h"
+#include <string>
+#include <thread>
+
+// Version written into the header, snapshots of other versions being rejected
+const uint32_t gSnapshotVersion = 1;
+// Tiles of the board: words of packed cells by rows
+const int gSnapshotTileWords = 32;
+const int gSnapshotTileRows = 32;
+
+enum SnapshotEncoding
+{
+    se_empty,  // Dead cells, without payload
+    se_packed, // Packed words of the tile, row after row
+    se_runs    // Words of the tile as tokens: a run of n zero words is n|0x80000000, n other words follow n
+};
+
+// Board and rule of a snapshot, and the generation it was taken at
+struct SnapshotInfo
+{
+    int32_t width;
+    int32_t height;
+    uint64_t generation;
+    uint32_t birth;
+    uint32_t survival;
+};
+
+// Start of the file, in native byte order, followed by the index of the tiles in row order, then their payloads
+struct SnapshotHeader
+{
+    char magic[4]; // "GOLS"
+    uint32_t version;
+    int32_t width;
+    int32_t height;
+    uint64_t generation;
+    uint32_t birth;
+    uint32_t survival;
+    uint32_t tileWords;
+    uint32_t tileRows;
+    uint32_t tileCount;
+    uint32_t reserved;
+};
+
+struct SnapshotTile
+{
+    uint64_t offset; // Payload, from the start of the file
+    uint32_t bytes;
+    uint32_t encoding;
+};
+
+/*
+ * Snapshot of packed cells, read through a mapping of its file: tiles stored without compression are used in
+ * place, so that a resume uploads them straight from the file (see OpenCLKernel::loadSnapshot()).
+ */
+class GOL_API Snapshot
+{
+public:
+    Snapshot();
+
+public:
+    // Maps the file. Returns false when it is not a snapshot of this version, or its index is inconsistent
+    bool open(const std::string &fileName);
+    void close() { m_file.close(); };
+
+    const SnapshotInfo &getInfo() const { return m_info; };
+    size_t getTileCount() const { return m_tileCount; };
+    // First word and row of a tile on the board, and its size in words and rows
+    void getTileBounds(const size_t index, int &word, int &row, int &words, int &rows) const;
+    // Packed words of a tile stored without compression, NULL for the other encodings
+    const uint32_t *getPackedTile(const size_t index) const;
+    // Decodes a tile into rows of wordsPerRow words, cells receiving its first word. Returns false when the payload
+    // is corrupted
+    bool decodeTile(const size_t index, uint32_t *cells, const int wordsPerRow) const;
+    // Decodes the whole board into packed rows
+    bool load(std::vector<uint32_t> &cells) const;
+
+    // Writes the packed rows of a board into a temporary file, renamed once complete
+    static bool save(const std::string &fileName, const SnapshotInfo &info, const std::vector<uint32_t> &cells);
+
+private:
+    const SnapshotTile &getTile(const size_t index) const;
+
+private:
+    MappedFile m_file;
+    SnapshotInfo m_info;
+    int m_wordsPerRow;
+    int m_tileWords;
+    int m_tileRows;
+    int m_tileColumns;
+    size_t m_tileCount;
+};
+
+/*
+ * Encodes and writes snapshots on a background thread, so that the simulation keeps advancing meanwhile
+ */
+class GOL_API SnapshotWriter
+{
+public:
+    SnapshotWriter();
+    // Waits for the snapshot being written
+    ~SnapshotWriter();
+
+public:
+    // Takes the packed rows over and writes them as a snapshot, after waiting for the previous one
+    void write(const std::string &fileName, const SnapshotInfo &info, std::vector<uint32_t> &cells);
+    // Waits for the snapshot being written, returning whether the last snapshot reached its file
+    bool wait();
+
+private:
+    std::thread m_thread;
+    std::string m_fileName;
+    SnapshotInfo m_info;
+    std::vector<uint32_t> m_cells;
+    bool m_success;
+};
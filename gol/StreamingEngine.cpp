@@ -0,0 +1,311 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <algorithm>
+#include <iostream>
+
+#include "StreamingEngine.h"
+#include "OpenCLStatus.h"
+
+/*
+ * StreamingEngine constructor
+ */
+StreamingEngine::StreamingEngine(int platformId, int deviceId, const std::string &fileName)
+    : m_device(platformId, deviceId, 128, 1)
+    , m_hKernel(0)
+    , m_width(0)
+    , m_height(0)
+    , m_wordsPerRow(0)
+    , m_stripRows(gStreamingStripRows)
+    , m_generationsPerPass(gStreamingGenerations)
+    , m_seeded(false)
+    , m_limit(0.5f)
+    , m_birth(gConwayBirth)
+    , m_survival(gConwaySurvival)
+    , m_cells(NULL)
+    , m_fileName(fileName)
+    , m_textures(gTextureWidth * gTextureHeight * gTextureDepth, 0)
+{
+    for (int i(0); i < gStreamingBuffers; ++i)
+        m_hBuffers[i] = 0;
+}
+
+StreamingEngine::~StreamingEngine()
+{
+    release();
+    if (m_hKernel)
+        CHECKSTATUS(clReleaseKernel(m_hKernel));
+}
+
+void StreamingEngine::release()
+{
+    CHECKSTATUS(clFinish(m_device.getCLQueue()));
+    CHECKSTATUS(clFinish(m_device.getCLTransferQueue()));
+    m_profiler.collect(false);
+    releaseBuffers();
+    m_file.close();
+    m_memory.clear();
+    m_cells = NULL;
+    m_seeded = false;
+}
+
+/*
+ * compileKernels
+ */
+void StreamingEngine::compileKernels(const KernelSourceType sourceType, const std::string &source)
+{
+    int status(0);
+    m_device.compileKernels(sourceType, source, "", "");
+    if (m_hKernel)
+        CHECKSTATUS(clReleaseKernel(m_hKernel));
+    m_hKernel = clCreateKernel(m_device.getCLProgram(), "packed_kernel", &status);
+    CHECKSTATUS(status);
+}
+
+void StreamingEngine::setStripRows(const int rows)
+{
+    m_stripRows = std::max(rows, 1);
+    m_generationsPerPass = std::min(m_generationsPerPass, m_stripRows);
+    if (m_hBuffers[0])
+        allocateBuffers();
+}
+
+void StreamingEngine::setGenerationsPerPass(const int generations)
+{
+    m_generationsPerPass = std::min(std::max(generations, 1), m_stripRows);
+    if (m_hBuffers[0])
+        allocateBuffers();
+}
+
+/*
+ * allocateBuffers
+ */
+void StreamingEngine::allocateBuffers()
+{
+    // Sized for a strip and its halos, once the passes using the previous buffers are complete
+    CHECKSTATUS(clFinish(m_device.getCLQueue()));
+    CHECKSTATUS(clFinish(m_device.getCLTransferQueue()));
+    releaseBuffers();
+    int status(0);
+    for (int i(0); i < gStreamingBuffers; ++i)
+    {
+        m_hBuffers[i] = clCreateBuffer(m_device.getCLContext(), CL_MEM_READ_WRITE,
+                                       getDeviceBytes() / gStreamingBuffers, 0, &status);
+        CHECKSTATUS(status);
+    }
+}
+
+void StreamingEngine::releaseBuffers()
+{
+    for (int i(0); i < gStreamingBuffers; ++i)
+    {
+        if (m_hBuffers[i])
+            CHECKSTATUS(clReleaseMemObject(m_hBuffers[i]));
+        m_hBuffers[i] = 0;
+    }
+}
+
+size_t StreamingEngine::getDeviceBytes()
+{
+    // Two generations of a strip and its halos per buffer
+    size_t rows = std::min(m_stripRows + 2 * m_generationsPerPass, static_cast<int>(m_height));
+    return gStreamingBuffers * 2 * rows * m_wordsPerRow * sizeof(cl_uint);
+}
+
+// ---------- Board ----------
+void StreamingEngine::initializeDevice(int width, int height, const CellStorage)
+{
+    release();
+    m_width = width;
+    m_height = height;
+    m_wordsPerRow = packedWords(width);
+
+    // A file holding another board is left untouched, the board living in host memory instead
+    size_t words = static_cast<size_t>(m_wordsPerRow) * height;
+    if (!m_fileName.empty() && m_file.create(m_fileName, words * sizeof(cl_uint)))
+    {
+        m_cells = reinterpret_cast<cl_uint *>(m_file.getData());
+        m_seeded = m_file.isExisting();
+    }
+    else
+    {
+        m_memory.assign(words, 0);
+        m_cells = &m_memory[0];
+    }
+
+    allocateBuffers();
+    CHECKSTATUS(clSetKernelArg(m_hKernel, 0, sizeof(cl_int), (void *)&m_width));
+    CHECKSTATUS(clSetKernelArg(m_hKernel, 2, sizeof(cl_int), (void *)&m_wordsPerRow));
+    setRule(m_birth, m_survival);
+}
+
+/*
+ * seed
+ */
+void StreamingEngine::seed()
+{
+    for (int y(0); y < m_height; ++y)
+        seedPackedRow(&m_textures[0], m_width, m_height, 0, y, m_width, m_limit,
+                      m_cells + static_cast<size_t>(y) * m_wordsPerRow);
+    m_seeded = true;
+}
+
+/*
+ * step
+ */
+void StreamingEngine::step(const unsigned int generations)
+{
+    if (!m_seeded)
+        seed();
+    if (m_cells == NULL)
+        return;
+    for (unsigned int done(0); done < generations;)
+    {
+        int count = static_cast<int>(std::min(static_cast<unsigned int>(m_generationsPerPass), generations - done));
+        enqueuePass(count);
+        done += count;
+    }
+    CHECKSTATUS(clFinish(m_device.getCLQueue()));
+    CHECKSTATUS(clFinish(m_device.getCLTransferQueue()));
+    m_profiler.collect(false);
+}
+
+/*
+ * enqueuePass
+ */
+void StreamingEngine::enqueuePass(const int generations)
+{
+    cl_command_queue queue = m_device.getCLQueue();
+    cl_command_queue transferQueue = m_device.getCLTransferQueue();
+    size_t rowBytes = m_wordsPerRow * sizeof(cl_uint);
+    int strips = (m_height + m_stripRows - 1) / m_stripRows;
+
+    // Per buffer: first and last rows of its strip and halos, and the last generation advanced in it
+    int begin[gStreamingBuffers];
+    int end[gStreamingBuffers];
+    cl_event kernelEvents[gStreamingBuffers];
+    for (int s(0); s <= strips; ++s)
+    {
+        int current = s % gStreamingBuffers;
+        int previous = (s + gStreamingBuffers - 1) % gStreamingBuffers;
+        cl_event uploadEvent(0);
+        if (s < strips)
+        {
+            // The halos are one row per generation, or the board edges
+            begin[current] = std::max(s * m_stripRows - generations, 0);
+            end[current] = std::min((s + 1) * m_stripRows + generations, static_cast<int>(m_height));
+            CHECKSTATUS(clEnqueueWriteBuffer(transferQueue, m_hBuffers[current], CL_FALSE, 0,
+                                             (end[current] - begin[current]) * rowBytes,
+                                             m_cells + static_cast<size_t>(begin[current]) * m_wordsPerRow, 0, NULL,
+                                             &uploadEvent));
+            CHECKSTATUS(clFlush(transferQueue));
+        }
+
+        // Rows of the strip above, once the upload of this strip read its upper halo
+        if (s > 0)
+        {
+            int rows = end[previous] - begin[previous];
+            int first = (s - 1) * m_stripRows;
+            int last = std::min(s * m_stripRows, static_cast<int>(m_height));
+            size_t offset = static_cast<size_t>(generations % 2) * rows + first - begin[previous];
+            cl_event event(0);
+            CHECKSTATUS(clEnqueueReadBuffer(transferQueue, m_hBuffers[previous], CL_FALSE, offset * rowBytes,
+                                            (last - first) * rowBytes,
+                                            m_cells + static_cast<size_t>(first) * m_wordsPerRow, 1,
+                                            &kernelEvents[previous], &event));
+            CHECKSTATUS(clFlush(transferQueue));
+            m_profiler.trackOrRelease(ps_simulation, kernelEvents[previous]);
+            m_profiler.trackOrRelease(ps_readback, event);
+        }
+
+        if (s < strips)
+        {
+            cl_int rows = end[current] - begin[current];
+            size_t workSize[] = {static_cast<size_t>(m_wordsPerRow), static_cast<size_t>(rows)};
+            CHECKSTATUS(clSetKernelArg(m_hKernel, 1, sizeof(cl_int), (void *)&rows));
+            CHECKSTATUS(clSetKernelArg(m_hKernel, 3, sizeof(cl_mem), (void *)&m_hBuffers[current]));
+            for (cl_int g(0); g < generations; ++g)
+            {
+                cl_int offset = g % 2;
+                cl_event event(0);
+                CHECKSTATUS(clSetKernelArg(m_hKernel, 4, sizeof(cl_int), (void *)&offset));
+                CHECKSTATUS(clEnqueueNDRangeKernel(queue, m_hKernel, 2, NULL, workSize, 0, (g == 0) ? 1 : 0,
+                                                   (g == 0) ? &uploadEvent : NULL, &event));
+                if (g + 1 < generations)
+                    m_profiler.trackOrRelease(ps_simulation, event);
+                else
+                    kernelEvents[current] = event;
+            }
+            CHECKSTATUS(clFlush(queue));
+            m_profiler.trackOrRelease(ps_upload, uploadEvent);
+        }
+    }
+}
+
+/*
+ * readback
+ */
+void StreamingEngine::readback(BYTE *bitmap)
+{
+    if (!m_seeded)
+        seed();
+
+    for (int y(0); y < m_height; ++y)
+        colorizePackedRow(&m_textures[0], m_width, m_height, y, m_cells + static_cast<size_t>(y) * m_wordsPerRow,
+                          bitmap + static_cast<size_t>(y) * m_width * gColorDepth);
+}
+
+// ---------- State ----------
+void StreamingEngine::loadState(const std::vector<cl_uint> &cells)
+{
+    if (cells.size() != static_cast<size_t>(m_wordsPerRow) * m_height)
+    {
+        std::cerr << "Invalid state size" << std::endl;
+        return;
+    }
+    std::copy(cells.begin(), cells.end(), m_cells);
+    m_seeded = true;
+}
+
+void StreamingEngine::saveState(std::vector<cl_uint> &cells)
+{
+    if (!m_seeded)
+        seed();
+    cells.assign(m_cells, m_cells + static_cast<size_t>(m_wordsPerRow) * m_height);
+}
+
+// ---------- Seeding and rules ----------
+void StreamingEngine::setTexture(int index, BYTE *texture)
+{
+    // Single texture
+    if (index != 0)
+        return;
+    storeTexture(texture, &m_textures[0]);
+}
+
+bool StreamingEngine::setRule(const cl_uint birth, const cl_uint survival)
+{
+    m_birth = birth;
+    m_survival = survival;
+    CHECKSTATUS(clSetKernelArg(m_hKernel, 5, sizeof(cl_uint), (void *)&m_birth));
+    CHECKSTATUS(clSetKernelArg(m_hKernel, 6, sizeof(cl_uint), (void *)&m_survival));
+    return true;
+}
@@ -0,0 +1,114 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include "MappedFile.h"
+#include "OpenCLKernel.h"
+
+// Rows of a strip, and generations advanced by a pass over the board
+const int gStreamingStripRows = 1024;
+const int gStreamingGenerations = 16;
+// Device buffers strips are paged through
+const int gStreamingBuffers = 2;
+
+/*
+ * Packed cells of a board larger than the memory of the device. The board lives in host memory, or in a file
+ * mapped into memory, and strips of rows are paged through a pool of gStreamingBuffers device buffers. A pass
+ * uploads each strip with halos of one row per generation, advances it by up to getGenerationsPerPass()
+ * generations with packed_kernel, and reads back the rows the halos kept right. Transfers are enqueued on the
+ * transfer queue, so that the previous strip is read back and the next one uploaded while a strip is advanced.
+ *
+ * Strips are updated in place: the upload of a strip is enqueued before the read back of the strip above,
+ * which overwrites the rows of its upper halo.
+ */
+class GOL_API StreamingEngine : public SimulationEngine
+{
+public:
+    // The board is mapped from fileName when one is given: the file holds the packed rows of the current
+    // generation, and a file of the size of the board is loaded instead of seeding it
+    StreamingEngine(int platformId, int deviceId, const std::string &fileName = "");
+    virtual ~StreamingEngine();
+
+public:
+    // Builds the kernels, before initializeDevice()
+    void compileKernels(const KernelSourceType sourceType, const std::string &source);
+
+    // Rows of a strip and generations of a pass. Passes never advance more generations than a strip has rows.
+    // Once the device is initialized, the buffers are allocated again for the new strips
+    void setStripRows(const int rows);
+    void setGenerationsPerPass(const int generations);
+    int getStripRows() { return m_stripRows; };
+    int getGenerationsPerPass() { return m_generationsPerPass; };
+
+    // ---------- Board ----------
+    // Cells are always packed, the storage is ignored
+    virtual void initializeDevice(int width, int height, const CellStorage storage = cs_packed);
+    virtual void step(const unsigned int generations);
+    virtual void readback(BYTE *bitmap);
+    virtual void reset() { m_seeded = false; };
+
+    // ---------- State ----------
+    virtual void loadState(const std::vector<cl_uint> &cells);
+    virtual void saveState(std::vector<cl_uint> &cells);
+
+    // ---------- Seeding and rules ----------
+    virtual void setTexture(int index, BYTE *texture);
+    virtual void setLimit(const float limit) { m_limit = limit; };
+    virtual bool setRule(const cl_uint birth, const cl_uint survival);
+
+    // ---------- Statistics ----------
+    virtual ProfilingStatistics getStatistics() { return m_profiler.getStatistics(); };
+
+    // Device memory of the buffer pool
+    size_t getDeviceBytes();
+
+private:
+    void seed();
+    void release();
+    void allocateBuffers();
+    void releaseBuffers();
+    void enqueuePass(const int generations);
+
+private:
+    OpenCLKernel m_device;
+    cl_kernel m_hKernel;
+    cl_mem m_hBuffers[gStreamingBuffers];
+    OpenCLProfiler m_profiler;
+
+    cl_int m_width;
+    cl_int m_height;
+    cl_int m_wordsPerRow;
+    int m_stripRows;
+    int m_generationsPerPass;
+    bool m_seeded;
+    float m_limit;
+    cl_uint m_birth;
+    cl_uint m_survival;
+
+    // Packed rows of the board: m_memory, or the mapping of the file
+    cl_uint *m_cells;
+    std::vector<cl_uint> m_memory;
+    std::string m_fileName;
+    MappedFile m_file;
+
+    std::vector<BYTE> m_textures;
+};
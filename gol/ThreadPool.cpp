@@ -0,0 +1,112 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "ThreadPool.h"
+
+/*
+ * ThreadPool constructor
+ */
+ThreadPool::ThreadPool(int threads)
+    : m_task(0)
+    , m_round(0)
+    , m_busy(0)
+    , m_stop(false)
+    , m_barrierRound(0)
+    , m_barrierWaiting(0)
+{
+    if (threads <= 0)
+        threads = static_cast<int>(std::thread::hardware_concurrency());
+    if (threads <= 0)
+        threads = 1;
+    for (int i(0); i < threads; ++i)
+        m_threads.push_back(std::thread(&ThreadPool::worker, this, i));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (size_t i(0); i < m_threads.size(); ++i)
+        m_threads[i].join();
+}
+
+/*
+ * run
+ */
+void ThreadPool::run(const std::function<void(int)> &task)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_task = &task;
+    m_busy = static_cast<int>(m_threads.size());
+    ++m_round;
+    m_wake.notify_all();
+    while (m_busy != 0)
+        m_done.wait(lock);
+    m_task = 0;
+}
+
+/*
+ * barrier
+ */
+void ThreadPool::barrier()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    unsigned long long round = m_barrierRound;
+    if (++m_barrierWaiting == static_cast<int>(m_threads.size()))
+    {
+        m_barrierWaiting = 0;
+        ++m_barrierRound;
+        m_barrier.notify_all();
+        return;
+    }
+    while (round == m_barrierRound)
+        m_barrier.wait(lock);
+}
+
+/*
+ * worker
+ */
+void ThreadPool::worker(int index)
+{
+    unsigned long long round(0);
+    for (;;)
+    {
+        const std::function<void(int)> *task(0);
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while (!m_stop && m_round == round)
+                m_wake.wait(lock);
+            if (m_stop)
+                return;
+            round = m_round;
+            task = m_task;
+        }
+
+        (*task)(index);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (--m_busy == 0)
+            m_done.notify_one();
+    }
+}
@@ -0,0 +1,68 @@
+/* Copyright (c) 2011-2012, Cyrille Favreau
+ * All rights reserved. Do not distribute without permission.
+ * Responsible Author: Cyrille Favreau <cyrille_favreau@hotmail.com>
+ *
+ * This file is part of OpenCLGameOfLife
+ * <https://github.com/favreau/OpenCLGameOfLife>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include "DLL_API.h"
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Fixed set of worker threads running the same task, each with its own index. Tasks made of several
+ * phases synchronize their workers with barrier().
+ */
+class GOL_API ThreadPool
+{
+public:
+    // 0 threads uses one per hardware thread
+    ThreadPool(int threads);
+    ~ThreadPool();
+
+public:
+    int getThreadCount() { return static_cast<int>(m_threads.size()); };
+
+    // Runs task(index) on every worker and waits for all of them
+    void run(const std::function<void(int)> &task);
+
+    // Waits for every worker of the running task to reach the barrier
+    void barrier();
+
+private:
+    void worker(int index);
+
+private:
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    const std::function<void(int)> *m_task;
+    unsigned long long m_round;
+    int m_busy;
+    bool m_stop;
+
+    // Barrier
+    std::condition_variable m_barrier;
+    unsigned long long m_barrierRound;
+    int m_barrierWaiting;
+};